@@ -0,0 +1,254 @@
+/**
+ * @file WY_IniAllocAgent.c
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "WY_IniAllocAgent.h"
+#include "WY_IniMgr.h"
+#include "WY_IniStatsAgent.h"
+
+
+/**
+ * Rounds a size up to a multiple of WYINI_ARENA_ALIGN.
+ */
+static size_t wyini_arena_round(const size_t p_size)
+{
+    return (p_size + WYINI_ARENA_ALIGN - 1) & ~(size_t)(WYINI_ARENA_ALIGN - 1);
+}
+
+
+
+/**
+ * Returns the first byte of a block that can be handed out.
+ */
+static char * wyini_arena_data(struct S_wyini_arena_block *restrict p_block)
+{
+    return (char*)p_block + wyini_arena_round(sizeof(struct S_wyini_arena_block));
+}
+
+
+
+/**
+ * Allocates from an arena. Moves on to the next block when the current one is full, adding a new block unless the arena is fixed.
+ * @param p_ctx The S_wyini_arena.
+ * @param p_size Size of the allocation.
+ * @return The allocation. NULL if out of memory.
+ */
+static void * wyini_arena_alloc(void *p_ctx, size_t p_size)
+{
+    struct S_wyini_arena *restrict arena = (struct S_wyini_arena*)p_ctx;
+    struct S_wyini_arena_block *restrict block = arena->m_current;
+    const size_t size = wyini_arena_round(p_size);
+
+    if(size < p_size) /* Wrapped around. */
+        return NULL;
+    while(block->m_size - block->m_used < size) {
+        if(block->m_next == NULL) {
+            if(arena->m_fixed)
+                return NULL;
+            size_t new_size = (block->m_size > SIZE_MAX/4) ? block->m_size : block->m_size*2; /* Double the arena each time it runs out. */
+            if(new_size < size)
+                new_size = size;
+            struct S_wyini_arena_block *restrict next = (struct S_wyini_arena_block*)malloc(wyini_arena_round(sizeof(struct S_wyini_arena_block)) + new_size);
+            if(next == NULL)
+                return NULL;
+            next->m_next = NULL;
+            next->m_size = new_size;
+            block->m_next = next;
+        }
+        block = block->m_next;
+        block->m_used = 0; /* Blocks after m_current are unused, but may hold stale counts from before a reset. */
+        arena->m_current = block;
+        arena->m_last = NULL;
+    }
+
+    arena->m_last = wyini_arena_data(block) + block->m_used;
+    arena->m_last_size = size;
+    block->m_used += size;
+    return arena->m_last;
+}
+
+
+
+/**
+ * Resizes an allocation from an arena. The last allocation is resized in place if the block has room. Otherwise a new allocation is made and the content copied, leaving the old one unused until the arena is reset.
+ * @param p_ctx The S_wyini_arena.
+ * @param p_ptr The allocation. May be NULL.
+ * @param p_old_size Size of the allocation.
+ * @param p_new_size The size needed.
+ * @return The resized allocation. NULL if out of memory.
+ */
+static void * wyini_arena_realloc(void *p_ctx, void *p_ptr, size_t p_old_size, size_t p_new_size)
+{
+    struct S_wyini_arena *restrict arena = (struct S_wyini_arena*)p_ctx;
+    struct S_wyini_arena_block *restrict block = arena->m_current;
+    const size_t size = wyini_arena_round(p_new_size);
+
+    if((p_ptr != NULL) && (p_ptr == arena->m_last) && (size >= p_new_size) && (block->m_size - (block->m_used - arena->m_last_size) >= size)) {
+        block->m_used = block->m_used - arena->m_last_size + size;
+        arena->m_last_size = size;
+        return p_ptr;
+    }
+    if((p_ptr != NULL) && (p_new_size <= p_old_size)) /* Shrinking in the middle of a block. Keep it where it is. */
+        return p_ptr;
+
+    char *restrict new_ptr = (char*)wyini_arena_alloc(p_ctx, p_new_size);
+    if((new_ptr != NULL) && (p_ptr != NULL))
+        memcpy(new_ptr, p_ptr, p_old_size);
+    return new_ptr;
+}
+
+
+
+/**
+ * Frees an allocation from an arena. Only the last allocation gives its memory back. Others are released by the next reset.
+ * @param p_ctx The S_wyini_arena.
+ * @param p_ptr The allocation.
+ * @param p_size Size of the allocation.
+ */
+static void wyini_arena_free(void *p_ctx, void *p_ptr, size_t p_size)
+{
+    struct S_wyini_arena *restrict arena = (struct S_wyini_arena*)p_ctx;
+    (void)p_size;
+
+    if((p_ptr != NULL) && (p_ptr == arena->m_last)) {
+        arena->m_current->m_used -= arena->m_last_size;
+        arena->m_last = NULL;
+    }
+}
+
+
+
+/**
+ * m_release of an arena allocator. Resets the arena.
+ * @param p_ctx The S_wyini_arena.
+ */
+static void wyini_arena_release(void *p_ctx)
+{
+    wyini_arena_reset((struct S_wyini_arena*)p_ctx);
+}
+
+
+
+void * wyini_mem_alloc(const struct S_wyini_allocator *restrict p_allocator, const size_t p_size)
+{
+    if((p_allocator == NULL) || (p_allocator->m_alloc == NULL))
+        return malloc(p_size);
+    return p_allocator->m_alloc(p_allocator->m_ctx, p_size);
+}
+
+
+
+void * wyini_mem_realloc(const struct S_wyini_allocator *restrict p_allocator, void *p_ptr, const size_t p_old_size, const size_t p_new_size)
+{
+    WYINI_STATS_ADD(m_reallocs, 1);
+    if((p_allocator == NULL) || (p_allocator->m_alloc == NULL))
+        return realloc(p_ptr, p_new_size);
+    return p_allocator->m_realloc(p_allocator->m_ctx, p_ptr, p_old_size, p_new_size);
+}
+
+
+
+void wyini_mem_free(const struct S_wyini_allocator *restrict p_allocator, void *p_ptr, const size_t p_size)
+{
+    if((p_allocator == NULL) || (p_allocator->m_alloc == NULL))
+        free(p_ptr);
+    else if(p_ptr != NULL)
+        p_allocator->m_free(p_allocator->m_ctx, p_ptr, p_size);
+}
+
+
+
+void wyini_mem_release(const struct S_wyini_allocator *restrict p_allocator)
+{
+    if((p_allocator != NULL) && (p_allocator->m_alloc != NULL) && (p_allocator->m_release != NULL))
+        p_allocator->m_release(p_allocator->m_ctx);
+}
+
+
+
+int wyini_arena_create(void *p_region, const size_t p_size, wyini_arena_t *restrict *restrict p_arena)
+{
+    const size_t header_size = wyini_arena_round(sizeof(struct S_wyini_arena_block)) + wyini_arena_round(sizeof(struct S_wyini_arena));
+    char *region = (char*)p_region;
+    size_t size = p_size;
+
+    *p_arena = NULL;
+    if(region != NULL) { /* Start the first block at an aligned address within the region. */
+        const size_t skip = (WYINI_ARENA_ALIGN - (uintptr_t)region % WYINI_ARENA_ALIGN) % WYINI_ARENA_ALIGN;
+        if(size < skip)
+            return WYINI_MEMORY_ERR;
+        region += skip;
+        size -= skip;
+    }
+    if(size <= header_size)
+        return WYINI_MEMORY_ERR;
+    if((region == NULL) && ((region = (char*)malloc(size)) == NULL))
+        return WYINI_MEMORY_ERR;
+
+    struct S_wyini_arena_block *restrict first = (struct S_wyini_arena_block*)region;
+    struct S_wyini_arena *restrict arena = (struct S_wyini_arena*)wyini_arena_data(first);
+    first->m_next = NULL;
+    first->m_size = size - wyini_arena_round(sizeof(struct S_wyini_arena_block));
+    first->m_used = wyini_arena_round(sizeof(struct S_wyini_arena)); /* The arena itself is never handed out. */
+    arena->m_first = first;
+    arena->m_current = first;
+    arena->m_last = NULL;
+    arena->m_last_size = 0;
+    arena->m_fixed = (p_region != NULL);
+
+    *p_arena = arena;
+    return WYINI_OK;
+}
+
+
+
+void wyini_arena_allocator(wyini_arena_t *restrict p_arena, wyini_allocator *restrict p_allocator)
+{
+    p_allocator->m_alloc = wyini_arena_alloc;
+    p_allocator->m_realloc = wyini_arena_realloc;
+    p_allocator->m_free = wyini_arena_free;
+    p_allocator->m_release = wyini_arena_release;
+    p_allocator->m_ctx = p_arena;
+}
+
+
+
+void wyini_arena_reset(wyini_arena_t *restrict p_arena)
+{
+    p_arena->m_first->m_used = wyini_arena_round(sizeof(struct S_wyini_arena));
+    p_arena->m_current = p_arena->m_first;
+    p_arena->m_last = NULL;
+}
+
+
+
+size_t wyini_arena_used(const wyini_arena_t *restrict p_arena)
+{
+    size_t used = 0;
+    const struct S_wyini_arena_block *restrict block = p_arena->m_first;
+
+    while(block != p_arena->m_current) { /* Blocks before m_current are counted as full, since what is left in them is not used. */
+        used += block->m_size;
+        block = block->m_next;
+    }
+    return used + block->m_used;
+}
+
+
+
+void wyini_arena_destroy(wyini_arena_t *restrict p_arena)
+{
+    if(p_arena == NULL)
+        return;
+    struct S_wyini_arena_block *block = p_arena->m_first->m_next;
+    while(block != NULL) {
+        struct S_wyini_arena_block *next = block->m_next;
+        free(block);
+        block = next;
+    }
+    if(!p_arena->m_fixed)
+        free(p_arena->m_first);
+}
@@ -0,0 +1,75 @@
+/**
+ * @file WY_IniAllocAgent.h
+ * Declares functions for allocating the memory of a handle through its S_wyini_allocator, and the arena behind the wyini_arena_* API functions in WY_IniMgr.h.
+ * \n
+ * An arena hands out memory from a block by moving a pointer forward, so allocating is a few instructions and the data of a file ends up close together. Blocks are not freed one by one. Instead the whole arena is reset when the handle is cleaned, and the same memory is used again for the next file. An arena on a region supplied by the caller never calls malloc(), and fails allocations once the region is full. An arena allocated by the library grows by adding blocks, which are kept on reset so that reloading a file of the same size does not allocate again.
+*/
+
+#ifndef _WY_INIALLOCAGENT_H_
+#define _WY_INIALLOCAGENT_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "WY_IniDefs.h"
+
+#define WYINI_ARENA_ALIGN 16 /**< Alignment of every block allocated from an arena. Enough for any type used by the library. */
+
+/**
+ * A block of memory in an arena. The memory handed out follows the header, starting at the next multiple of WYINI_ARENA_ALIGN.
+ */
+struct S_wyini_arena_block
+{
+    struct S_wyini_arena_block *m_next; /**< The next block, or NULL. */
+    size_t m_size; /**< Number of bytes that can be handed out from the block. */
+    size_t m_used; /**< Number of bytes handed out from the block since the arena was last reset. */
+};
+
+/**
+ * An arena created by wyini_arena_create(). The arena itself is stored at the start of its first block.
+ */
+struct S_wyini_arena
+{
+    struct S_wyini_arena_block *m_first; /**< The first block, which holds the arena. */
+    struct S_wyini_arena_block *m_current; /**< The block allocations are made from. Blocks before it are full, and blocks after it are unused. */
+    char *m_last; /**< The last allocation in m_current, which can be resized or freed in place. NULL if there is none. */
+    size_t m_last_size; /**< Size of m_last, rounded up to WYINI_ARENA_ALIGN. */
+    bool m_fixed; /**< true if the first block is a region supplied by the caller, in which case the arena never grows. */
+};
+
+
+/**
+ * Allocates a block through an allocator.
+ * @param p_allocator The allocator. NULL or an allocator with no m_alloc uses malloc().
+ * @param p_size Size of the block.
+ * @return The block. NULL if out of memory.
+ */
+void * wyini_mem_alloc(const struct S_wyini_allocator *restrict p_allocator, const size_t p_size);
+
+
+/**
+ * Resizes a block through an allocator, moving it if necessary.
+ * @param p_allocator The allocator that allocated the block. NULL or an allocator with no m_alloc uses realloc().
+ * @param p_ptr The block. May be NULL to allocate a new one.
+ * @param p_old_size Current size of the block. 0 if p_ptr is NULL.
+ * @param p_new_size The size needed.
+ * @return The resized block. NULL if out of memory, in which case p_ptr is still valid and unchanged.
+ */
+void * wyini_mem_realloc(const struct S_wyini_allocator *restrict p_allocator, void *p_ptr, const size_t p_old_size, const size_t p_new_size);
+
+
+/**
+ * Frees a block through an allocator.
+ * @param p_allocator The allocator that allocated the block. NULL or an allocator with no m_alloc uses free().
+ * @param p_ptr The block. May be NULL.
+ * @param p_size Size of the block.
+ */
+void wyini_mem_free(const struct S_wyini_allocator *restrict p_allocator, void *p_ptr, const size_t p_size);
+
+
+/**
+ * Tells an allocator that all the blocks of a handle have been freed, by calling its m_release if it has one.
+ * @param p_allocator The allocator.
+ */
+void wyini_mem_release(const struct S_wyini_allocator *restrict p_allocator);
+
+#endif
@@ -0,0 +1,306 @@
+/**
+ * @file WY_IniCompileAgent.c
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "WY_IniCompileAgent.h"
+#include "WY_IniIndexAgent.h"
+#include "WY_IniIO.h"
+#include "WY_IniAllocAgent.h"
+#include "WY_IniStatsAgent.h"
+
+#define WYINI_COMPILED_ALIGN(p_offset) (((p_offset) + 7) & ~(uint64_t)7) /**< Rounds an offset in the image up to a multiple of 8. */
+#define WYINI_COMPILED_REGIONS 6 /**< Number of regions after the header: the content and the five arrays of the index. */
+
+
+/**
+ * A region of a compiled image covered by the checksum.
+ */
+struct S_wyini_compiled_region
+{
+    const void *m_ptr; /**< Start of the region in memory. */
+    uint64_t m_offset; /**< Offset of the region in the image. */
+    uint64_t m_len; /**< Length of the region. */
+};
+
+
+/**
+ * Continues a checksum over a block of memory. Four independent lanes take 8 bytes each per step, so the multiplications overlap and the check runs close to memory speed. This detects damaged or truncated images, it is not meant to resist deliberate tampering.
+ * @param p_hash The checksum so far.
+ * @param p_data The block.
+ * @param p_len Length of the block.
+ * @return The new checksum.
+ */
+static uint64_t wyini_compiled_checksum(uint64_t p_hash, const void *restrict p_data, const uint64_t p_len)
+{
+    const unsigned char *restrict data = (const unsigned char*)p_data;
+    uint64_t lanes[4] = { p_hash, p_hash ^ 1, p_hash ^ 2, p_hash ^ 3 };
+    uint64_t i = 0;
+    uint64_t word;
+
+    for(; i+32 <= p_len; i+=32) {
+        for(unsigned int lane=0; lane<4; ++lane) {
+            memcpy(&word, data + i + lane*8, 8);
+            lanes[lane] = (lanes[lane] ^ word) * 0x9E3779B97F4A7C15u;
+            lanes[lane] ^= lanes[lane] >> 32;
+        }
+    }
+    for(; i+8 <= p_len; i+=8) { /* Fewer than 32 bytes left. */
+        memcpy(&word, data + i, 8);
+        lanes[0] = (lanes[0] ^ word) * 0x9E3779B97F4A7C15u;
+        lanes[0] ^= lanes[0] >> 32;
+    }
+    word = p_len; /* Mix in the length along with the last bytes, so that trailing zeros count. */
+    for(uint64_t shift=8; i < p_len; ++i, shift+=8)
+        word ^= (uint64_t)data[i] << shift;
+
+    uint64_t hash = word;
+    for(unsigned int lane=0; lane<4; ++lane) {
+        hash = (hash ^ lanes[lane]) * 0x9E3779B97F4A7C15u;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+
+
+/**
+ * Lays out the regions of an image after the header, each starting at a multiple of 8.
+ * @param p_header The header. The counts and sizes must be set. The offsets and m_image_len are set by this function.
+ * @param p_regions Returns the offset and length of each region, in image order. m_ptr is not set.
+ * @return WYINI_OK if success. WYINI_MEMORY_ERR if the image would exceed 4GB.
+ */
+static int wyini_compiled_layout(struct S_wyini_compiled_header *restrict p_header, struct S_wyini_compiled_region *restrict p_regions)
+{
+    const uint64_t lens[WYINI_COMPILED_REGIONS] = {
+        p_header->m_buffer_len,
+        (uint64_t)p_header->m_count * p_header->m_entry_size,
+        (uint64_t)p_header->m_slots_size * sizeof(unsigned int),
+        (uint64_t)p_header->m_slots_size * sizeof(unsigned int),
+        (uint64_t)p_header->m_section_count * p_header->m_section_size,
+        (uint64_t)p_header->m_names_size * sizeof(unsigned int)
+    };
+    uint64_t offset = sizeof(struct S_wyini_compiled_header);
+
+    for(unsigned int i=0; i<WYINI_COMPILED_REGIONS; ++i) {
+        p_regions[i].m_offset = offset;
+        p_regions[i].m_len = lens[i];
+        offset = WYINI_COMPILED_ALIGN(offset + lens[i]);
+    }
+    if(offset > 0xFFFFFFFFu)
+        return WYINI_MEMORY_ERR;
+    p_header->m_entries_offset = (uint32_t)p_regions[1].m_offset;
+    p_header->m_slots_offset = (uint32_t)p_regions[2].m_offset;
+    p_header->m_section_slots_offset = (uint32_t)p_regions[3].m_offset;
+    p_header->m_sections_offset = (uint32_t)p_regions[4].m_offset;
+    p_header->m_names_offset = (uint32_t)p_regions[5].m_offset;
+    p_header->m_image_len = (uint32_t)offset;
+    return WYINI_OK;
+}
+
+
+
+/**
+ * Computes the checksum of an image.
+ * @param p_header The header.
+ * @param p_regions The regions after the header, with m_ptr set.
+ * @return The checksum.
+ */
+static uint64_t wyini_compiled_image_checksum(const struct S_wyini_compiled_header *restrict p_header, const struct S_wyini_compiled_region *restrict p_regions)
+{
+    uint64_t hash = wyini_compiled_checksum(14695981039346656037u, p_header, offsetof(struct S_wyini_compiled_header, m_checksum));
+    for(unsigned int i=0; i<WYINI_COMPILED_REGIONS; ++i)
+        hash = wyini_compiled_checksum(hash, p_regions[i].m_ptr, p_regions[i].m_len);
+    return hash;
+}
+
+
+
+/**
+ * Checks if a table size is a power of 2 large enough that a lookup always finds an empty slot.
+ * @param p_size Number of slots.
+ * @param p_count Number of items in the table.
+ * @return true if the size is valid.
+ */
+static bool wyini_compiled_valid_table(const uint32_t p_size, const uint32_t p_count)
+{
+    return (p_size > p_count) && ((p_size & (p_size - 1)) == 0);
+}
+
+
+
+int wyini_compiled_segments(const struct S_wyini_buffer *restrict p_wyini_buffer, struct S_wyini_compiled_header *restrict p_header, struct S_wyini_segment *restrict p_segments, unsigned int *restrict p_count)
+{
+    static const char padding[8] = {0};
+    const struct S_wyini_index *restrict index = &(p_wyini_buffer->m_index);
+    struct S_wyini_compiled_region regions[WYINI_COMPILED_REGIONS];
+    unsigned int count = 0;
+    int return_val;
+
+    if((p_wyini_buffer->m_buffer == NULL) || (p_wyini_buffer->m_edit_count > 0))
+        return WYINI_MEMORY_ERR;
+
+    memset(p_header, 0, sizeof(*p_header)); /* Every byte of the header is saved, so leave nothing uninitialised. */
+    memcpy(p_header->m_magic, WYINI_COMPILED_MAGIC, sizeof(p_header->m_magic));
+    p_header->m_version = WYINI_COMPILED_VERSION;
+    p_header->m_byte_order = WYINI_COMPILED_BYTE_ORDER;
+    p_header->m_entry_size = sizeof(struct S_wyini_index_entry);
+    p_header->m_section_size = sizeof(struct S_wyini_section);
+    p_header->m_buffer_len = p_wyini_buffer->m_buffer_len;
+    p_header->m_count = index->m_count;
+    p_header->m_slots_size = index->m_slots_size;
+    p_header->m_section_count = index->m_section_count;
+    p_header->m_names_size = index->m_names_size;
+    if((return_val = wyini_compiled_layout(p_header, regions)) != WYINI_OK)
+        return return_val;
+
+    regions[0].m_ptr = p_wyini_buffer->m_buffer;
+    regions[1].m_ptr = index->m_entries;
+    regions[2].m_ptr = index->m_slots;
+    regions[3].m_ptr = index->m_section_slots;
+    regions[4].m_ptr = index->m_sections;
+    regions[5].m_ptr = index->m_names;
+    p_header->m_checksum = wyini_compiled_image_checksum(p_header, regions);
+
+    p_segments[count].m_ptr = (const char*)p_header;
+    p_segments[count++].m_len = sizeof(*p_header);
+    for(unsigned int i=0; i<WYINI_COMPILED_REGIONS; ++i) {
+        const uint64_t end = (i+1 < WYINI_COMPILED_REGIONS) ? regions[i+1].m_offset : p_header->m_image_len;
+        if(regions[i].m_len > 0) {
+            p_segments[count].m_ptr = (const char*)regions[i].m_ptr;
+            p_segments[count++].m_len = (unsigned int)regions[i].m_len;
+        }
+        if(end > regions[i].m_offset + regions[i].m_len) { /* Zeros up to the next multiple of 8. */
+            p_segments[count].m_ptr = padding;
+            p_segments[count++].m_len = (unsigned int)(end - regions[i].m_offset - regions[i].m_len);
+        }
+    }
+    *p_count = count;
+    return WYINI_OK;
+}
+
+
+
+int wyini_compiled_write(const char *restrict const p_file, const struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    struct S_wyini_compiled_header header;
+    struct S_wyini_segment segments[WYINI_COMPILED_SEGMENTS];
+    unsigned int count = 0;
+    int return_val;
+
+    if((return_val = wyini_compiled_segments(p_wyini_buffer, &header, segments, &count)) != WYINI_OK)
+        return return_val;
+    return wyini_save_file_atomic(p_file, segments, count);
+}
+
+
+
+int wyini_compiled_attach(char *restrict p_image, const unsigned int p_image_len, const unsigned int p_map_len, struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    struct S_wyini_compiled_header header;
+    struct S_wyini_compiled_region regions[WYINI_COMPILED_REGIONS];
+    struct S_wyini_index *restrict index = &(p_wyini_buffer->m_index);
+
+    if(p_image_len < sizeof(header))
+        return WYINI_IO_ERR;
+    memcpy(&header, p_image, sizeof(header));
+    if((memcmp(header.m_magic, WYINI_COMPILED_MAGIC, sizeof(header.m_magic)) != 0) || (header.m_version != WYINI_COMPILED_VERSION) || (header.m_byte_order != WYINI_COMPILED_BYTE_ORDER))
+        return WYINI_IO_ERR;
+    if((header.m_entry_size != sizeof(struct S_wyini_index_entry)) || (header.m_section_size != sizeof(struct S_wyini_section)) || (header.m_image_len != p_image_len))
+        return WYINI_IO_ERR;
+    if((header.m_buffer_len == 0) || (header.m_section_count == 0) || !wyini_compiled_valid_table(header.m_slots_size, header.m_count) || !wyini_compiled_valid_table(header.m_names_size, header.m_section_count))
+        return WYINI_IO_ERR;
+
+    struct S_wyini_compiled_header layout = header; /* Work out where the regions must be and compare with the header, which also bounds them by the image. */
+    if((wyini_compiled_layout(&layout, regions) != WYINI_OK) || (memcmp(&layout, &header, sizeof(header)) != 0))
+        return WYINI_IO_ERR;
+    for(unsigned int i=0; i<WYINI_COMPILED_REGIONS; ++i)
+        regions[i].m_ptr = p_image + regions[i].m_offset;
+    if(wyini_compiled_image_checksum(&header, regions) != header.m_checksum)
+        return WYINI_IO_ERR;
+
+    p_wyini_buffer->m_buffer = p_image + sizeof(header); /* Point straight into the image. Nothing is copied. */
+    p_wyini_buffer->m_buffer_len = header.m_buffer_len;
+    p_wyini_buffer->m_buffer_mode = WYINI_MODE_COMPILED;
+    p_wyini_buffer->m_map_len = p_map_len;
+    index->m_count = header.m_count;
+    index->m_entries_size = header.m_count;
+    index->m_slots_size = header.m_slots_size;
+    index->m_entries = (struct S_wyini_index_entry*)(p_image + header.m_entries_offset);
+    index->m_slots = (unsigned int*)(p_image + header.m_slots_offset);
+    index->m_section_slots = (unsigned int*)(p_image + header.m_section_slots_offset);
+    index->m_section_count = header.m_section_count;
+    index->m_sections_size = header.m_section_count;
+    index->m_names_size = header.m_names_size;
+    index->m_sections = (struct S_wyini_section*)(p_image + header.m_sections_offset);
+    index->m_names = (unsigned int*)(p_image + header.m_names_offset);
+    return WYINI_OK;
+}
+
+
+
+int wyini_compiled_open(const char *restrict const p_file, const unsigned int p_max_size, struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    unsigned int image_len = 0;
+    char *image = NULL;
+    int return_val;
+
+    if(wyini_map_file(p_file, p_max_size, &image_len, &image) == WYINI_OK) {
+        if((return_val = wyini_compiled_attach(image, image_len, image_len, p_wyini_buffer)) != WYINI_OK)
+            wyini_unmap_file(image_len, image);
+        return return_val;
+    }
+
+    image = NULL;
+    if((return_val = wyini_read_file(p_file, p_max_size, &image_len, &image, &(p_wyini_buffer->m_allocator))) != WYINI_OK)
+        return return_val;
+    if((return_val = wyini_compiled_attach(image, image_len, 0, p_wyini_buffer)) != WYINI_OK)
+        wyini_mem_free(&(p_wyini_buffer->m_allocator), image, image_len);
+    return return_val;
+}
+
+
+
+void wyini_compiled_close(struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    char *image = p_wyini_buffer->m_buffer - sizeof(struct S_wyini_compiled_header);
+
+    if(p_wyini_buffer->m_map_len > 0)
+        wyini_unmap_file(p_wyini_buffer->m_map_len, image);
+    else /* The image was read whole, so its length is the one recorded in its header. */
+        wyini_mem_free(&(p_wyini_buffer->m_allocator), image, ((const struct S_wyini_compiled_header*)image)->m_image_len);
+    p_wyini_buffer->m_buffer = NULL;
+    p_wyini_buffer->m_buffer_len = 0;
+    p_wyini_buffer->m_buffer_size = 0;
+    p_wyini_buffer->m_buffer_mode = WYINI_MODE_READ;
+    p_wyini_buffer->m_map_len = 0;
+    wyini_index_init(&(p_wyini_buffer->m_index)); /* The arrays were in the image, so there is nothing to free. */
+}
+
+
+
+int wyini_compiled_detach(struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    struct S_wyini_buffer copy = *p_wyini_buffer; /* Built on the side, so that nothing changes if this fails. */
+
+    if(p_wyini_buffer->m_buffer_mode != WYINI_MODE_COMPILED)
+        return WYINI_OK;
+    if((copy.m_buffer = (char*)wyini_mem_alloc(&(p_wyini_buffer->m_allocator), p_wyini_buffer->m_buffer_len)) == NULL)
+        return WYINI_MEMORY_ERR;
+    memcpy(copy.m_buffer, p_wyini_buffer->m_buffer, p_wyini_buffer->m_buffer_len);
+    WYINI_STATS_ADD(m_copy_bytes, p_wyini_buffer->m_buffer_len);
+    wyini_index_init(&(copy.m_index));
+    if(wyini_index_build(&copy) != WYINI_OK) {
+        wyini_mem_free(&(p_wyini_buffer->m_allocator), copy.m_buffer, copy.m_buffer_len);
+        return WYINI_MEMORY_ERR;
+    }
+
+    wyini_compiled_close(p_wyini_buffer);
+    p_wyini_buffer->m_buffer = copy.m_buffer;
+    p_wyini_buffer->m_buffer_len = copy.m_buffer_len;
+    p_wyini_buffer->m_buffer_size = copy.m_buffer_len;
+    p_wyini_buffer->m_index = copy.m_index;
+    return WYINI_OK;
+}
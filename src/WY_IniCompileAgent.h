@@ -0,0 +1,103 @@
+/**
+ * @file WY_IniCompileAgent.h
+ * Declares functions for writing and opening compiled images of an INI file.
+ * \n
+ * A compiled image holds the content of the file together with its index exactly as they are laid out in memory: the index entries, the variable and section slot tables, and the sections. Opening an image maps it read-only and points m_buffer and the arrays of m_index into the mapping, so no parsing or allocation is needed and all lookups work unchanged. Processes that open the same image share its pages through the page cache.
+ * \n
+ * The arrays are stored in the byte order and struct layout of the machine that compiled the image, which the header records. An image from a machine with a different layout is rejected, and should be compiled again from the INI file.
+*/
+
+#ifndef _WY_INICOMPILEAGENT_H_
+#define _WY_INICOMPILEAGENT_H_
+
+#include <stdint.h>
+#include "WY_IniDefs.h"
+#include "WY_IniIO.h"
+
+#define WYINI_COMPILED_MAGIC "WYINIBIN" /**< The first 8 bytes of every compiled image. */
+#define WYINI_COMPILED_VERSION 1 /**< Version of the compiled image format. Incremented whenever the layout of the image or of the index structs changes. */
+#define WYINI_COMPILED_BYTE_ORDER 0x01020304u /**< Written in native byte order, so an image from a machine with another byte order does not match. */
+#define WYINI_COMPILED_SEGMENTS 13 /**< The most segments wyini_compiled_segments() returns: the header, then each of the six regions after it followed by its padding. */
+
+/**
+ * The header at the start of a compiled image. The content of the file follows right after it. All offsets are from the start of the image and are multiples of 8.
+ */
+struct S_wyini_compiled_header
+{
+    char m_magic[8]; /**< WYINI_COMPILED_MAGIC, without the terminating 0. */
+    uint32_t m_version; /**< WYINI_COMPILED_VERSION. */
+    uint32_t m_byte_order; /**< WYINI_COMPILED_BYTE_ORDER. */
+    uint32_t m_entry_size; /**< sizeof(struct S_wyini_index_entry). */
+    uint32_t m_section_size; /**< sizeof(struct S_wyini_section). */
+    uint32_t m_image_len; /**< Length of the whole image. */
+    uint32_t m_buffer_len; /**< Length of the file content. */
+    uint32_t m_count; /**< Number of index entries. */
+    uint32_t m_slots_size; /**< Number of slots in each of the variable slot tables. */
+    uint32_t m_section_count; /**< Number of sections. */
+    uint32_t m_names_size; /**< Number of slots in the section name table. */
+    uint32_t m_entries_offset; /**< Offset of the index entries. */
+    uint32_t m_slots_offset; /**< Offset of S_wyini_index::m_slots. */
+    uint32_t m_section_slots_offset; /**< Offset of S_wyini_index::m_section_slots. */
+    uint32_t m_sections_offset; /**< Offset of the sections. */
+    uint32_t m_names_offset; /**< Offset of S_wyini_index::m_names. */
+    uint32_t m_reserved; /**< Always 0. Keeps m_checksum 8-byte aligned. */
+    uint64_t m_checksum; /**< Checksum of the header up to this member, the content and each array, computed by wyini_compiled_checksum(). */
+};
+
+
+/**
+ * Lays out a compiled image of the content and index of an S_wyini_buffer as a list of segments, without copying anything, e.g. to write it to a file or into shared memory.
+ * @param p_wyini_buffer The S_wyini_buffer to compile. Must not hold any written values, i.e. must be flattened.
+ * @param p_header Returns the header of the image. The first segment points at it, so it must stay in place while the segments are used.
+ * @param p_segments Returns the segments of the image, in order. Holds WYINI_COMPILED_SEGMENTS elements.
+ * @param p_count Returns the number of segments.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_compiled_segments(const struct S_wyini_buffer *restrict p_wyini_buffer, struct S_wyini_compiled_header *restrict p_header, struct S_wyini_segment *restrict p_segments, unsigned int *restrict p_count);
+
+
+/**
+ * Writes a compiled image of the content and index of an S_wyini_buffer. The image is saved atomically with wyini_save_file_atomic(), so processes that have the old image open keep using it undisturbed.
+ * @param p_file The file to write the image to.
+ * @param p_wyini_buffer The S_wyini_buffer to compile. Must not hold any written values, i.e. must be flattened.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_compiled_write(const char *restrict const p_file, const struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Opens a compiled image into an empty S_wyini_buffer. The image is mapped where possible, or else read into one allocated block. The header, the bounds of every array and the checksum are verified. The index entries themselves are trusted, so images must only come from wyini_compiled_write().
+ * @param p_file The image file.
+ * @param p_max_size Maximum size of the image.
+ * @param p_wyini_buffer The S_wyini_buffer to open the image into. On success m_buffer_mode is WYINI_MODE_COMPILED.
+ * @return WYINI_OK if success. WYINI_IO_ERR if the file cannot be read or is not a valid image for this machine. Else another negative value defined in WY_IniDefs.h.
+ */
+int wyini_compiled_open(const char *restrict const p_file, const unsigned int p_max_size, struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Opens a compiled image that is already in memory into an empty S_wyini_buffer. The header, the bounds of every array and the checksum are verified as by wyini_compiled_open().
+ * @param p_image The image. It must stay in place until the S_wyini_buffer is closed.
+ * @param p_image_len Length of the image.
+ * @param p_map_len Length of the mapping holding the image, which wyini_compiled_close() unmaps. 0 if the image is one block allocated by the allocator of the S_wyini_buffer, which wyini_compiled_close() frees.
+ * @param p_wyini_buffer The S_wyini_buffer to open the image into. On success m_buffer_mode is WYINI_MODE_COMPILED.
+ * @return WYINI_OK if success. WYINI_IO_ERR if the image is not valid for this machine.
+ */
+int wyini_compiled_attach(char *restrict p_image, const unsigned int p_image_len, const unsigned int p_map_len, struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Releases the image held by an S_wyini_buffer in WYINI_MODE_COMPILED, leaving m_buffer and m_index empty.
+ * @param p_wyini_buffer The S_wyini_buffer holding the image.
+ */
+void wyini_compiled_close(struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Copies the content of an image into an allocated buffer and indexes it, so that it can be written to. The image is released. Does nothing if the S_wyini_buffer is not in WYINI_MODE_COMPILED.
+ * @param p_wyini_buffer The S_wyini_buffer holding the image. On success m_buffer_mode is WYINI_MODE_READ.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h, in which case the S_wyini_buffer is unchanged.
+ */
+int wyini_compiled_detach(struct S_wyini_buffer *restrict p_wyini_buffer);
+
+#endif
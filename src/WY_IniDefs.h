@@ -5,6 +5,10 @@
 #ifndef _WY_INIDEFS_H_
 #define _WY_INIDEFS_H_
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
 #define WYINI_MAX_VAL_LEN 128 /**< The Maximum size a value read from the ini file can be. Values larger than this size will be truncated. Change this value to be able to read larger values. */
 
 #define WYINI_OK 0 /**< Status OK. */
@@ -12,16 +16,170 @@
 #define WYINI_IO_ERR -2 /**< Status NOK caused by system IO error. E.g. failed to find or open file. */
 #define WYINI_NOT_FOUND -3 /**< Status NOK caused by resource not found. E.g. pattern not found. */
 #define WYINI_VAL_NOT_FOUND -4 /**< Status NOK caused by variable not found in the pattern 'var=val'. */
+#define WYINI_TYPE_ERR -5 /**< Status NOK caused by a value that cannot be converted to the requested type. E.g. "abc" read as a number, or a number out of range. */
+#define WYINI_EXISTS -6 /**< Status NOK caused by a variable that already exists. E.g. inserting a variable that is already assigned in the section. */
+#define WYINI_NAME_ERR -7 /**< Status NOK caused by a section, variable or value that cannot be written as a line of its own. E.g. a variable containing '=' or a value containing '\n'. */
+
+#define WYINI_MODE_READ 0 /**< Buffer mode where the file content is copied into a dynamically allocated buffer. */
+#define WYINI_MODE_MMAP 1 /**< Buffer mode where the file is mapped into memory read-only. */
+#define WYINI_MODE_COMPILED 2 /**< Buffer mode where the content and the index are both taken from a compiled image written by wyini_compile(). */
+
+#define WYINI_WATCH_MAX_READERS 64 /**< The maximum number of reader threads registered at the same time with each watched file. */
+
+#define WYINI_TYPED_NONE 0 /**< S_wyini_typed holds nothing. */
+#define WYINI_TYPED_INT64 1 /**< S_wyini_typed holds the value converted by wyini_get_int64(). */
+#define WYINI_TYPED_UINT64 2 /**< S_wyini_typed holds the value converted by wyini_get_uint64(). */
+#define WYINI_TYPED_DOUBLE 3 /**< S_wyini_typed holds the value converted by wyini_get_double(). */
+#define WYINI_TYPED_BOOL 4 /**< S_wyini_typed holds the value converted by wyini_get_bool(). */
+#define WYINI_TYPED_DURATION 5 /**< S_wyini_typed holds the value converted by wyini_get_duration(), in milliseconds. */
+#define WYINI_TYPED_STRING 6 /**< Type of a schema key whose value is kept as a wyini_view without conversion. Never held by S_wyini_typed. */
+
+#define WYINI_INDEX_NONE 0xFFFFFFFFu /**< Marks an empty slot or the end of a chain in S_wyini_index. */
+#define WYINI_INDEX_MAX_THREADS 32 /**< The maximum number of threads, including the calling thread, that parse a large buffer in parallel when it is indexed. Set to 1 to always parse on the calling thread. Threads are not used on Windows. */
+#define WYINI_INDEX_CHUNK_SIZE 1048576 /**< The smallest part of a buffer parsed by each thread when it is indexed, so buffers smaller than twice this are parsed on the calling thread. */
+
+#define WYINI_DIRTY_BLOCK 64 /**< Size of the blocks of m_buffer tracked as changed since the file was last read or saved. Saving the same file writes whole blocks. */
+
+#define WYINI_PHASE_READ 0 /**< Phase timed by the stats and traced by the hooks: reading or mapping a file or image into a handle. */
+#define WYINI_PHASE_INDEX 1 /**< Phase timed by the stats and traced by the hooks: parsing the content of a handle into its index. */
+#define WYINI_PHASE_LOOKUP 2 /**< Phase timed by the stats and traced by the hooks: a get API function, including wyini_get_many() and the typed accessors. */
+#define WYINI_PHASE_WRITE 3 /**< Phase timed by the stats and traced by the hooks: wyini_write_val(), the typed setters, and inserting and deleting variables. */
+#define WYINI_PHASE_SAVE 4 /**< Phase timed by the stats and traced by the hooks: wyini_save() or wyini_save_atomic(), including putting the written values in place. */
+#define WYINI_PHASE_COUNT 5 /**< Number of WYINI_PHASE_* definitions. */
+
+/**
+ * An entry in S_wyini_index. Describes one line in the internal buffer that contains a '='. All offsets index into S_wyini_buffer::m_buffer.
+ */
+struct S_wyini_index_entry
+{
+    unsigned int m_hash; /**< Hash of the variable name. */
+    unsigned int m_var_offset; /**< Offset of the first char of the variable name. This is also the start of the line. */
+    unsigned int m_var_len; /**< Length of the variable name, excluding any whitespace before the '='. 0 if the line has nothing but whitespace before the '='. */
+    unsigned int m_val_offset; /**< Offset of the byte right after the '='. */
+    unsigned int m_val_end; /**< Offset of the byte before the nextline or terminating indicator. This is m_val_offset-1 if nothing follows the '='. */
+    unsigned int m_next; /**< Index of the next entry with the same variable name, in file order. WYINI_INDEX_NONE if there is none. */
+    unsigned int m_section; /**< Index in S_wyini_index::m_sections of the first section with the same name as the section this line is in. */
+    unsigned int m_edit_offset; /**< Offset in S_wyini_buffer::m_edit_buffer of the value written to this line since m_buffer was last flattened. The value here replaces everything from m_val_offset to m_val_end. WYINI_INDEX_NONE if the line is unchanged. */
+    unsigned int m_edit_len; /**< Length of the value at m_edit_offset. */
+};
+
+/**
+ * The converted value of a line, cached by the typed accessors such as wyini_get_int64(). Only one type is held at a time.
+ */
+struct S_wyini_typed
+{
+    int m_type; /**< Type of the value held, one of the WYINI_TYPED_* definitions. WYINI_TYPED_NONE if the line has not been converted since its value last changed. */
+    int m_status; /**< Result of the conversion, WYINI_OK or a negative value defined above. */
+    union
+    {
+        int64_t m_int64; /**< Value of a WYINI_TYPED_INT64. */
+        uint64_t m_uint64; /**< Value of a WYINI_TYPED_UINT64 or WYINI_TYPED_DURATION. */
+        double m_double; /**< Value of a WYINI_TYPED_DOUBLE. */
+        bool m_bool; /**< Value of a WYINI_TYPED_BOOL. */
+    };
+};
+
+/**
+ * A section in S_wyini_index. A section starts with a '[name]' header line and runs until the next header or the end of the buffer. Section 0 is the unnamed section that holds the lines before the first header. All offsets index into S_wyini_buffer::m_buffer.
+ */
+struct S_wyini_section
+{
+    unsigned int m_hash; /**< Hash of the section name. */
+    unsigned int m_name_offset; /**< Offset of the first char of the name, excluding whitespace after the '['. */
+    unsigned int m_name_len; /**< Length of the name, excluding whitespace before the ']'. */
+    unsigned int m_start; /**< Offset of the first line after the header. */
+    unsigned int m_end; /**< Offset right after the last byte of the section. This is the start of the next header or m_buffer_len. */
+    unsigned int m_first_entry; /**< Index in S_wyini_index::m_entries of the first entry in the section. */
+    unsigned int m_entry_count; /**< Number of entries in the section. */
+    unsigned int m_group; /**< Index of the first section with the same name. Sections with the same name are searched as one, in file order. */
+};
+
+/**
+ * Hash index over the 'var=' lines in the internal buffer, built in one pass when the file is opened. Lets variables be located without rescanning the buffer.
+ */
+struct S_wyini_index
+{
+    unsigned int m_count; /**< Number of entries in m_entries. */
+    unsigned int m_entries_size; /**< Number of entries allocated in m_entries. */
+    unsigned int m_slots_size; /**< Number of slots in m_slots. Always a power of 2. */
+    struct S_wyini_index_entry *m_entries; /**< All 'var=' lines, in file order. */
+    unsigned int *m_slots; /**< Open-addressing table holding the index in m_entries of the first line for each variable name. */
+    unsigned int *m_section_slots; /**< Open-addressing table with the same size as m_slots, holding the index in m_entries of the first line for each variable name within each group of same-name sections. */
+    unsigned int *m_tails; /**< Table with the same size as m_slots, holding the index in m_entries of the last line of the chain in each used slot of m_slots, so that appended lines are linked to long chains in one step. Only built once lines are appended to the buffer. NULL otherwise. */
+    unsigned int m_section_count; /**< Number of sections in m_sections. Always at least 1 once built. */
+    unsigned int m_sections_size; /**< Number of sections allocated in m_sections. */
+    unsigned int m_names_size; /**< Number of slots in m_names. Always a power of 2. */
+    struct S_wyini_section *m_sections; /**< All sections, in file order. */
+    unsigned int *m_names; /**< Open-addressing table holding the index in m_sections of the first section for each section name. */
+};
+
+/**
+ * An allocator for the memory held by a handle, passed to wyini_open_with_h(). If m_alloc is NULL, malloc(), realloc() and free() are used. Otherwise m_alloc, m_realloc and m_free must all be set. Every function is passed the size of the block, so simple allocators need not keep track of it.
+ */
+struct S_wyini_allocator
+{
+    void * (*m_alloc)(void *p_ctx, size_t p_size); /**< Allocates a block of p_size bytes aligned for any type. Returns NULL if out of memory. */
+    void * (*m_realloc)(void *p_ctx, void *p_ptr, size_t p_old_size, size_t p_new_size); /**< Resizes a block of p_old_size bytes, moving it if necessary. p_ptr may be NULL, in which case p_old_size is 0. Returns NULL if out of memory, leaving the block unchanged. */
+    void (*m_free)(void *p_ctx, void *p_ptr, size_t p_size); /**< Frees a block of p_size bytes. */
+    void (*m_release)(void *p_ctx); /**< Called after all blocks of the handle have been freed, i.e. by wyini_clean(), wyini_close_h() and before a file is read again into the handle. May be NULL. An arena uses it to release all its memory in one step. */
+    void *m_ctx; /**< Passed to every function. */
+};
+
+/**
+ * Counters kept by the library when it is compiled with WYINI_STATS defined, returned by wyini_get_stats(). They are shared by all handles in the process and count from the start of the process or the last wyini_reset_stats(). All members are uint64_t.
+ */
+struct S_wyini_stats
+{
+    uint64_t m_opens; /**< Files and compiled images opened into a handle. */
+    uint64_t m_bytes_read; /**< Bytes of content read or mapped by those opens. */
+    uint64_t m_bytes_written; /**< Bytes of content saved to files. */
+    uint64_t m_lookups; /**< Variables looked up by the get API functions. wyini_get_many() counts every name. */
+    uint64_t m_hits; /**< Lookups that found a value. */
+    uint64_t m_misses; /**< Lookups that did not find a value, e.g. a missing variable, a variable with no value or a value of the wrong type. */
+    uint64_t m_lines_scanned; /**< Lines compared one by one by lookups and writes whose variable cannot be resolved through the hash index. Divide by m_lookups for the lines scanned per lookup. */
+    uint64_t m_copy_bytes; /**< Bytes copied to put written values in place, i.e. into the edit buffer by writes and into a new buffer when the content is put back together. */
+    uint64_t m_reallocs; /**< Buffers of a handle that were resized, e.g. index tables and the edit buffer growing. */
+    uint64_t m_phase_calls[WYINI_PHASE_COUNT]; /**< Number of times each WYINI_PHASE_* phase ran. */
+    uint64_t m_phase_ns[WYINI_PHASE_COUNT]; /**< Total time spent in each WYINI_PHASE_* phase in nanoseconds, across all threads. */
+};
+
+/**
+ * Identifies the version of a file that was last read or saved, so that a save can tell whether anyone else changed the file since.
+ */
+struct S_wyini_file_id
+{
+    uint64_t m_dev; /**< Device holding the file. */
+    uint64_t m_ino; /**< Inode of the file. Changes when the file is replaced, e.g. by wyini_save_atomic(). */
+    uint64_t m_size; /**< Size of the file. */
+    int64_t m_mtime_sec; /**< Time of the last modification, seconds part. */
+    long m_mtime_nsec; /**< Time of the last modification, nanoseconds part. */
+};
 
 /**
  * The internal buffer structure maintained by WY_IniMgr. 
  */
 struct S_wyini_buffer
 {
-    unsigned int m_max_file_size; /**< Max file size allowed. */
-    unsigned int m_buffer_len; /**< Size of the file content currently in m_buffer. Size of the file content is always capped at m_max_file_size-1. This is to allow us to append a terminating 0 to the last byte. */
-    char * m_buffer; /**< The internal buffer that the content of the file is copied into. The size here is provided by m_buffer_len. */
+    unsigned int m_max_file_size; /**< Max file size allowed when reading a file. */
+    unsigned int m_buffer_len; /**< Size of the file content in m_buffer. */
+    char * m_buffer; /**< The internal buffer that the content of the file is copied into. The size here is provided by m_buffer_len. This is never modified by writes, which are recorded in m_edit_buffer until the buffer is flattened. Lines inserted at the end of the content are the exception, as they leave everything before them in place, and so are written values that kept their length, which are flattened in place. */
+    unsigned int m_buffer_size; /**< Number of bytes allocated in m_buffer when m_buffer_mode is WYINI_MODE_READ. At least m_buffer_len. Grows geometrically as lines are inserted at the end of the content. */
+    int m_buffer_mode; /**< How m_buffer was obtained. WYINI_MODE_READ if it is allocated with m_buffer_len bytes. WYINI_MODE_MMAP if it is a read-only mapping of the file with m_map_len bytes. WYINI_MODE_COMPILED if it and the arrays of m_index point into a compiled image, which is a read-only mapping with m_map_len bytes or, if m_map_len is 0, one allocated block. */
+    unsigned int m_map_len; /**< Length of the mapping in m_buffer when m_buffer_mode is WYINI_MODE_MMAP. */
     char * m_val_buffer; /**< An internal buffer that stores the value of a variable extracted from the file. This will be allocated with a size of WYINI_MAX_VAL_LEN. */  
+    struct S_wyini_index m_index; /**< Index of the variables found in m_buffer. */
+    char * m_edit_buffer; /**< Holds the values written since m_buffer was last flattened. Written values are only ever appended. Each index entry refers to its current value in here. */
+    unsigned int m_edit_len; /**< Number of bytes used in m_edit_buffer. */
+    unsigned int m_edit_size; /**< Number of bytes allocated in m_edit_buffer. */
+    unsigned int m_edit_count; /**< Number of index entries whose value is held in m_edit_buffer. */
+    struct S_wyini_typed *m_typed; /**< Converted values of the lines, with one element for each index entry. NULL until a typed accessor is first called. */
+    unsigned int m_typed_count; /**< Number of elements in m_typed. Matches m_index.m_count while m_typed is allocated. */
+    char *m_file; /**< The file whose content m_buffer held when it was last read or saved, apart from the dirty blocks. NULL if there is none, e.g. for a compiled image. */
+    struct S_wyini_file_id m_file_id; /**< Identifies the version of m_file that was read or saved. */
+    unsigned char *m_dirty; /**< Bitmap with one bit for each WYINI_DIRTY_BLOCK bytes of m_buffer whose content has changed since m_file was read or saved. NULL until a value is first put in place. */
+    unsigned int m_dirty_size; /**< Number of bytes allocated in m_dirty. */
+    bool m_dirty_all; /**< True if the layout of the content changed since m_file was read or saved, e.g. a value changed length or lines were inserted, so the whole file has to be written. */
+    struct S_wyini_allocator m_allocator; /**< Allocates m_buffer when it is allocated, m_val_buffer, the arrays of m_index, m_edit_buffer, m_typed, m_file and m_dirty. */
 };
 
 #endif
\ No newline at end of file
@@ -1,10 +1,27 @@
+#if !defined _OS_WINDOWS_
+#define _POSIX_C_SOURCE 200809L /* Exposes the POSIX file and mmap functions under -std=c17. */
+#endif
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#if !defined _OS_WINDOWS_
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#define WYINI_HAVE_MMAP /**< mmap() is available on this system. */
+#else
+#include <io.h>
+#include <windows.h>
+#endif
 #include "WY_IniIO.h"
 #include "WY_IniDefs.h"
+#include "WY_IniAllocAgent.h"
 
 
-int wyini_read_file(const char *restrict const p_file, const unsigned int p_max_size, unsigned int *restrict p_buffer_len, char *restrict *restrict p_buffer)
+int wyini_read_file(const char *restrict const p_file, const unsigned int p_max_size, unsigned int *restrict p_buffer_len, char *restrict *restrict p_buffer, const struct S_wyini_allocator *restrict p_allocator)
 {
     int return_val = WYINI_IO_ERR;
 
@@ -21,7 +38,7 @@ int wyini_read_file(const char *restrict const p_file, const unsigned int p_max_
         *p_buffer_len = tmp;
     rewind(fp); /* Return to start of file. */
 
-    if((*p_buffer = (char*)malloc(p_max_size)) == NULL) { /* Create buffer to read the data. This can be larger than p_buffer_len. */
+    if((*p_buffer = (char*)wyini_mem_alloc(p_allocator, *p_buffer_len)) == NULL) { /* Create buffer to read the data. Only inserts grow the buffer, and they grow it themselves, so the content size is enough to start with. */
         return_val = WYINI_MEMORY_ERR;
         goto bad_exit;
     }
@@ -35,7 +52,7 @@ int wyini_read_file(const char *restrict const p_file, const unsigned int p_max_
 bad_exit:
     fclose(fp);
     if(*p_buffer != NULL) {
-        free(*p_buffer);
+        wyini_mem_free(p_allocator, *p_buffer, *p_buffer_len);
         *p_buffer = NULL;
     }
     return return_val;
@@ -51,9 +68,271 @@ int wyini_save_file(const char *restrict const p_file, const unsigned int p_buff
     if((fp = fopen(p_file, "wb")) == NULL) /* Create file for writing, overwriting where necessary. */
         return return_val;
 
-    if(fwrite(p_buffer, 1, p_buffer_len, fp) > 0) /* Writes data to file. */
+    if(fwrite(p_buffer, 1, p_buffer_len, fp) == p_buffer_len) /* Writes data to file. Anything less is a failed write. */
         return_val = WYINI_OK;
 
-    fclose(fp);
+    if(fclose(fp) != 0) /* Buffered data is only written out here, so this can fail too. */
+        return_val = WYINI_IO_ERR;
+    return return_val;
+}
+
+
+
+#if !defined _OS_WINDOWS_
+/**
+ * Writes all segments to a file descriptor with writev(), resuming after partial writes and interrupts.
+ * @param p_fd The file descriptor.
+ * @param p_segments The content to write.
+ * @param p_count Number of segments.
+ * @return WYINI_OK if everything was written. WYINI_IO_ERR otherwise.
+ */
+static int wyini_write_segments(const int p_fd, const struct S_wyini_segment *restrict p_segments, const unsigned int p_count)
+{
+    struct iovec iov[WYINI_IOV_BATCH];
+    unsigned int next = 0; /* Next segment to hand to writev(). */
+    int iov_count = 0;
+    int first = 0; /* First iov not yet completely written. */
+
+    while((next < p_count) || (first < iov_count)) {
+        if(first == iov_count) { /* Refill the batch. Only the descriptors are copied, not the content. */
+            first = 0;
+            iov_count = 0;
+            while((next < p_count) && (iov_count < WYINI_IOV_BATCH)) {
+                iov[iov_count].iov_base = (void*)p_segments[next].m_ptr;
+                iov[iov_count].iov_len = p_segments[next].m_len;
+                ++iov_count;
+                ++next;
+            }
+        }
+
+        ssize_t written = writev(p_fd, iov + first, iov_count - first);
+        if(written < 0) {
+            if(errno == EINTR)
+                continue;
+            return WYINI_IO_ERR;
+        }
+        while((first < iov_count) && ((size_t)written >= iov[first].iov_len)) { /* Skip the segments written in full, then the written part of the next one. */
+            written -= (ssize_t)iov[first].iov_len;
+            ++first;
+        }
+        if(first < iov_count) {
+            iov[first].iov_base = (char*)iov[first].iov_base + written;
+            iov[first].iov_len -= (size_t)written;
+        }
+    }
+    return WYINI_OK;
+}
+#endif
+
+
+
+int wyini_save_file_atomic(const char *restrict const p_file, const struct S_wyini_segment *restrict p_segments, const unsigned int p_count)
+{
+    int return_val = WYINI_IO_ERR;
+    const size_t file_len = strlen(p_file);
+    char *restrict tmp_file;
+
+    if((tmp_file = (char*)malloc(file_len + 32)) == NULL) /* Room for the suffix below. */
+        return WYINI_MEMORY_ERR;
+
+#if !defined _OS_WINDOWS_
+    struct stat file_stat;
+    int fd = -1;
+    for(unsigned int attempt=0; (attempt<100) && (fd<0); ++attempt) { /* Another handle may be saving the same file at the same time, so find an unused name. */
+        snprintf(tmp_file, file_len + 32, "%s.%ld.%u.tmp", p_file, (long)getpid(), attempt);
+        if(((fd = open(tmp_file, O_WRONLY|O_CREAT|O_EXCL, 0666)) < 0) && (errno != EEXIST))
+            break;
+    }
+    if(fd < 0)
+        goto do_exit;
+    if(stat(p_file, &file_stat) == 0) /* Keep the permissions of the file being replaced. */
+        fchmod(fd, file_stat.st_mode & 07777);
+
+    if((wyini_write_segments(fd, p_segments, p_count) != WYINI_OK) || (fsync(fd) != 0)) { /* The content must be on disk before the rename makes it visible. */
+        close(fd);
+        goto remove_exit;
+    }
+    if(close(fd) != 0)
+        goto remove_exit;
+    if(rename(tmp_file, p_file) != 0) /* Atomically replaces the file. Readers see either the old or the new content. */
+        goto remove_exit;
+
+    const char *slash = strrchr(p_file, '/'); /* Make the rename itself durable by syncing the directory. Not every file system supports this, so errors are ignored. */
+    if(slash == NULL)
+        fd = open(".", O_RDONLY);
+    else {
+        memcpy(tmp_file, p_file, (size_t)(slash - p_file) + 1);
+        tmp_file[slash - p_file + 1] = 0;
+        fd = open(tmp_file, O_RDONLY);
+    }
+    if(fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    return_val = WYINI_OK;
+    goto do_exit;
+#else
+    FILE *fp = NULL;
+    snprintf(tmp_file, file_len + 32, "%s.%lu.tmp", p_file, (unsigned long)GetCurrentThreadId());
+    if((fp = fopen(tmp_file, "wb")) == NULL)
+        goto do_exit;
+    for(unsigned int i=0; i<p_count; ++i) { /* No writev() here, so write the segments one after the other. */
+        if(fwrite(p_segments[i].m_ptr, 1, p_segments[i].m_len, fp) != p_segments[i].m_len) {
+            fclose(fp);
+            goto remove_exit;
+        }
+    }
+    if((fflush(fp) != 0) || (_commit(_fileno(fp)) != 0)) { /* The content must be on disk before the move makes it visible. */
+        fclose(fp);
+        goto remove_exit;
+    }
+    if(fclose(fp) != 0)
+        goto remove_exit;
+    if(!MoveFileExA(tmp_file, p_file, MOVEFILE_REPLACE_EXISTING|MOVEFILE_WRITE_THROUGH))
+        goto remove_exit;
+    return_val = WYINI_OK;
+    goto do_exit;
+#endif
+
+remove_exit:
+    remove(tmp_file);
+do_exit:
+    free(tmp_file);
     return return_val;
 }
+
+
+
+#if !defined _OS_WINDOWS_
+/**
+ * Fills in the identity of a file from its status.
+ */
+static void wyini_stat_to_id(const struct stat *restrict p_stat, struct S_wyini_file_id *restrict p_id)
+{
+    p_id->m_dev = (uint64_t)p_stat->st_dev;
+    p_id->m_ino = (uint64_t)p_stat->st_ino;
+    p_id->m_size = (uint64_t)p_stat->st_size;
+    p_id->m_mtime_sec = (int64_t)p_stat->st_mtim.tv_sec;
+    p_id->m_mtime_nsec = p_stat->st_mtim.tv_nsec;
+}
+#endif
+
+
+
+int wyini_file_id(const char *restrict const p_file, struct S_wyini_file_id *restrict p_id)
+{
+#if !defined _OS_WINDOWS_
+    struct stat file_stat;
+
+    if(stat(p_file, &file_stat) != 0)
+        return WYINI_IO_ERR;
+    wyini_stat_to_id(&file_stat, p_id);
+    return WYINI_OK;
+#else
+    (void)p_file;
+    (void)p_id;
+    return WYINI_IO_ERR;
+#endif
+}
+
+
+
+int wyini_patch_file(const char *restrict const p_file, const struct S_wyini_file_id *restrict p_id, const char *restrict const p_buffer, const struct S_wyini_segment *restrict p_segments, const unsigned int p_count, struct S_wyini_file_id *restrict p_new_id)
+{
+#if !defined _OS_WINDOWS_
+    int return_val = WYINI_IO_ERR;
+    struct stat file_stat;
+    struct S_wyini_file_id id;
+
+    const int fd = open(p_file, O_WRONLY); /* No O_TRUNC, so everything outside the segments stays in place. */
+    if(fd < 0)
+        return return_val;
+    if(fstat(fd, &file_stat) != 0)
+        goto do_exit;
+    wyini_stat_to_id(&file_stat, &id);
+    if((id.m_dev != p_id->m_dev) || (id.m_ino != p_id->m_ino) || (id.m_size != p_id->m_size) || (id.m_mtime_sec != p_id->m_mtime_sec) || (id.m_mtime_nsec != p_id->m_mtime_nsec)) { /* Someone else changed the file, so the bytes outside the segments may not match the buffer any more. */
+        return_val = WYINI_NOT_FOUND;
+        goto do_exit;
+    }
+
+    for(unsigned int i=0; i<p_count; ++i) {
+        const char *ptr = p_segments[i].m_ptr;
+        size_t len = p_segments[i].m_len;
+        while(len > 0) { /* Resume after partial writes and interrupts. */
+            const ssize_t written = pwrite(fd, ptr, len, (off_t)(ptr - p_buffer));
+            if(written < 0) {
+                if(errno == EINTR)
+                    continue;
+                goto do_exit;
+            }
+            ptr += written;
+            len -= (size_t)written;
+        }
+    }
+    if(fstat(fd, &file_stat) != 0) /* The write moved the modification time on, so identify the new version. */
+        goto do_exit;
+    wyini_stat_to_id(&file_stat, p_new_id);
+    return_val = WYINI_OK;
+
+do_exit:
+    if((close(fd) != 0) && (return_val == WYINI_OK))
+        return_val = WYINI_IO_ERR;
+    return return_val;
+#else
+    (void)p_file;
+    (void)p_id;
+    (void)p_buffer;
+    (void)p_segments;
+    (void)p_count;
+    (void)p_new_id;
+    return WYINI_IO_ERR;
+#endif
+}
+
+
+
+int wyini_map_file(const char *restrict const p_file, const unsigned int p_max_size, unsigned int *restrict p_buffer_len, char *restrict *restrict p_buffer)
+{
+#if defined WYINI_HAVE_MMAP
+    int return_val = WYINI_IO_ERR;
+    struct stat file_stat;
+    void *map;
+
+    const int fd = open(p_file, O_RDONLY);
+    if(fd < 0)
+        return return_val;
+    if(fstat(fd, &file_stat) != 0)
+        goto do_exit;
+    if((file_stat.st_size<1) || (file_stat.st_size>p_max_size)) /* Exit if too small or larger than the defined maximum. */
+        goto do_exit;
+
+    if((map = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) /* Writes never modify the buffer, so the mapping can be read-only. */
+        goto do_exit;
+
+    *p_buffer_len = (unsigned int)file_stat.st_size;
+    *p_buffer = (char*)map;
+    return_val = WYINI_OK;
+
+do_exit:
+    close(fd); /* The mapping stays valid after the descriptor is closed. */
+    return return_val;
+#else
+    (void)p_file;
+    (void)p_max_size;
+    (void)p_buffer_len;
+    (void)p_buffer;
+    return WYINI_IO_ERR;
+#endif
+}
+
+
+
+void wyini_unmap_file(const unsigned int p_map_len, char *restrict p_buffer)
+{
+#if defined WYINI_HAVE_MMAP
+    munmap(p_buffer, p_map_len);
+#else
+    (void)p_map_len;
+    (void)p_buffer;
+#endif
+}
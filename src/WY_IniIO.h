@@ -5,6 +5,19 @@
 #ifndef _WY_INIIO_H_
 #define _WY_INIIO_H_
 
+#include "WY_IniDefs.h"
+
+#define WYINI_IOV_BATCH 64 /**< Number of segments handed to each writev() call by wyini_save_file_atomic(). */
+
+/**
+ * A piece of content to write to a file. Content that is not in one piece in memory is saved as a list of these.
+ */
+struct S_wyini_segment
+{
+    const char *m_ptr; /**< Start of the content. */
+    unsigned int m_len; /**< Length of the content. */
+};
+
 /**
  * Opens a file and reads the content into a buffer. Then closes the file. Note that the buffer is dynamically allocated by this function, so it is necessary for the caller to deallocate the buffer.
  * Example Usage: <br>
@@ -12,7 +25,7 @@
  * unsigned int buffer_len;
  * unsigned char *buffer;
  * 
- * if(wyini_read_file("filename", 1024, &buffer_len, &buffer) == 0) 
+ * if(wyini_read_file("filename", 1024, &buffer_len, &buffer, NULL) == 0) 
  *  printf("Read %u chars.\n", buffer_len);
  * // process buffer here
  * // .....
@@ -22,10 +35,11 @@
  * @param p_file The file to open.
  * @param p_max_size Maximum size of the file to process. The max size that is read is p_max_size-1. E.g. 1024*1024 will limit the file to 1MB and the total size that is read is (1024*1024)-1. If the file's content exceeds this size then this function will return exit and return failure.
  * @param p_buffer_len Returns the length of the content read from the file.
- * @param p_buffer Returns a buffer of size p_buffer_len with content read from the file. Pass in an uninitialised pointer address here and the buffer will be dynamically allocated with the value of p_max_size. Hence it is necessary to deallocate this buffer once all parsing operations are completed. The max size is determined by p_max_size and only p_max_size-1 will be read into the buffer. p_buffer[p_max_size-1] will be set to 0.
+ * @param p_buffer Returns a buffer of size p_buffer_len with content read from the file. Pass in an uninitialised pointer address here and the buffer will be dynamically allocated with p_buffer_len bytes. Hence it is necessary to deallocate this buffer once all parsing operations are completed.
+ * @param p_allocator Allocates the buffer, which must then be freed with wyini_mem_free() and the same allocator. NULL uses malloc().
  * @return WYINI_OK if success. Else negative value defined in WY_IniDefs.h if error encountered. 
  */
-int wyini_read_file(const char *restrict const p_file, const unsigned int p_max_size, unsigned int *restrict p_buffer_len, char *restrict *restrict p_buffer);
+int wyini_read_file(const char *restrict const p_file, const unsigned int p_max_size, unsigned int *restrict p_buffer_len, char *restrict *restrict p_buffer, const struct S_wyini_allocator *restrict p_allocator);
 
 
 /**
@@ -37,4 +51,56 @@ int wyini_read_file(const char *restrict const p_file, const unsigned int p_max_
  */
 int wyini_save_file(const char *restrict const p_file, const unsigned int p_buffer_len, const char *restrict const p_buffer);
 
+
+/**
+ * Saves data into a file atomically and durably. The data is written to a temporary file in the same directory, synced to disk and then renamed over p_file, so p_file always holds either its complete old content or the complete new content, even if the system crashes during the save. The permissions of an existing p_file are kept.
+ * On POSIX systems the segments are written with writev() straight from where they are, without first being copied into one buffer.
+ * @param p_file The file name.
+ * @param p_segments The content to write, in order.
+ * @param p_count Number of segments.
+ * @return WYINI_OK if success. Else negative value defined in WY_IniDefs.h if error encountered, in which case p_file is unchanged.
+ */
+int wyini_save_file_atomic(const char *restrict const p_file, const struct S_wyini_segment *restrict p_segments, const unsigned int p_count);
+
+
+/**
+ * Gets the identity of the current version of a file.
+ * @param p_file The file name.
+ * @param p_id Returns the identity.
+ * @return WYINI_OK if success. WYINI_IO_ERR if the file cannot be found, and always on Windows.
+ */
+int wyini_file_id(const char *restrict const p_file, struct S_wyini_file_id *restrict p_id);
+
+
+/**
+ * Overwrites parts of a file in place with pwrite(), leaving its length and the rest of its content as they are. The file is only written if it is still the version identified by p_id, i.e. nobody replaced, resized or modified it since.
+ * @param p_file The file name.
+ * @param p_id Identity of the version of the file that p_buffer matches apart from the segments.
+ * @param p_buffer The full content of the file. The segments point into it, and each is written at its offset from p_buffer.
+ * @param p_segments The parts to write.
+ * @param p_count Number of segments. May be 0, in which case only the identity is checked.
+ * @param p_new_id Returns the identity of the file after the write.
+ * @return WYINI_OK if success. WYINI_NOT_FOUND if the file is not the version identified by p_id, in which case it is unchanged. Else a negative value defined in WY_IniDefs.h if error encountered, in which case the file may be partly written. Always WYINI_IO_ERR on Windows.
+ */
+int wyini_patch_file(const char *restrict const p_file, const struct S_wyini_file_id *restrict p_id, const char *restrict const p_buffer, const struct S_wyini_segment *restrict p_segments, const unsigned int p_count, struct S_wyini_file_id *restrict p_new_id);
+
+
+/**
+ * Maps a file into memory instead of reading it into a buffer. The mapping is private and read-only, and exactly the size of the file.
+ * @param p_file The file to map.
+ * @param p_max_size Maximum size of the file to process. Same as in wyini_read_file().
+ * @param p_buffer_len Returns the length of the file, which is also the length of the mapping.
+ * @param p_buffer Returns the mapped buffer. Release it with wyini_unmap_file().
+ * @return WYINI_OK if success. WYINI_IO_ERR if the file cannot be mapped, including on systems without mmap(). The caller can then fall back to wyini_read_file().
+ */
+int wyini_map_file(const char *restrict const p_file, const unsigned int p_max_size, unsigned int *restrict p_buffer_len, char *restrict *restrict p_buffer);
+
+
+/**
+ * Releases a buffer returned by wyini_map_file().
+ * @param p_map_len The length of the mapping as returned by wyini_map_file().
+ * @param p_buffer The mapped buffer.
+ */
+void wyini_unmap_file(const unsigned int p_map_len, char *restrict p_buffer);
+
 #endif
\ No newline at end of file
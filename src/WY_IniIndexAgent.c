@@ -0,0 +1,688 @@
+/**
+ * @file WY_IniIndexAgent.c
+*/
+
+#if !defined _OS_WINDOWS_
+#define _POSIX_C_SOURCE 200809L /* Exposes the POSIX thread functions and sysconf() under -std=c17. */
+#define WYINI_INDEX_HAVE_THREADS /**< Large buffers are parsed by several threads. */
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "WY_IniIndexAgent.h"
+#include "WY_IniParseAgent.h"
+#include "WY_IniAllocAgent.h"
+#if defined WYINI_INDEX_HAVE_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+
+/**
+ * A part of the buffer parsed by one thread in wyini_index_build(). It starts at the start of a line and ends right after a nextline or terminating char, or at the end of the buffer.
+ */
+struct S_wyini_index_chunk
+{
+    const struct S_wyini_buffer *m_wyini_buffer; /**< The buffer being indexed. */
+    unsigned int m_start; /**< Offset of the first line of the chunk. */
+    unsigned int m_end; /**< Offset right after the last line of the chunk. */
+    struct S_wyini_index m_index; /**< The entries and sections found in the chunk. Section 0 is the part of the section the chunk starts in, which may have begun in an earlier chunk. */
+    int m_status; /**< WYINI_OK once the chunk is parsed. */
+#if defined WYINI_INDEX_HAVE_THREADS
+    pthread_t m_thread; /**< The thread parsing the chunk. */
+    bool m_started; /**< true if m_thread was started. */
+#endif
+};
+
+
+unsigned int wyini_index_hash(const unsigned int p_var_len, const char *restrict const p_var)
+{
+    unsigned int hash = 2166136261u;
+    for(unsigned int i=0; i<p_var_len; ++i) {
+        hash ^= (unsigned char)p_var[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+
+/**
+ * Mixes a section into the hash of a variable name, so that the same variable in different sections is spread over different slots of m_section_slots.
+ * @param p_hash Hash of the variable name.
+ * @param p_section Index of the section group.
+ * @return The combined hash value.
+ */
+static unsigned int wyini_index_section_hash(const unsigned int p_hash, const unsigned int p_section)
+{
+    return p_hash ^ ((p_section + 1) * 2654435761u);
+}
+
+
+
+/**
+ * Makes room for one more element at the end of a dynamically allocated array, doubling its size where necessary.
+ * @param p_allocator The allocator of the array.
+ * @param p_array The array. May be NULL if nothing is allocated yet.
+ * @param p_size Address of the allocated number of elements. Updated if the array grows.
+ * @param p_count The number of elements in use.
+ * @param p_elem_size Size of one element.
+ * @return The array, which may have moved. NULL if memory allocation failed, in which case p_array is still valid and unchanged.
+ */
+static void * wyini_index_reserve(const struct S_wyini_allocator *restrict p_allocator, void *restrict p_array, unsigned int *restrict p_size, const unsigned int p_count, const size_t p_elem_size)
+{
+    if(p_count < *p_size)
+        return p_array;
+
+    const unsigned int new_size = (*p_size == 0) ? 16 : *p_size*2; /* Out of space. Double the size of the array. */
+    void *tmp = wyini_mem_realloc(p_allocator, p_array, (size_t)*p_size*p_elem_size, new_size*p_elem_size);
+    if(tmp != NULL)
+        *p_size = new_size;
+    return tmp;
+}
+
+
+
+/**
+ * Appends a section to m_sections and starts it at the given offsets. The previous section, if any, is closed at p_header_offset.
+ * @param p_index The index to append to.
+ * @param p_allocator The allocator of the index.
+ * @param p_header_offset Offset of the header line, which is where the previous section ends.
+ * @param p_start_offset Offset of the first line after the header.
+ * @param p_name_offset Offset of the name.
+ * @param p_name_len Length of the name.
+ * @param p_buffer The buffer holding the name.
+ * @return WYINI_OK if success. WYINI_MEMORY_ERR if memory allocation failed.
+ */
+static int wyini_index_add_section(struct S_wyini_index *restrict p_index, const struct S_wyini_allocator *restrict p_allocator, const unsigned int p_header_offset, const unsigned int p_start_offset, const unsigned int p_name_offset, const unsigned int p_name_len, const char *restrict const p_buffer)
+{
+    struct S_wyini_section *sections;
+    if((sections = (struct S_wyini_section*)wyini_index_reserve(p_allocator, p_index->m_sections, &(p_index->m_sections_size), p_index->m_section_count, sizeof(struct S_wyini_section))) == NULL)
+        return WYINI_MEMORY_ERR;
+    p_index->m_sections = sections;
+
+    if(p_index->m_section_count > 0) { /* Close the previous section. */
+        struct S_wyini_section *restrict previous = p_index->m_sections + p_index->m_section_count - 1;
+        previous->m_end = p_header_offset;
+        previous->m_entry_count = p_index->m_count - previous->m_first_entry;
+    }
+
+    struct S_wyini_section *restrict section = p_index->m_sections + p_index->m_section_count++;
+    section->m_hash = wyini_index_hash(p_name_len, p_buffer + p_name_offset);
+    section->m_name_offset = p_name_offset;
+    section->m_name_len = p_name_len;
+    section->m_start = p_start_offset;
+    section->m_end = p_start_offset;
+    section->m_first_entry = p_index->m_count;
+    section->m_entry_count = 0;
+    section->m_group = p_index->m_section_count - 1;
+    return WYINI_OK;
+}
+
+
+
+/**
+ * Returns the smallest power of 2 that is at least 16 and keeps the load factor of a table with p_count items at or below 0.5.
+ */
+static unsigned int wyini_index_table_size(const unsigned int p_count)
+{
+    unsigned int size = 16;
+    while(size < p_count*2)
+        size *= 2;
+    return size;
+}
+
+
+
+void wyini_index_init(struct S_wyini_index *restrict p_index)
+{
+    p_index->m_count = 0;
+    p_index->m_entries_size = 0;
+    p_index->m_slots_size = 0;
+    p_index->m_entries = NULL;
+    p_index->m_slots = NULL;
+    p_index->m_section_slots = NULL;
+    p_index->m_tails = NULL;
+    p_index->m_section_count = 0;
+    p_index->m_sections_size = 0;
+    p_index->m_names_size = 0;
+    p_index->m_sections = NULL;
+    p_index->m_names = NULL;
+}
+
+
+
+/**
+ * Pass 1 of wyini_index_build() over a range of whole lines: records every line with a 'var=' pattern and every section header in file order, then closes the last section at the end of the range.
+ * @param p_index The index to append to. Must already hold at least one section, which the lines before the first header belong to.
+ * @param p_allocator The allocator of the index.
+ * @param p_start_offset Offset of the first line.
+ * @param p_end_offset Offset right after the last line. No line may cross it.
+ * @param p_wyini_buffer The buffer holding the lines.
+ * @return WYINI_OK if success. WYINI_MEMORY_ERR if memory allocation failed.
+ */
+static int wyini_index_scan(struct S_wyini_index *restrict p_index, const struct S_wyini_allocator *restrict p_allocator, const unsigned int p_start_offset, const unsigned int p_end_offset, const struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    const char *restrict buffer = p_wyini_buffer->m_buffer;
+    const unsigned int max_len = p_wyini_buffer->m_buffer_len;
+    struct S_wyini_index_entry *entry;
+    unsigned int equal_sign = 0;
+    unsigned int start_offset = p_start_offset;
+    unsigned int end_offset = 0;
+    unsigned int nextline_len = 0;
+    unsigned int var_end = 0;
+    unsigned int name_offset = 0;
+    unsigned int name_len = 0;
+
+    while(start_offset < p_end_offset) {
+        equal_sign = wyini_find_delim(start_offset, true, p_wyini_buffer); /* Stops at the first '=' or the end of the line, whichever comes first. */
+
+        /* Continue looking for the end of the line from where the search above stopped, since there is no nextline indicator before that. */
+        nextline_len = 1 + wyini_get_nextline((equal_sign < max_len) ? equal_sign : start_offset, &end_offset, p_wyini_buffer);
+
+        if(wyini_is_header(start_offset, end_offset, &name_offset, &name_len, buffer)) {
+            if(wyini_index_add_section(p_index, p_allocator, start_offset, end_offset + nextline_len, name_offset, name_len, buffer) != WYINI_OK)
+                return WYINI_MEMORY_ERR;
+        }
+
+        if((equal_sign < max_len) && (buffer[equal_sign] == '=')) {
+            var_end = equal_sign;
+            while((var_end > start_offset) && (buffer[var_end-1] == ' ')) /* Exclude whitespace between the variable and '='. */
+                --var_end;
+            /* Lines with no variable name are recorded as well, so that every line a write can change has an entry. */
+            if((entry = (struct S_wyini_index_entry*)wyini_index_reserve(p_allocator, p_index->m_entries, &(p_index->m_entries_size), p_index->m_count, sizeof(struct S_wyini_index_entry))) == NULL)
+                return WYINI_MEMORY_ERR;
+            p_index->m_entries = entry;
+            entry = p_index->m_entries + p_index->m_count++;
+            entry->m_var_offset = start_offset;
+            entry->m_var_len = var_end - start_offset;
+            entry->m_hash = wyini_index_hash(entry->m_var_len, buffer + start_offset);
+            entry->m_val_offset = equal_sign + 1;
+            entry->m_val_end = end_offset;
+            entry->m_next = WYINI_INDEX_NONE;
+            entry->m_section = p_index->m_section_count - 1;
+            entry->m_edit_offset = WYINI_INDEX_NONE;
+            entry->m_edit_len = 0;
+        }
+        start_offset = end_offset + nextline_len; /* Move on to the next line, skipping the nextline characters. */
+    }
+    p_index->m_sections[p_index->m_section_count-1].m_end = p_end_offset; /* Close the last section. */
+    p_index->m_sections[p_index->m_section_count-1].m_entry_count = p_index->m_count - p_index->m_sections[p_index->m_section_count-1].m_first_entry;
+    return WYINI_OK;
+}
+
+
+
+/**
+ * Parses one chunk into its own index, allocated with malloc() since allocators need not be thread-safe. Runs on its own thread for every chunk but the first.
+ * @param p_arg The S_wyini_index_chunk to parse.
+ * @return Always NULL. The result is in m_status.
+ */
+static void * wyini_index_chunk_thread(void *p_arg)
+{
+    struct S_wyini_index_chunk *restrict chunk = (struct S_wyini_index_chunk*)p_arg;
+
+    chunk->m_status = wyini_index_add_section(&(chunk->m_index), NULL, chunk->m_start, chunk->m_start, chunk->m_start, 0, chunk->m_wyini_buffer->m_buffer); /* Stands in for the section the chunk starts in. */
+    if(chunk->m_status == WYINI_OK)
+        chunk->m_status = wyini_index_scan(&(chunk->m_index), NULL, chunk->m_start, chunk->m_end, chunk->m_wyini_buffer);
+    return NULL;
+}
+
+
+
+/**
+ * Splits a buffer into chunks of whole lines to be parsed in parallel. Each thread gets at least WYINI_INDEX_CHUNK_SIZE bytes, and there are no more chunks than WYINI_INDEX_MAX_THREADS or the number of CPUs online.
+ * @param p_wyini_buffer The buffer to split.
+ * @param p_chunks Returns the chunks in file order. Must hold WYINI_INDEX_MAX_THREADS chunks.
+ * @return Number of chunks. 1 if the buffer is parsed on the calling thread only.
+ */
+static unsigned int wyini_index_split(const struct S_wyini_buffer *restrict p_wyini_buffer, struct S_wyini_index_chunk *restrict p_chunks)
+{
+    const unsigned int max_len = p_wyini_buffer->m_buffer_len;
+    unsigned int count = max_len / WYINI_INDEX_CHUNK_SIZE;
+    unsigned int chunk_count = 0;
+    unsigned int start_offset = 0;
+
+#if defined WYINI_INDEX_HAVE_THREADS
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if((cpus > 0) && (count > (unsigned long)cpus))
+        count = (unsigned int)cpus;
+#else
+    count = 1;
+#endif
+    if(count > WYINI_INDEX_MAX_THREADS)
+        count = WYINI_INDEX_MAX_THREADS;
+    if(count == 0)
+        count = 1;
+
+    for(unsigned int i=1; i<=count; ++i) {
+        unsigned int end_offset = max_len;
+        if(i < count) { /* Move the even split point on to the start of the next line. */
+            end_offset = wyini_find_delim((unsigned int)((uint64_t)max_len*i/count), false, p_wyini_buffer);
+            if(end_offset < max_len)
+                ++end_offset;
+        }
+        if((end_offset <= start_offset) && (chunk_count > 0)) /* A long line spans the whole share of this chunk. */
+            continue;
+        memset(p_chunks + chunk_count, 0, sizeof(struct S_wyini_index_chunk));
+        p_chunks[chunk_count].m_wyini_buffer = p_wyini_buffer;
+        p_chunks[chunk_count].m_start = start_offset;
+        p_chunks[chunk_count].m_end = end_offset;
+        wyini_index_init(&(p_chunks[chunk_count].m_index));
+        ++chunk_count;
+        start_offset = end_offset;
+    }
+    return chunk_count;
+}
+
+
+
+/**
+ * Appends the entries and sections of a parsed chunk to the index of the chunks before it. Section 0 of the chunk continues the last section of the index.
+ * @param p_index The index to append to. Must have room for all the entries and sections.
+ * @param p_chunk The index of the chunk.
+ */
+static void wyini_index_merge(struct S_wyini_index *restrict p_index, const struct S_wyini_index *restrict p_chunk)
+{
+    const unsigned int entry_base = p_index->m_count;
+    const unsigned int section_base = p_index->m_section_count - 1;
+    struct S_wyini_section *restrict last = p_index->m_sections + section_base;
+
+    if(p_chunk->m_count > 0) /* m_entries is NULL if the chunk has no entries. */
+        memcpy(p_index->m_entries + entry_base, p_chunk->m_entries, p_chunk->m_count*sizeof(struct S_wyini_index_entry));
+    for(unsigned int i=entry_base; i<entry_base+p_chunk->m_count; ++i)
+        p_index->m_entries[i].m_section += section_base;
+    p_index->m_count += p_chunk->m_count;
+
+    last->m_end = p_chunk->m_sections[0].m_end;
+    last->m_entry_count += p_chunk->m_sections[0].m_entry_count;
+    for(unsigned int i=1; i<p_chunk->m_section_count; ++i) {
+        struct S_wyini_section *restrict section = p_index->m_sections + p_index->m_section_count++;
+        *section = p_chunk->m_sections[i];
+        section->m_first_entry += entry_base;
+        section->m_group = section_base + i;
+    }
+}
+
+
+
+/**
+ * Probes m_names for the slot of a section's name.
+ * @return The slot holding the first section with the same name, or the empty slot where it belongs if there is none.
+ */
+static unsigned int wyini_index_probe_section(const struct S_wyini_index *restrict p_index, const struct S_wyini_section *restrict p_section, const char *restrict const p_buffer)
+{
+    const unsigned int mask = p_index->m_names_size - 1;
+    unsigned int slot = p_section->m_hash & mask;
+
+    while(p_index->m_names[slot] != WYINI_INDEX_NONE) {
+        const struct S_wyini_section *restrict other = p_index->m_sections + p_index->m_names[slot];
+        if((other->m_hash == p_section->m_hash) && (other->m_name_len == p_section->m_name_len) && (memcmp(p_buffer + other->m_name_offset, p_buffer + p_section->m_name_offset, p_section->m_name_len) == 0))
+            break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+
+
+/**
+ * Probes m_slots for the slot of an entry's variable.
+ * @return The slot holding an entry with the same variable, or the empty slot where it belongs if there is none.
+ */
+static unsigned int wyini_index_probe_var(const struct S_wyini_index *restrict p_index, const struct S_wyini_index_entry *restrict p_entry, const char *restrict const p_buffer)
+{
+    const unsigned int mask = p_index->m_slots_size - 1;
+    unsigned int slot = p_entry->m_hash & mask;
+
+    while(p_index->m_slots[slot] != WYINI_INDEX_NONE) {
+        const struct S_wyini_index_entry *restrict other = p_index->m_entries + p_index->m_slots[slot];
+        if((other->m_hash == p_entry->m_hash) && (other->m_var_len == p_entry->m_var_len) && (memcmp(p_buffer + other->m_var_offset, p_buffer + p_entry->m_var_offset, p_entry->m_var_len) == 0))
+            break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+
+
+/**
+ * Probes m_section_slots for the slot of an entry's variable within its section group. m_section of the entry must already be the group.
+ * @return The slot holding an entry with the same variable in the same group, or the empty slot where it belongs if there is none.
+ */
+static unsigned int wyini_index_probe_section_var(const struct S_wyini_index *restrict p_index, const struct S_wyini_index_entry *restrict p_entry, const char *restrict const p_buffer)
+{
+    const unsigned int mask = p_index->m_slots_size - 1;
+    unsigned int slot = wyini_index_section_hash(p_entry->m_hash, p_entry->m_section) & mask;
+
+    while(p_index->m_section_slots[slot] != WYINI_INDEX_NONE) {
+        const struct S_wyini_index_entry *restrict other = p_index->m_entries + p_index->m_section_slots[slot];
+        if((other->m_section == p_entry->m_section) && (other->m_hash == p_entry->m_hash) && (other->m_var_len == p_entry->m_var_len) && (memcmp(p_buffer + other->m_var_offset, p_buffer + p_entry->m_var_offset, p_entry->m_var_len) == 0))
+            break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+
+
+/**
+ * Passes 2 and 3 of wyini_index_build(): groups the sections by name and fills the hash tables from m_sections and m_entries, replacing any tables already built. The tables are sized to keep the load factor at or below 0.5.
+ * @param p_index The index. Its entries may refer to their section either by index in m_sections or by group, as left by an earlier call.
+ * @param p_allocator The allocator of the index.
+ * @param p_buffer The buffer holding the names.
+ * @return WYINI_OK if success. WYINI_MEMORY_ERR if memory allocation failed, in which case the index is unchanged.
+ */
+static int wyini_index_tables(struct S_wyini_index *restrict p_index, const struct S_wyini_allocator *restrict p_allocator, const char *restrict const p_buffer)
+{
+    const unsigned int names_size = wyini_index_table_size(p_index->m_section_count);
+    const unsigned int slots_size = wyini_index_table_size(p_index->m_count);
+    unsigned int *names = (unsigned int*)wyini_mem_alloc(p_allocator, names_size*sizeof(unsigned int));
+    unsigned int *slots = (names == NULL) ? NULL : (unsigned int*)wyini_mem_alloc(p_allocator, slots_size*sizeof(unsigned int));
+    unsigned int *section_slots = (slots == NULL) ? NULL : (unsigned int*)wyini_mem_alloc(p_allocator, slots_size*sizeof(unsigned int));
+    unsigned int slot;
+    unsigned int i;
+
+    if(section_slots == NULL) {
+        if(slots != NULL)
+            wyini_mem_free(p_allocator, slots, slots_size*sizeof(unsigned int));
+        if(names != NULL)
+            wyini_mem_free(p_allocator, names, names_size*sizeof(unsigned int));
+        return WYINI_MEMORY_ERR;
+    }
+    if(p_index->m_names != NULL) /* All three tables are allocated together. */
+        wyini_mem_free(p_allocator, p_index->m_names, p_index->m_names_size*sizeof(unsigned int));
+    if(p_index->m_slots != NULL) {
+        wyini_mem_free(p_allocator, p_index->m_slots, p_index->m_slots_size*sizeof(unsigned int));
+        wyini_mem_free(p_allocator, p_index->m_section_slots, p_index->m_slots_size*sizeof(unsigned int));
+    }
+    if(p_index->m_tails != NULL) { /* Built again by the next append. */
+        wyini_mem_free(p_allocator, p_index->m_tails, p_index->m_slots_size*sizeof(unsigned int));
+        p_index->m_tails = NULL;
+    }
+    p_index->m_names = names;
+    p_index->m_names_size = names_size;
+    p_index->m_slots = slots;
+    p_index->m_section_slots = section_slots;
+    p_index->m_slots_size = slots_size;
+    memset(p_index->m_names, 0xFF, names_size*sizeof(unsigned int)); /* All bytes 0xFF sets every slot to WYINI_INDEX_NONE. */
+    memset(p_index->m_slots, 0xFF, slots_size*sizeof(unsigned int));
+    memset(p_index->m_section_slots, 0xFF, slots_size*sizeof(unsigned int));
+
+    for(i=0; i<p_index->m_section_count; ++i) { /* Pass 2: Group sections by name. The first section with each name goes in m_names. */
+        struct S_wyini_section *restrict section = p_index->m_sections + i;
+        slot = wyini_index_probe_section(p_index, section, p_buffer);
+        section->m_group = (p_index->m_names[slot] == WYINI_INDEX_NONE) ? i : p_index->m_names[slot];
+        if(p_index->m_names[slot] == WYINI_INDEX_NONE)
+            p_index->m_names[slot] = i;
+    }
+
+    i = p_index->m_count;
+    while(i-- > 0) { /* Pass 3: Insert in reverse so that each slot ends up pointing at the first line for its variable, chained to the later ones in file order. */
+        struct S_wyini_index_entry *restrict entry = p_index->m_entries + i;
+        entry->m_section = p_index->m_sections[entry->m_section].m_group; /* Same-name sections are searched as one. The group of a group is itself, so this also holds for entries already grouped. */
+
+        slot = wyini_index_probe_var(p_index, entry, p_buffer);
+        entry->m_next = p_index->m_slots[slot]; /* Same variable found in a later line, or WYINI_INDEX_NONE. Take its place at the head of the chain. */
+        p_index->m_slots[slot] = i;
+
+        slot = wyini_index_probe_section_var(p_index, entry, p_buffer); /* Same again, per section group. */
+        p_index->m_section_slots[slot] = i;
+    }
+    return WYINI_OK;
+}
+
+
+
+int wyini_index_build(struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    struct S_wyini_index *restrict index = &(p_wyini_buffer->m_index);
+    const struct S_wyini_allocator *restrict allocator = &(p_wyini_buffer->m_allocator);
+    const char *restrict buffer = p_wyini_buffer->m_buffer;
+    struct S_wyini_index_chunk chunks[WYINI_INDEX_MAX_THREADS];
+    struct S_wyini_index_entry *entry;
+    unsigned int chunk_count = 0;
+    unsigned int entry_count;
+    unsigned int section_count;
+    unsigned int i;
+    int return_val = WYINI_MEMORY_ERR;
+
+    wyini_index_clean(index, allocator);
+    if(wyini_index_add_section(index, allocator, 0, 0, 0, 0, buffer) != WYINI_OK) /* The unnamed section before the first header. */
+        goto bad_exit;
+
+    /* Pass 1: Record every line with a 'var=' pattern and every section header in file order. Large buffers are split into chunks of whole lines, which are parsed in parallel into their own indexes and then appended in file order, so the result is the same as parsing on one thread. The calling thread parses the first chunk straight into the index. */
+    chunk_count = wyini_index_split(p_wyini_buffer, chunks);
+#if defined WYINI_INDEX_HAVE_THREADS
+    for(i=1; i<chunk_count; ++i)
+        chunks[i].m_started = (pthread_create(&(chunks[i].m_thread), NULL, wyini_index_chunk_thread, chunks + i) == 0);
+#endif
+    return_val = wyini_index_scan(index, allocator, chunks[0].m_start, chunks[0].m_end, p_wyini_buffer);
+    entry_count = index->m_count;
+    section_count = index->m_section_count;
+    for(i=1; i<chunk_count; ++i) {
+#if defined WYINI_INDEX_HAVE_THREADS
+        if(chunks[i].m_started)
+            pthread_join(chunks[i].m_thread, NULL);
+        else
+#endif
+            wyini_index_chunk_thread(chunks + i); /* No thread could be started for the chunk, so parse it here. */
+        if(chunks[i].m_status != WYINI_OK)
+            return_val = chunks[i].m_status;
+        entry_count += chunks[i].m_index.m_count;
+        section_count += chunks[i].m_index.m_section_count - 1;
+    }
+    if(return_val != WYINI_OK)
+        goto bad_exit;
+
+    if(chunk_count > 1) {
+        if((entry_count > index->m_entries_size) && ((entry = (struct S_wyini_index_entry*)wyini_mem_realloc(allocator, index->m_entries, index->m_entries_size*sizeof(struct S_wyini_index_entry), entry_count*sizeof(struct S_wyini_index_entry))) != NULL)) {
+            index->m_entries = entry;
+            index->m_entries_size = entry_count;
+        }
+        struct S_wyini_section *sections;
+        if((section_count > index->m_sections_size) && ((sections = (struct S_wyini_section*)wyini_mem_realloc(allocator, index->m_sections, index->m_sections_size*sizeof(struct S_wyini_section), section_count*sizeof(struct S_wyini_section))) != NULL)) {
+            index->m_sections = sections;
+            index->m_sections_size = section_count;
+        }
+        if((entry_count > index->m_entries_size) || (section_count > index->m_sections_size))
+            goto bad_exit;
+        for(i=1; i<chunk_count; ++i) {
+            wyini_index_merge(index, &(chunks[i].m_index));
+            wyini_index_clean(&(chunks[i].m_index), NULL);
+        }
+    }
+
+    if(wyini_index_tables(index, allocator, buffer) != WYINI_OK)
+        goto bad_exit;
+
+    return WYINI_OK;
+
+bad_exit:
+    for(i=1; i<chunk_count; ++i)
+        wyini_index_clean(&(chunks[i].m_index), NULL);
+    wyini_index_clean(index, allocator);
+    return WYINI_MEMORY_ERR;
+}
+
+
+
+/**
+ * Builds m_tails from the chains in m_slots. If memory allocation fails m_tails is left NULL, and the chains are walked to their tails instead.
+ * @param p_index The index.
+ * @param p_allocator The allocator of the index.
+ */
+static void wyini_index_tails(struct S_wyini_index *restrict p_index, const struct S_wyini_allocator *restrict p_allocator)
+{
+    if((p_index->m_tails = (unsigned int*)wyini_mem_alloc(p_allocator, p_index->m_slots_size*sizeof(unsigned int))) == NULL)
+        return;
+    for(unsigned int slot=0; slot<p_index->m_slots_size; ++slot) {
+        unsigned int tail = p_index->m_slots[slot];
+        while((tail != WYINI_INDEX_NONE) && (p_index->m_entries[tail].m_next != WYINI_INDEX_NONE))
+            tail = p_index->m_entries[tail].m_next;
+        p_index->m_tails[slot] = tail;
+    }
+}
+
+
+
+int wyini_index_append(const unsigned int p_start_offset, struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    struct S_wyini_index *restrict index = &(p_wyini_buffer->m_index);
+    const struct S_wyini_allocator *restrict allocator = &(p_wyini_buffer->m_allocator);
+    const char *restrict buffer = p_wyini_buffer->m_buffer;
+    const unsigned int entry_base = index->m_count;
+    const unsigned int section_base = index->m_section_count;
+    const unsigned int last_end = index->m_sections[section_base-1].m_end;
+    const unsigned int last_entry_count = index->m_sections[section_base-1].m_entry_count;
+    unsigned int slot;
+    unsigned int i;
+
+    if(index->m_slots == NULL) /* Nothing built to append to. */
+        return wyini_index_build(p_wyini_buffer);
+
+    /* Pass 1 over the new lines only. The last section carries on into them, as it would in a scan of the whole buffer. */
+    int return_val = wyini_index_scan(index, allocator, p_start_offset, p_wyini_buffer->m_buffer_len, p_wyini_buffer);
+    if((return_val == WYINI_OK) && ((index->m_count*2 > index->m_slots_size) || (index->m_section_count*2 > index->m_names_size))) { /* The tables would be more than half full. Rebuild them at double the size, which covers the new lines as well. Tables only grow geometrically, so this is rare. */
+        if((return_val = wyini_index_tables(index, allocator, buffer)) == WYINI_OK)
+            wyini_index_tails(index, allocator);
+    }
+    else if(return_val == WYINI_OK) { /* Passes 2 and 3 for the new lines only. Insert in file order, so each line goes at the tail of its chain. */
+        if(index->m_tails == NULL)
+            wyini_index_tails(index, allocator);
+        for(i=section_base; i<index->m_section_count; ++i) {
+            struct S_wyini_section *restrict section = index->m_sections + i;
+            slot = wyini_index_probe_section(index, section, buffer);
+            if(index->m_names[slot] == WYINI_INDEX_NONE)
+                index->m_names[slot] = i;
+            else
+                section->m_group = index->m_names[slot];
+        }
+        for(i=entry_base; i<index->m_count; ++i) {
+            struct S_wyini_index_entry *restrict entry = index->m_entries + i;
+            entry->m_section = index->m_sections[entry->m_section].m_group;
+
+            slot = wyini_index_probe_var(index, entry, buffer);
+            if(index->m_slots[slot] == WYINI_INDEX_NONE)
+                index->m_slots[slot] = i;
+            else {
+                unsigned int tail = (index->m_tails != NULL) ? index->m_tails[slot] : index->m_slots[slot];
+                while(index->m_entries[tail].m_next != WYINI_INDEX_NONE)
+                    tail = index->m_entries[tail].m_next;
+                index->m_entries[tail].m_next = i;
+            }
+            if(index->m_tails != NULL)
+                index->m_tails[slot] = i;
+
+            slot = wyini_index_probe_section_var(index, entry, buffer); /* Only the first line in the group is held, so a later one is left out. */
+            if(index->m_section_slots[slot] == WYINI_INDEX_NONE)
+                index->m_section_slots[slot] = i;
+        }
+    }
+
+    if(return_val != WYINI_OK) { /* Drop what was scanned. The arrays may have grown, which does no harm. */
+        index->m_count = entry_base;
+        index->m_section_count = section_base;
+        index->m_sections[section_base-1].m_end = last_end;
+        index->m_sections[section_base-1].m_entry_count = last_entry_count;
+    }
+    return return_val;
+}
+
+
+
+void wyini_index_clean(struct S_wyini_index *restrict p_index, const struct S_wyini_allocator *restrict p_allocator)
+{
+    if(p_index->m_entries != NULL)
+        wyini_mem_free(p_allocator, p_index->m_entries, p_index->m_entries_size*sizeof(struct S_wyini_index_entry));
+    if(p_index->m_slots != NULL)
+        wyini_mem_free(p_allocator, p_index->m_slots, p_index->m_slots_size*sizeof(unsigned int));
+    if(p_index->m_section_slots != NULL)
+        wyini_mem_free(p_allocator, p_index->m_section_slots, p_index->m_slots_size*sizeof(unsigned int));
+    if(p_index->m_tails != NULL)
+        wyini_mem_free(p_allocator, p_index->m_tails, p_index->m_slots_size*sizeof(unsigned int));
+    if(p_index->m_sections != NULL)
+        wyini_mem_free(p_allocator, p_index->m_sections, p_index->m_sections_size*sizeof(struct S_wyini_section));
+    if(p_index->m_names != NULL)
+        wyini_mem_free(p_allocator, p_index->m_names, p_index->m_names_size*sizeof(unsigned int));
+    wyini_index_init(p_index);
+}
+
+
+
+bool wyini_index_can_lookup(const unsigned int p_var_len, const char *restrict const p_var)
+{
+    if((p_var_len == 0) || (p_var[p_var_len-1] == ' '))
+        return false;
+    for(unsigned int i=0; i<p_var_len; ++i) {
+        if((p_var[i] == '=') || (p_var[i] == '\n'))
+            return false;
+    }
+    return true;
+}
+
+
+
+unsigned int wyini_index_find(const unsigned int p_var_len, const char *restrict const p_var, const struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    const struct S_wyini_index *restrict index = &(p_wyini_buffer->m_index);
+    if(index->m_slots == NULL)
+        return WYINI_INDEX_NONE;
+
+    const unsigned int hash = wyini_index_hash(p_var_len, p_var);
+    const unsigned int mask = index->m_slots_size - 1;
+    unsigned int slot = hash & mask;
+    unsigned int i;
+
+    while((i = index->m_slots[slot]) != WYINI_INDEX_NONE) {
+        const struct S_wyini_index_entry *restrict entry = index->m_entries + i;
+        if((entry->m_hash == hash) && (entry->m_var_len == p_var_len) && (memcmp(p_wyini_buffer->m_buffer + entry->m_var_offset, p_var, p_var_len) == 0))
+            return i;
+        slot = (slot + 1) & mask;
+    }
+    return WYINI_INDEX_NONE;
+}
+
+
+
+unsigned int wyini_index_find_section(const unsigned int p_name_len, const char *restrict const p_name, const struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    const struct S_wyini_index *restrict index = &(p_wyini_buffer->m_index);
+    if(index->m_names == NULL)
+        return WYINI_INDEX_NONE;
+
+    const unsigned int hash = wyini_index_hash(p_name_len, p_name);
+    const unsigned int mask = index->m_names_size - 1;
+    unsigned int slot = hash & mask;
+    unsigned int i;
+
+    while((i = index->m_names[slot]) != WYINI_INDEX_NONE) {
+        const struct S_wyini_section *restrict section = index->m_sections + i;
+        if((section->m_hash == hash) && (section->m_name_len == p_name_len) && (memcmp(p_wyini_buffer->m_buffer + section->m_name_offset, p_name, p_name_len) == 0))
+            return i;
+        slot = (slot + 1) & mask;
+    }
+    return WYINI_INDEX_NONE;
+}
+
+
+
+unsigned int wyini_index_find_in_section(const unsigned int p_section, const unsigned int p_var_len, const char *restrict const p_var, const struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    const struct S_wyini_index *restrict index = &(p_wyini_buffer->m_index);
+    if(index->m_section_slots == NULL)
+        return WYINI_INDEX_NONE;
+
+    const unsigned int hash = wyini_index_hash(p_var_len, p_var);
+    const unsigned int mask = index->m_slots_size - 1;
+    unsigned int slot = wyini_index_section_hash(hash, p_section) & mask;
+    unsigned int i;
+
+    while((i = index->m_section_slots[slot]) != WYINI_INDEX_NONE) {
+        const struct S_wyini_index_entry *restrict entry = index->m_entries + i;
+        if((entry->m_section == p_section) && (entry->m_hash == hash) && (entry->m_var_len == p_var_len) && (memcmp(p_wyini_buffer->m_buffer + entry->m_var_offset, p_var, p_var_len) == 0))
+            return i;
+        slot = (slot + 1) & mask;
+    }
+    return WYINI_INDEX_NONE;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file WY_IniIndexAgent.h
+ * Declares functions for building and querying the variable index of the internal buffer.
+*/
+
+#ifndef _WY_INIINDEXAGENT_H_
+#define _WY_INIINDEXAGENT_H_
+
+#include <stdbool.h>
+#include "WY_IniDefs.h"
+
+
+/**
+ * Initialises an empty S_wyini_index. Does not allocate memory.
+ * @param p_index The index to initialise.
+ */
+void wyini_index_init(struct S_wyini_index *restrict p_index);
+
+
+/**
+ * Parses the internal buffer once and builds the index of all lines containing a '=', and the table of all '[section]' headers. Any existing index is discarded first. Lines are found with wyini_get_nextline() so the index sees exactly the same lines as a scan of the buffer. Buffers of at least 2*WYINI_INDEX_CHUNK_SIZE bytes are split at line boundaries and parsed by up to WYINI_INDEX_MAX_THREADS threads, one per CPU, and the parts are joined in file order, so the index is identical to one parsed on a single thread.
+ * @param p_wyini_buffer The S_wyini_buffer to index. Its m_index member is populated.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_index_build(struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Extends the index over lines appended to the end of the internal buffer, without parsing the lines before them again. The result is the same as wyini_index_build() over the whole buffer. The hash tables are rebuilt at double their size when they would become more than half full, so appending many lines one at a time costs about as much as indexing them once.
+ * @param p_start_offset Offset of the first appended line, which was m_buffer_len before they were appended. The byte before it must be a nextline or terminating char, so that the lines before it are unchanged.
+ * @param p_wyini_buffer The S_wyini_buffer whose m_buffer_len already includes the appended lines.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h, in which case the index still describes the lines before p_start_offset.
+ */
+int wyini_index_append(const unsigned int p_start_offset, struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Frees all memory held by an S_wyini_index and resets it to empty.
+ * @param p_index The index to clean.
+ * @param p_allocator The allocator the index was built with. NULL for malloc().
+ */
+void wyini_index_clean(struct S_wyini_index *restrict p_index, const struct S_wyini_allocator *restrict p_allocator);
+
+
+/**
+ * Hashes a variable or section name with 32-bit FNV-1a. This is the hash stored in S_wyini_index_entry::m_hash and S_wyini_section::m_hash.
+ * @param p_var_len Length of the name.
+ * @param p_var The name.
+ * @return The hash value.
+ */
+unsigned int wyini_index_hash(const unsigned int p_var_len, const char *restrict const p_var);
+
+
+/**
+ * Checks if a variable name can be resolved through the index. Names that are empty, end with whitespace or contain '=' or '\n' can match lines in ways that the index does not record, so these must be resolved by scanning the buffer instead.
+ * @param p_var_len Length of the variable name.
+ * @param p_var The variable name.
+ * @return true if the index gives the same result as a scan of the buffer.
+ */
+bool wyini_index_can_lookup(const unsigned int p_var_len, const char *restrict const p_var);
+
+
+/**
+ * Finds the first line in file order that assigns to a variable.
+ * @param p_var_len Length of the variable name.
+ * @param p_var The variable name.
+ * @param p_wyini_buffer The S_wyini_buffer whose index is searched.
+ * @return Index into m_index.m_entries of the first matching entry. Further matches are chained via S_wyini_index_entry::m_next. WYINI_INDEX_NONE if the variable is not found.
+ */
+unsigned int wyini_index_find(const unsigned int p_var_len, const char *restrict const p_var, const struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Finds a section by name. Sections with the same name are grouped together, so this returns the first of them.
+ * @param p_name_len Length of the section name.
+ * @param p_name The section name, without the '[' and ']'. An empty name refers to the unnamed section before the first header.
+ * @param p_wyini_buffer The S_wyini_buffer whose index is searched.
+ * @return Index into m_index.m_sections of the first section with the name. This is also the group index in S_wyini_section::m_group of every section with the name. WYINI_INDEX_NONE if no section has the name.
+ */
+unsigned int wyini_index_find_section(const unsigned int p_name_len, const char *restrict const p_name, const struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Finds the first line in file order that assigns to a variable within a group of same-name sections.
+ * @param p_section The group index returned by wyini_index_find_section().
+ * @param p_var_len Length of the variable name.
+ * @param p_var The variable name.
+ * @param p_wyini_buffer The S_wyini_buffer whose index is searched.
+ * @return Index into m_index.m_entries of the first matching entry in the sections. WYINI_INDEX_NONE if the variable is not found there.
+ */
+unsigned int wyini_index_find_in_section(const unsigned int p_section, const unsigned int p_var_len, const char *restrict const p_var, const struct S_wyini_buffer *restrict p_wyini_buffer);
+
+#endif
@@ -0,0 +1,436 @@
+/**
+ * @file WY_IniLayerAgent.c
+*/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "WY_IniLayerAgent.h"
+#include "WY_IniMgr.h"
+#include "WY_IniIndexAgent.h"
+#include "WY_IniWriteAgent.h"
+#include "WY_IniStatsAgent.h"
+
+#define WYINI_LAYER_MIN_SLOTS 16 /**< Smallest number of slots in a merged table. */
+#define WYINI_LAYER_MAX_SLOTS 0x80000000u /**< Largest number of slots in a merged table. */
+
+
+/**
+ * Mixes the hash of a section name into the hash of a variable name, so that the same variable in different sections is spread over different slots of m_section_vars.
+ * @param p_hash Hash of the variable name.
+ * @param p_section_hash Hash of the section name.
+ * @return The combined hash value.
+ */
+static unsigned int wyini_layer_section_hash(const unsigned int p_hash, const unsigned int p_section_hash)
+{
+    return p_hash ^ (p_section_hash * 2654435761u);
+}
+
+
+
+/**
+ * Finds the slot of a key in a merged table.
+ * @param p_layers The layered configuration.
+ * @param p_table m_vars or m_section_vars of p_layers.
+ * @param p_hash Hash of the key, as stored in S_wyini_layer_key::m_hash.
+ * @param p_var_len Length of the variable name.
+ * @param p_var The variable name.
+ * @param p_section_len Length of the section name.
+ * @param p_section The section name. NULL if p_table is m_vars.
+ * @return Index of the slot in m_keys. WYINI_INDEX_NONE if the key is not in the table.
+ */
+static unsigned int wyini_layer_find(const struct S_wyini_layers *restrict p_layers, const struct S_wyini_layer_table *p_table, const unsigned int p_hash, const unsigned int p_var_len, const char *restrict const p_var, const unsigned int p_section_len, const char *restrict const p_section)
+{
+    const unsigned int mask = p_table->m_size - 1;
+
+    if(p_table->m_size == 0)
+        return WYINI_INDEX_NONE;
+    for(unsigned int slot = p_hash & mask; p_table->m_keys[slot].m_layer != WYINI_INDEX_NONE; slot = (slot + 1) & mask) { /* The table is never more than half full, so there is always an empty slot to stop at. */
+        const struct S_wyini_layer_key *restrict key = p_table->m_keys + slot;
+        if((key->m_layer == WYINI_LAYER_DELETED) || (key->m_hash != p_hash))
+            continue;
+
+        const struct S_wyini_buffer *restrict handle = p_layers->m_layers[key->m_layer].m_handle;
+        const struct S_wyini_index_entry *restrict entry = handle->m_index.m_entries + key->m_entry;
+        if((entry->m_var_len != p_var_len) || (memcmp(handle->m_buffer + entry->m_var_offset, p_var, p_var_len) != 0))
+            continue;
+        if(p_section != NULL) {
+            const struct S_wyini_section *restrict section = handle->m_index.m_sections + entry->m_section;
+            if((section->m_name_len != p_section_len) || (memcmp(handle->m_buffer + section->m_name_offset, p_section, p_section_len) != 0))
+                continue;
+        }
+        return slot;
+    }
+    return WYINI_INDEX_NONE;
+}
+
+
+
+/**
+ * Puts a key that is not in a merged table into its first empty or deleted slot. Room must have been made with wyini_layer_reserve().
+ * @param p_table The table.
+ * @param p_hash Hash of the key.
+ * @param p_layer Layer holding the winning line.
+ * @param p_entry Index of the winning line in the index of the layer.
+ */
+static void wyini_layer_put(struct S_wyini_layer_table *p_table, const unsigned int p_hash, const unsigned int p_layer, const unsigned int p_entry)
+{
+    const unsigned int mask = p_table->m_size - 1;
+    unsigned int slot = p_hash & mask;
+
+    while((p_table->m_keys[slot].m_layer != WYINI_INDEX_NONE) && (p_table->m_keys[slot].m_layer != WYINI_LAYER_DELETED))
+        slot = (slot + 1) & mask;
+    if(p_table->m_keys[slot].m_layer == WYINI_INDEX_NONE)
+        ++(p_table->m_used);
+    p_table->m_keys[slot].m_hash = p_hash;
+    p_table->m_keys[slot].m_layer = p_layer;
+    p_table->m_keys[slot].m_entry = p_entry;
+}
+
+
+
+/**
+ * Makes room in a merged table for more keys, so that updating the table afterwards cannot fail halfway. If the table would become more than half full, it is rebuilt without its deleted keys and at a larger size if needed.
+ * @param p_table The table.
+ * @param p_extra Number of keys that may be added.
+ * @return WYINI_OK if success. WYINI_MEMORY_ERR if memory allocation fails, in which case the table is unchanged.
+ */
+static int wyini_layer_reserve(struct S_wyini_layer_table *p_table, const unsigned int p_extra)
+{
+    struct S_wyini_layer_table table = { NULL, WYINI_LAYER_MIN_SLOTS, 0 };
+    size_t live = 0;
+
+    if((size_t)p_table->m_used + p_extra <= p_table->m_size / 2)
+        return WYINI_OK;
+    for(unsigned int i=0; i<p_table->m_size; ++i) {
+        if(p_table->m_keys[i].m_layer < WYINI_LAYER_DELETED)
+            ++live;
+    }
+    while((size_t)table.m_size / 2 < live + p_extra) {
+        if(table.m_size >= WYINI_LAYER_MAX_SLOTS)
+            return WYINI_MEMORY_ERR;
+        table.m_size *= 2;
+    }
+
+    if((table.m_keys = (struct S_wyini_layer_key*)malloc((size_t)table.m_size * sizeof(struct S_wyini_layer_key))) == NULL)
+        return WYINI_MEMORY_ERR;
+    memset(table.m_keys, 0xFF, (size_t)table.m_size * sizeof(struct S_wyini_layer_key)); /* Sets every m_layer to WYINI_INDEX_NONE. */
+    for(unsigned int i=0; i<p_table->m_size; ++i) {
+        if(p_table->m_keys[i].m_layer < WYINI_LAYER_DELETED)
+            wyini_layer_put(&table, p_table->m_keys[i].m_hash, p_table->m_keys[i].m_layer, p_table->m_keys[i].m_entry);
+    }
+    free(p_table->m_keys);
+    *p_table = table;
+    return WYINI_OK;
+}
+
+
+
+/**
+ * Gives a key to a line of a layer, unless a layer above it or an earlier line of the same layer already has the key.
+ * @param p_layers The layered configuration.
+ * @param p_table m_vars or m_section_vars of p_layers.
+ * @param p_hash Hash of the key.
+ * @param p_layer The layer.
+ * @param p_entry Index of the line in the index of the layer.
+ * @param p_section_len Length of the section name of the line.
+ * @param p_section The section name of the line. NULL if p_table is m_vars.
+ */
+static void wyini_layer_take(const struct S_wyini_layers *p_layers, struct S_wyini_layer_table *p_table, const unsigned int p_hash, const unsigned int p_layer, const unsigned int p_entry, const unsigned int p_section_len, const char *restrict const p_section)
+{
+    const struct S_wyini_buffer *restrict handle = p_layers->m_layers[p_layer].m_handle;
+    const struct S_wyini_index_entry *restrict entry = handle->m_index.m_entries + p_entry;
+
+    const unsigned int slot = wyini_layer_find(p_layers, p_table, p_hash, entry->m_var_len, handle->m_buffer + entry->m_var_offset, p_section_len, p_section);
+    if(slot == WYINI_INDEX_NONE)
+        wyini_layer_put(p_table, p_hash, p_layer, p_entry);
+    else if(p_table->m_keys[slot].m_layer < p_layer) {
+        p_table->m_keys[slot].m_layer = p_layer;
+        p_table->m_keys[slot].m_entry = p_entry;
+    }
+}
+
+
+
+/**
+ * Lets the lines of a layer take every key not held by a layer above it. Lines are visited in file order, so the first line of a key in the layer wins, as in a lookup on the layer alone. Room for every line must have been reserved in both tables.
+ * @param p_layers The layered configuration.
+ * @param p_layer The layer.
+ */
+static void wyini_layer_add(struct S_wyini_layers *restrict p_layers, const unsigned int p_layer)
+{
+    const struct S_wyini_buffer *restrict handle = p_layers->m_layers[p_layer].m_handle;
+
+    for(unsigned int i=0; i<handle->m_index.m_count; ++i) {
+        const struct S_wyini_index_entry *restrict entry = handle->m_index.m_entries + i;
+        const struct S_wyini_section *restrict section = handle->m_index.m_sections + entry->m_section;
+        if(!wyini_index_can_lookup(entry->m_var_len, handle->m_buffer + entry->m_var_offset)) /* Such names are never looked up through the tables. */
+            continue;
+        wyini_layer_take(p_layers, &(p_layers->m_vars), entry->m_hash, p_layer, i, 0, NULL);
+        wyini_layer_take(p_layers, &(p_layers->m_section_vars), wyini_layer_section_hash(entry->m_hash, section->m_hash), p_layer, i, section->m_name_len, handle->m_buffer + section->m_name_offset);
+    }
+}
+
+
+
+/**
+ * Hands every key held by a line of a layer to the first line of the key in the next layer below that has it, or deletes the key if none has it. Called before the layer is replaced, while its lines can still be read.
+ * @param p_layers The layered configuration.
+ * @param p_layer The layer.
+ */
+static void wyini_layer_remove(struct S_wyini_layers *p_layers, const unsigned int p_layer)
+{
+    const struct S_wyini_buffer *restrict handle = p_layers->m_layers[p_layer].m_handle;
+    struct S_wyini_layer_key *key;
+    unsigned int slot;
+    unsigned int layer;
+
+    for(unsigned int i=0; i<handle->m_index.m_count; ++i) {
+        const struct S_wyini_index_entry *restrict entry = handle->m_index.m_entries + i;
+        const struct S_wyini_section *restrict section = handle->m_index.m_sections + entry->m_section;
+        const char *restrict var = handle->m_buffer + entry->m_var_offset;
+        const char *restrict name = handle->m_buffer + section->m_name_offset;
+        if(!wyini_index_can_lookup(entry->m_var_len, var))
+            continue;
+
+        slot = wyini_layer_find(p_layers, &(p_layers->m_vars), entry->m_hash, entry->m_var_len, var, 0, NULL);
+        key = (slot == WYINI_INDEX_NONE) ? NULL : p_layers->m_vars.m_keys + slot;
+        if((key != NULL) && (key->m_layer == p_layer) && (key->m_entry == i)) {
+            key->m_layer = WYINI_LAYER_DELETED;
+            for(layer=p_layer; layer-- > 0; ) {
+                const unsigned int found = wyini_index_find(entry->m_var_len, var, p_layers->m_layers[layer].m_handle);
+                if(found != WYINI_INDEX_NONE) {
+                    key->m_layer = layer;
+                    key->m_entry = found;
+                    break;
+                }
+            }
+        }
+
+        const unsigned int hash = wyini_layer_section_hash(entry->m_hash, section->m_hash);
+        slot = wyini_layer_find(p_layers, &(p_layers->m_section_vars), hash, entry->m_var_len, var, section->m_name_len, name);
+        key = (slot == WYINI_INDEX_NONE) ? NULL : p_layers->m_section_vars.m_keys + slot;
+        if((key != NULL) && (key->m_layer == p_layer) && (key->m_entry == i)) {
+            key->m_layer = WYINI_LAYER_DELETED;
+            for(layer=p_layer; layer-- > 0; ) {
+                const struct S_wyini_buffer *restrict below = p_layers->m_layers[layer].m_handle;
+                const unsigned int group = wyini_index_find_section(section->m_name_len, name, below);
+                const unsigned int found = (group == WYINI_INDEX_NONE) ? WYINI_INDEX_NONE : wyini_index_find_in_section(group, entry->m_var_len, var, below);
+                if(found != WYINI_INDEX_NONE) {
+                    key->m_layer = layer;
+                    key->m_entry = found;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+
+
+/**
+ * Reads the file of a layer into a new handle and numbers its lines.
+ * @param p_max_size Max file size allowed.
+ * @param p_layer The layer, whose m_file is set. Returns the handle and the line numbers.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h, in which case nothing is allocated.
+ */
+static int wyini_layer_read(const unsigned int p_max_size, struct S_wyini_layer *restrict p_layer)
+{
+    wyini_iter iter;
+    wyini_pair pair;
+
+    const int return_val = wyini_open_h(p_layer->m_file, p_max_size, &(p_layer->m_handle));
+    if(return_val != WYINI_OK)
+        return return_val;
+    const unsigned int count = p_layer->m_handle->m_index.m_count;
+    if((p_layer->m_lines = (unsigned int*)malloc(((count > 0) ? count : 1) * sizeof(unsigned int))) == NULL) {
+        wyini_close_h(p_layer->m_handle);
+        p_layer->m_handle = NULL;
+        return WYINI_MEMORY_ERR;
+    }
+
+    wyini_iter_begin_h(p_layer->m_handle, &iter); /* Counts the lines in one pass, so that looking up where a key comes from costs nothing. */
+    for(unsigned int i=0; wyini_iter_next(&iter, &pair) == WYINI_OK; ++i)
+        p_layer->m_lines[i] = (unsigned int)pair.m_line_no;
+    return WYINI_OK;
+}
+
+
+
+/**
+ * Finds the winning line of a variable through the merged tables.
+ * @param p_layers The layered configuration.
+ * @param p_section The section name, or NULL to search regardless of sections.
+ * @param p_var The variable name. Must be resolvable through the index.
+ * @return The key of the variable. NULL if no layer has it.
+ */
+static const struct S_wyini_layer_key * wyini_layer_lookup(const struct S_wyini_layers *restrict p_layers, const char *restrict const p_section, const char *restrict const p_var)
+{
+    const unsigned int var_len = (unsigned int)strlen(p_var);
+    const unsigned int hash = wyini_index_hash(var_len, p_var);
+    unsigned int slot;
+
+    if(p_section == NULL) {
+        slot = wyini_layer_find(p_layers, &(p_layers->m_vars), hash, var_len, p_var, 0, NULL);
+        return (slot == WYINI_INDEX_NONE) ? NULL : p_layers->m_vars.m_keys + slot;
+    }
+    const unsigned int section_len = (unsigned int)strlen(p_section);
+    slot = wyini_layer_find(p_layers, &(p_layers->m_section_vars), wyini_layer_section_hash(hash, wyini_index_hash(section_len, p_section)), var_len, p_var, section_len, p_section);
+    return (slot == WYINI_INDEX_NONE) ? NULL : p_layers->m_section_vars.m_keys + slot;
+}
+
+
+
+int wyini_layers_open(const char *const *restrict p_files, const unsigned int p_count, const unsigned int p_max_size, wyini_layers_t *restrict *restrict p_layers)
+{
+    struct S_wyini_layers *layers;
+    int return_val = WYINI_MEMORY_ERR;
+
+    *p_layers = NULL;
+    if(p_count == 0)
+        return WYINI_NOT_FOUND;
+    if((layers = (struct S_wyini_layers*)calloc(1, sizeof(struct S_wyini_layers))) == NULL)
+        return WYINI_MEMORY_ERR;
+    if((layers->m_layers = (struct S_wyini_layer*)calloc(p_count, sizeof(struct S_wyini_layer))) == NULL)
+        goto bad_exit;
+    layers->m_count = p_count;
+    layers->m_max_size = p_max_size;
+
+    for(unsigned int i=0; i<p_count; ++i) { /* Each layer overrides the ones before it as it is added. */
+        struct S_wyini_layer *restrict layer = layers->m_layers + i;
+        const size_t file_len = strlen(p_files[i]);
+        if((layer->m_file = (char*)malloc(file_len + 1)) == NULL) {
+            return_val = WYINI_MEMORY_ERR;
+            goto bad_exit;
+        }
+        memcpy(layer->m_file, p_files[i], file_len + 1);
+        if((return_val = wyini_layer_read(p_max_size, layer)) != WYINI_OK)
+            goto bad_exit;
+        if(((return_val = wyini_layer_reserve(&(layers->m_vars), layer->m_handle->m_index.m_count)) != WYINI_OK) || ((return_val = wyini_layer_reserve(&(layers->m_section_vars), layer->m_handle->m_index.m_count)) != WYINI_OK))
+            goto bad_exit;
+        wyini_layer_add(layers, i);
+    }
+
+    *p_layers = layers;
+    return WYINI_OK;
+
+bad_exit:
+    wyini_layers_close(layers);
+    return return_val;
+}
+
+
+
+int wyini_layers_reload(wyini_layers_t *restrict p_layers, const unsigned int p_layer)
+{
+    struct S_wyini_layer layer;
+
+    if(p_layer >= p_layers->m_count)
+        return WYINI_NOT_FOUND;
+    layer.m_file = p_layers->m_layers[p_layer].m_file;
+    int return_val = wyini_layer_read(p_layers->m_max_size, &layer);
+    if(return_val != WYINI_OK) /* Keep the current version. */
+        return return_val;
+    if(((return_val = wyini_layer_reserve(&(p_layers->m_vars), layer.m_handle->m_index.m_count)) != WYINI_OK) || ((return_val = wyini_layer_reserve(&(p_layers->m_section_vars), layer.m_handle->m_index.m_count)) != WYINI_OK)) {
+        wyini_close_h(layer.m_handle);
+        free(layer.m_lines);
+        return return_val;
+    }
+
+    /* Only the keys of the old and new lines of the layer are visited. Nothing below can fail, so the tables are never left half updated. */
+    wyini_layer_remove(p_layers, p_layer);
+    const struct S_wyini_layer old = p_layers->m_layers[p_layer];
+    p_layers->m_layers[p_layer] = layer;
+    wyini_layer_add(p_layers, p_layer);
+    wyini_close_h(old.m_handle);
+    free(old.m_lines);
+    return WYINI_OK;
+}
+
+
+
+int wyini_layers_get_var_view_s(const wyini_layers_t *restrict p_layers, const char *restrict const p_section, const char *restrict const p_var, wyini_view *restrict p_view)
+{
+    int return_val = WYINI_NOT_FOUND;
+    unsigned int raw_len = 0;
+    unsigned int val_offset = 0;
+
+    if(!wyini_index_can_lookup((unsigned int)strlen(p_var), p_var)) { /* Search the layers one by one from the last, exactly as a lookup on each of them would. */
+        for(unsigned int i=p_layers->m_count; (i-- > 0) && (return_val == WYINI_NOT_FOUND); )
+            return_val = wyini_get_var_view_s_h(p_layers->m_layers[i].m_handle, p_section, p_var, p_view);
+        return return_val;
+    }
+
+    WYINI_STATS_BEGIN(WYINI_PHASE_LOOKUP);
+    const struct S_wyini_layer_key *restrict key = wyini_layer_lookup(p_layers, p_section, p_var);
+    if(key != NULL) {
+        const char *restrict raw = wyini_edit_get_val(key->m_entry, &raw_len, p_layers->m_layers[key->m_layer].m_handle);
+        while((val_offset < raw_len) && (raw[val_offset] == ' ')) /* Skip any whitespace after the '=' pattern. */
+            ++val_offset;
+        if(val_offset >= raw_len) /* The winning line has no value assigned. */
+            return_val = WYINI_VAL_NOT_FOUND;
+        else {
+            p_view->m_ptr = raw + val_offset;
+            p_view->m_len = wyini_remove_ending_whitespace(raw + val_offset, raw_len - val_offset);
+            return_val = WYINI_OK;
+        }
+    }
+    WYINI_STATS_LOOKUP(return_val);
+    WYINI_STATS_END(WYINI_PHASE_LOOKUP);
+    return return_val;
+}
+
+
+
+int wyini_layers_get_var_view(const wyini_layers_t *restrict p_layers, const char *restrict const p_var, wyini_view *restrict p_view)
+{
+    return wyini_layers_get_var_view_s(p_layers, NULL, p_var, p_view);
+}
+
+
+
+int wyini_layers_get_origin_s(const wyini_layers_t *restrict p_layers, const char *restrict const p_section, const char *restrict const p_var, unsigned int *restrict p_layer, size_t *restrict p_line_no)
+{
+    if(!wyini_index_can_lookup((unsigned int)strlen(p_var), p_var))
+        return WYINI_NOT_FOUND;
+
+    const struct S_wyini_layer_key *restrict key = wyini_layer_lookup(p_layers, p_section, p_var);
+    if(key == NULL)
+        return WYINI_NOT_FOUND;
+    *p_layer = key->m_layer;
+    *p_line_no = p_layers->m_layers[key->m_layer].m_lines[key->m_entry];
+    return WYINI_OK;
+}
+
+
+
+int wyini_layers_get_origin(const wyini_layers_t *restrict p_layers, const char *restrict const p_var, unsigned int *restrict p_layer, size_t *restrict p_line_no)
+{
+    return wyini_layers_get_origin_s(p_layers, NULL, p_var, p_layer, p_line_no);
+}
+
+
+
+const char * wyini_layers_file(const wyini_layers_t *restrict p_layers, const unsigned int p_layer)
+{
+    return (p_layer < p_layers->m_count) ? p_layers->m_layers[p_layer].m_file : NULL;
+}
+
+
+
+void wyini_layers_close(wyini_layers_t *restrict p_layers)
+{
+    if(p_layers == NULL)
+        return;
+    if(p_layers->m_layers != NULL) {
+        for(unsigned int i=0; i<p_layers->m_count; ++i) {
+            wyini_close_h(p_layers->m_layers[i].m_handle);
+            free(p_layers->m_layers[i].m_lines);
+            free(p_layers->m_layers[i].m_file);
+        }
+        free(p_layers->m_layers);
+    }
+    free(p_layers->m_vars.m_keys);
+    free(p_layers->m_section_vars.m_keys);
+    free(p_layers);
+}
@@ -0,0 +1,59 @@
+/**
+ * @file WY_IniLayerAgent.h
+ * Declares the state of a layered configuration for the wyini_layers_* API functions in WY_IniMgr.h.
+ * \n
+ * Every layer is an ordinary handle opened with wyini_open_h(). On top of them sit two merged hash tables, one keyed by variable name and one by section and variable name. Each key holds the layer and index entry of the line that wins, i.e. the first line for the key in the last layer that has it, so a lookup is one probe of a merged table followed by reading the value from that layer, just like a lookup in a single handle.
+ * \n
+ * Keys refer to their names through the winning line, so the tables hold no strings. Reloading a layer only visits the keys of its old and new lines: keys it won are handed to the next layer below that has them, or deleted, and its new lines then take over every key not held by a layer above it. Deleted keys stay in the tables as tombstones until they are next resized.
+*/
+
+#ifndef _WY_INILAYERAGENT_H_
+#define _WY_INILAYERAGENT_H_
+
+#include "WY_IniDefs.h"
+
+#define WYINI_LAYER_DELETED 0xFFFFFFFEu /**< S_wyini_layer_key::m_layer of a key no layer has any more. */
+
+/**
+ * A key in one of the merged tables of S_wyini_layers.
+ */
+struct S_wyini_layer_key
+{
+    unsigned int m_hash; /**< Hash of the variable name, mixed with the hash of the section name in S_wyini_layers::m_section_vars. */
+    unsigned int m_layer; /**< Index in S_wyini_layers::m_layers of the layer holding the winning line. WYINI_INDEX_NONE for an empty slot, WYINI_LAYER_DELETED for a deleted key. */
+    unsigned int m_entry; /**< Index of the winning line in the index of that layer. */
+};
+
+/**
+ * An open-addressing table of S_wyini_layer_key.
+ */
+struct S_wyini_layer_table
+{
+    struct S_wyini_layer_key *m_keys; /**< The slots. */
+    unsigned int m_size; /**< Number of slots in m_keys. Always a power of 2. */
+    unsigned int m_used; /**< Number of slots that are not empty, including deleted keys. Kept at most half of m_size. */
+};
+
+/**
+ * One file of a layered configuration.
+ */
+struct S_wyini_layer
+{
+    struct S_wyini_buffer *m_handle; /**< The file, opened with wyini_open_h(). */
+    unsigned int *m_lines; /**< Line number of every entry in the index of m_handle, counted once when the file is read. */
+    char *m_file; /**< Path of the file. */
+};
+
+/**
+ * A layered configuration opened by wyini_layers_open().
+ */
+struct S_wyini_layers
+{
+    struct S_wyini_layer *m_layers; /**< The layers. Later layers override earlier ones. */
+    unsigned int m_count; /**< Number of layers. */
+    unsigned int m_max_size; /**< The size limit passed to wyini_layers_open(). */
+    struct S_wyini_layer_table m_vars; /**< Winning line of each variable name, regardless of sections. */
+    struct S_wyini_layer_table m_section_vars; /**< Winning line of each variable name within each section name. */
+};
+
+#endif
@@ -3,129 +3,1485 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
+#include <limits.h>
 #include "WY_IniDefs.h"
 #include "WY_IniMgr.h"
 #include "WY_IniIO.h"
 #include "WY_IniParseAgent.h"
 #include "WY_IniWriteAgent.h"
+#include "WY_IniIndexAgent.h"
+#include "WY_IniTypedAgent.h"
+#include "WY_IniCompileAgent.h"
+#include "WY_IniAllocAgent.h"
+#include "WY_IniStatsAgent.h"
 
 
-static struct S_wyini_buffer m_wyini_buffer; /**< Internal buffer maintained by WY_IniMgr. */
+static struct S_wyini_buffer m_wyini_buffer; /**< Default handle used by the API functions that do not take a handle. */
 
 
-void wyini_init()
+/**
+ * Gets the current value of an index entry from an offset on, excluding trailing whitespace.
+ * @param p_handle The handle holding the entry.
+ * @param p_entry Index of the entry in m_index.m_entries.
+ * @param p_offset Offset of the first char of the value, relative to the value returned by wyini_edit_get_val(). This char must not be whitespace.
+ * @param p_val Returns a pointer to the value.
+ * @param p_val_len Returns the length of the value.
+ */
+static void wyini_trim_val(const wyini_handle_t *restrict p_handle, const unsigned int p_entry, const unsigned int p_offset, const char *restrict *restrict p_val, unsigned int *restrict p_val_len)
 {
-    m_wyini_buffer.m_max_file_size = 0;
-    m_wyini_buffer.m_buffer_len = 0;
-    m_wyini_buffer.m_buffer = NULL;
-    m_wyini_buffer.m_val_buffer = NULL;
+    unsigned int raw_len = 0;
+    const char *restrict raw = wyini_edit_get_val(p_entry, &raw_len, p_handle);
+
+    *p_val = raw + p_offset;
+    *p_val_len = wyini_remove_ending_whitespace(raw + p_offset, raw_len - p_offset); /* Remove trailing whitespace after variable=value. */
 }
 
 
 
-int wyini_open(const char *restrict const p_file, const unsigned int p_max_size)
+/**
+ * Scans a range of index entries in file order for the first 'var=val' pattern, without using the hash tables. Every line containing a '=' has an entry, so this sees the same lines as a scan of the whole buffer would.
+ * @param p_handle The handle to search.
+ * @param p_first_entry Index in m_index.m_entries of the first entry to scan.
+ * @param p_entry_count Number of entries to scan.
+ * @param p_var_len Length of the variable name.
+ * @param p_var The variable name to search for.
+ * @param p_val Returns a pointer to the value.
+ * @param p_val_len Returns the length of the value.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+static int wyini_scan_val(const wyini_handle_t *restrict p_handle, const unsigned int p_first_entry, const unsigned int p_entry_count, const unsigned int p_var_len, const char *restrict const p_var, const char *restrict *restrict p_val, unsigned int *restrict p_val_len)
+{
+    unsigned int val_offset = 0;
+
+    for(unsigned int i=p_first_entry; i<p_first_entry+p_entry_count; ++i) {
+        const int tmp = wyini_edit_find_var_val(false, i, p_var_len, p_var, &val_offset, p_handle);
+        if(tmp==WYINI_OK) { /* Found the variable=value pair in the line. */
+            WYINI_STATS_ADD(m_lines_scanned, i + 1 - p_first_entry);
+            wyini_trim_val(p_handle, i, val_offset, p_val, p_val_len);
+            return WYINI_OK;
+        }
+        else if(tmp==WYINI_VAL_NOT_FOUND) { /* Found the variable but it has no value assigned to it. */
+            WYINI_STATS_ADD(m_lines_scanned, i + 1 - p_first_entry);
+            return WYINI_VAL_NOT_FOUND;
+        }
+    }
+    WYINI_STATS_ADD(m_lines_scanned, p_entry_count);
+    return WYINI_NOT_FOUND;
+}
+
+
+
+/**
+ * Gets the value of an index entry, skipping whitespace after the '='.
+ * @param p_handle The handle holding the entry.
+ * @param p_entry Index of the entry in m_index.m_entries, or WYINI_INDEX_NONE.
+ * @param p_val Returns a pointer to the value.
+ * @param p_val_len Returns the length of the value.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+static int wyini_entry_val(const wyini_handle_t *restrict p_handle, const unsigned int p_entry, const char *restrict *restrict p_val, unsigned int *restrict p_val_len)
+{
+    unsigned int raw_len = 0;
+    unsigned int val_offset = 0;
+
+    if(p_entry == WYINI_INDEX_NONE)
+        return WYINI_NOT_FOUND;
+
+    const char *restrict raw = wyini_edit_get_val(p_entry, &raw_len, p_handle);
+    while((val_offset < raw_len) && (raw[val_offset] == ' ')) /* Skip any whitespace after the '=' pattern. */
+        ++val_offset;
+    if(val_offset >= raw_len) /* Found the variable but it has no value assigned to it. */
+        return WYINI_VAL_NOT_FOUND;
+
+    wyini_trim_val(p_handle, p_entry, val_offset, p_val, p_val_len);
+    return WYINI_OK;
+}
+
+
+
+/**
+ * Locates the value assigned to a variable in a handle, excluding leading and trailing whitespace. Nothing is copied.
+ * @param p_handle The handle to search.
+ * @param p_section The section to search, without the '[' and ']'. All sections with this name are searched in file order. An empty name searches the lines before the first section header. NULL searches the whole buffer regardless of sections.
+ * @param p_var The variable name to search for.
+ * @param p_val Returns a pointer to the value, in m_buffer or in m_edit_buffer.
+ * @param p_val_len Returns the length of the value.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+static int wyini_find_val(const wyini_handle_t *restrict p_handle, const char *restrict const p_section, const char *restrict const p_var, const char *restrict *restrict p_val, unsigned int *restrict p_val_len)
+{
+    const struct S_wyini_index *restrict index = &(p_handle->m_index);
+    const unsigned int var_len = (unsigned int)strlen(p_var);
+
+    if(p_section == NULL) {
+        if(wyini_index_can_lookup(var_len, p_var)) /* Look up the first line with the variable directly. */
+            return wyini_entry_val(p_handle, wyini_index_find(var_len, p_var, p_handle), p_val, p_val_len);
+        return wyini_scan_val(p_handle, 0, index->m_count, var_len, p_var, p_val, p_val_len);
+    }
+
+    const unsigned int section = wyini_index_find_section((unsigned int)strlen(p_section), p_section, p_handle);
+    if(section == WYINI_INDEX_NONE)
+        return WYINI_NOT_FOUND;
+    if(wyini_index_can_lookup(var_len, p_var))
+        return wyini_entry_val(p_handle, wyini_index_find_in_section(section, var_len, p_var, p_handle), p_val, p_val_len);
+
+    int return_val = WYINI_NOT_FOUND;
+    for(unsigned int i=section; (i<index->m_section_count) && (return_val==WYINI_NOT_FOUND); ++i) { /* Scan only the lines of the sections with this name. */
+        if(index->m_sections[i].m_group == section)
+            return_val = wyini_scan_val(p_handle, index->m_sections[i].m_first_entry, index->m_sections[i].m_entry_count, var_len, p_var, p_val, p_val_len);
+    }
+    return return_val;
+}
+
+
+
+/**
+ * Scans the index entries once for several variables that could not be looked up through the hash tables. Every line is only compared against the variables whose name starts with the first char of the line, since the 'var=val' pattern is matched from the start of the line. Empty names can match lines starting with whitespace or '=', so they are compared against every line.
+ * @param p_handle The handle to search.
+ * @param p_vars The variable names.
+ * @param p_pending Indices into p_vars of the variables to search for. Reordered by this function.
+ * @param p_pending_count Number of entries in p_pending.
+ * @param p_views Returns the view of the value of each variable found.
+ * @param p_status Returns the result of each variable searched for, as wyini_get_var_view() would have returned it.
+ */
+static void wyini_scan_many(const wyini_handle_t *restrict p_handle, const char *const *restrict p_vars, size_t *restrict p_pending, const size_t p_pending_count, wyini_view *restrict p_views, int *restrict p_status)
+{
+    size_t bucket_start[257] = {0}; /* Probe table. p_pending is sorted by first char, so the variables starting with char c are at [bucket_start[c], bucket_end[c]). */
+    size_t bucket_end[256];
+    size_t *restrict sorted = p_pending + p_pending_count; /* p_pending has room for twice p_pending_count. */
+    size_t remaining = p_pending_count;
+    unsigned int val_offset = 0;
+    unsigned int val_len = 0;
+    unsigned int entry;
+    const char *val;
+
+    for(size_t i=0; i<p_pending_count; ++i) /* Counting sort by first char. */
+        ++bucket_start[(unsigned char)p_vars[p_pending[i]][0] + 1];
+    for(unsigned int c=0; c<256; ++c) {
+        bucket_start[c+1] += bucket_start[c];
+        bucket_end[c] = bucket_start[c];
+    }
+    for(size_t i=0; i<p_pending_count; ++i)
+        sorted[bucket_end[(unsigned char)p_vars[p_pending[i]][0]]++] = p_pending[i];
+
+    for(entry=0; (entry<p_handle->m_index.m_count) && (remaining > 0); ++entry) {
+        const unsigned char first = (unsigned char)p_handle->m_buffer[p_handle->m_index.m_entries[entry].m_var_offset]; /* Writes never change the start of a line. */
+
+        for(unsigned int pass=0; pass<2; ++pass) { /* First the variables starting with the same char as the line, then the empty names. */
+            const unsigned char c = (pass == 0) ? first : 0;
+            if((pass == 1) && (first == 0)) /* Already compared in the first pass. */
+                break;
+            size_t j = bucket_start[c];
+            while(j < bucket_end[c]) {
+                const size_t var = sorted[j];
+                const int tmp = wyini_edit_find_var_val(false, entry, (unsigned int)strlen(p_vars[var]), p_vars[var], &val_offset, p_handle);
+                if(tmp == WYINI_NOT_FOUND) { /* Not in this line. Try the next variable. */
+                    ++j;
+                    continue;
+                }
+                p_status[var] = tmp;
+                if(tmp == WYINI_OK) {
+                    wyini_trim_val(p_handle, entry, val_offset, &val, &val_len);
+                    p_views[var].m_ptr = val;
+                    p_views[var].m_len = val_len;
+                }
+                sorted[j] = sorted[--bucket_end[c]]; /* Only the first matching line counts, so drop the variable from the table. */
+                --remaining;
+            }
+        }
+    }
+    WYINI_STATS_ADD(m_lines_scanned, entry);
+}
+
+
+
+/**
+ * Gets the value of a variable converted to a type, through the typed value cache where the variable can be looked up in the index. A cached conversion, including a failed one, is returned until the line is written.
+ * @param p_handle The handle to search.
+ * @param p_var The variable name to search for.
+ * @param p_type One of the WYINI_TYPED_* definitions, except WYINI_TYPED_NONE.
+ * @param p_typed Returns the converted value in the member for p_type. Left unchanged if the function fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+static int wyini_get_typed(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const int p_type, struct S_wyini_typed *restrict p_typed)
 {
-    wyini_clean();
+    const unsigned int var_len = (unsigned int)strlen(p_var);
+    struct S_wyini_typed *restrict cached = NULL;
+    struct S_wyini_typed tmp = {0}; /* Cached as it is if the value cannot be found or converted, along with the status. */
+    const char *val = NULL;
+    unsigned int val_len = 0;
     int return_val;
 
-    if((return_val = wyini_read_file(p_file, p_max_size, &(m_wyini_buffer.m_buffer_len), &(m_wyini_buffer.m_buffer))) == WYINI_OK) {
-        m_wyini_buffer.m_max_file_size = p_max_size;
-        if((m_wyini_buffer.m_val_buffer = (char*)malloc(WYINI_MAX_VAL_LEN)) == NULL)
+    if(p_handle->m_buffer == NULL)
+        return WYINI_MEMORY_ERR;
+
+    WYINI_STATS_BEGIN(WYINI_PHASE_LOOKUP);
+    if(wyini_index_can_lookup(var_len, p_var)) {
+        const unsigned int entry = wyini_index_find(var_len, p_var, p_handle);
+        if(entry == WYINI_INDEX_NONE) {
+            return_val = WYINI_NOT_FOUND;
+            goto do_exit;
+        }
+        cached = wyini_typed_get(entry, p_handle);
+        if((cached != NULL) && (cached->m_type == p_type)) { /* Converted before and not written since. */
+            if(cached->m_status == WYINI_OK)
+                *p_typed = *cached;
+            return_val = cached->m_status;
+            goto do_exit;
+        }
+        return_val = wyini_entry_val(p_handle, entry, &val, &val_len);
+    } else /* Names the index cannot resolve are converted on every call. */
+        return_val = wyini_find_val(p_handle, NULL, p_var, &val, &val_len);
+
+    if(return_val == WYINI_OK)
+        return_val = wyini_typed_parse(p_type, val, val_len, &tmp);
+    if(cached != NULL) {
+        *cached = tmp;
+        cached->m_type = p_type;
+        cached->m_status = return_val;
+    }
+    if(return_val == WYINI_OK)
+        *p_typed = tmp;
+
+do_exit:
+    WYINI_STATS_LOOKUP(return_val);
+    WYINI_STATS_END(WYINI_PHASE_LOOKUP);
+    return return_val;
+}
+
+
+
+/**
+ * Checks that a section, variable and value can be inserted as lines of their own and read back exactly as given.
+ * @param p_section The section name, or NULL.
+ * @param p_var The variable name.
+ * @param p_val The value, or NULL to only check the names.
+ * @return WYINI_OK if they can. WYINI_NAME_ERR if not. WYINI_MEMORY_ERR if the value is longer than WYINI_MAX_VAL_LEN-1, as for wyini_write_val().
+ */
+static int wyini_check_insert(const char *restrict const p_section, const char *restrict const p_var, const char *restrict const p_val)
+{
+    const unsigned int var_len = (unsigned int)strlen(p_var);
+
+    if(!wyini_index_can_lookup(var_len, p_var) || (p_var[0] == '[') || (p_var[0] == ' ') || (strchr(p_var, '\r') != NULL)) /* Must be found through the index, and must not make the line a header. */
+        return WYINI_NAME_ERR;
+    if(p_section != NULL) {
+        const size_t section_len = strlen(p_section);
+        if((strpbrk(p_section, "=\r\n") != NULL) || ((section_len > 0) && ((p_section[0] == ' ') || (p_section[section_len-1] == ' ')))) /* Whitespace around the name is not part of it, and a header must not be a 'var=' line as well. */
+            return WYINI_NAME_ERR;
+    }
+    if(p_val == NULL)
+        return WYINI_OK;
+    if(strpbrk(p_val, "\r\n") != NULL)
+        return WYINI_NAME_ERR;
+    if(strlen(p_val) >= WYINI_MAX_VAL_LEN)
+        return WYINI_MEMORY_ERR;
+    return WYINI_OK;
+}
+
+
+
+/**
+ * Finds the first line assigning to a variable that wyini_check_insert() accepts.
+ * @param p_handle The handle to search.
+ * @param p_section The section to search. NULL searches the whole buffer.
+ * @param p_var The variable name.
+ * @return Index in m_index.m_entries of the line. WYINI_INDEX_NONE if there is none.
+ */
+static unsigned int wyini_find_entry(const wyini_handle_t *restrict p_handle, const char *restrict const p_section, const char *restrict const p_var)
+{
+    const unsigned int var_len = (unsigned int)strlen(p_var);
+
+    if(p_section == NULL)
+        return wyini_index_find(var_len, p_var, p_handle);
+    const unsigned int section = wyini_index_find_section((unsigned int)strlen(p_section), p_section, p_handle);
+    if(section == WYINI_INDEX_NONE)
+        return WYINI_INDEX_NONE;
+    return wyini_index_find_in_section(section, var_len, p_var, p_handle);
+}
+
+
+
+/**
+ * Works out where lines inserted into a section go: after the last line of the last section in the group that is not blank, so that blank lines before the next header stay where they are. In the last section of the content, this is the end of the content.
+ * @param p_handle The handle holding the section.
+ * @param p_section The group index of the section.
+ * @return Offset in m_buffer of the start of a line, or m_buffer_len.
+ */
+static unsigned int wyini_insert_offset(const wyini_handle_t *restrict p_handle, const unsigned int p_section)
+{
+    const struct S_wyini_index *restrict index = &(p_handle->m_index);
+    const char *restrict buffer = p_handle->m_buffer;
+    unsigned int last = p_section;
+
+    for(unsigned int i=p_section+1; i<index->m_section_count; ++i) {
+        if(index->m_sections[i].m_group == p_section)
+            last = i;
+    }
+    const struct S_wyini_section *restrict section = index->m_sections + last;
+    unsigned int offset = section->m_end;
+    if(offset >= p_handle->m_buffer_len)
+        return p_handle->m_buffer_len;
+
+    while((offset > section->m_start) && ((buffer[offset-1] == '\n') || (buffer[offset-1] == '\r') || (buffer[offset-1] == ' ')))
+        --offset;
+    if(offset > section->m_start) /* Move on to the start of the line after the last one that is not blank. */
+        offset = wyini_find_delim(offset - 1, false, p_handle) + 1;
+    return offset;
+}
+
+
+
+/**
+ * Gets the nextline indicator of the first line, for the lines inserted into the content.
+ * @param p_handle The handle holding the content.
+ * @return "\r\n" or "\n".
+ */
+static const char * wyini_nextline_of(const wyini_handle_t *restrict p_handle)
+{
+    const unsigned int end = wyini_find_delim(0, false, p_handle);
+    return ((end > 0) && (end < p_handle->m_buffer_len) && (p_handle->m_buffer[end] == '\n') && (p_handle->m_buffer[end-1] == '\r')) ? "\r\n" : "\n";
+}
+
+
+
+/**
+ * Initialises a handle to an empty state. Does not allocate memory.
+ * @param p_handle The handle to initialise.
+ */
+static void wyini_init_handle(wyini_handle_t *restrict p_handle)
+{
+    p_handle->m_max_file_size = 0;
+    p_handle->m_buffer_len = 0;
+    p_handle->m_buffer = NULL;
+    p_handle->m_buffer_size = 0;
+    p_handle->m_buffer_mode = WYINI_MODE_READ;
+    p_handle->m_map_len = 0;
+    p_handle->m_val_buffer = NULL;
+    memset(&(p_handle->m_allocator), 0, sizeof(p_handle->m_allocator)); /* No m_alloc, i.e. malloc(). */
+    wyini_index_init(&(p_handle->m_index));
+    wyini_edit_init(p_handle);
+    wyini_typed_init(p_handle);
+}
+
+
+
+/**
+ * Frees all buffers held by a handle through its allocator and returns it to an empty state with the default allocator. The handle itself is not freed.
+ * @param p_handle The handle to clean.
+ */
+static void wyini_clean_handle(wyini_handle_t *restrict p_handle)
+{
+    p_handle->m_max_file_size = 0;
+    if(p_handle->m_buffer != NULL) { 
+        if(p_handle->m_buffer_mode == WYINI_MODE_COMPILED)
+            wyini_compiled_close(p_handle); /* Also empties m_index, whose arrays are in the image. */
+        else if(p_handle->m_buffer_mode == WYINI_MODE_MMAP)
+            wyini_unmap_file(p_handle->m_map_len, p_handle->m_buffer);
+        else
+            wyini_mem_free(&(p_handle->m_allocator), p_handle->m_buffer, p_handle->m_buffer_size);
+        p_handle->m_buffer = NULL;
+    }
+    p_handle->m_buffer_len = 0;
+    p_handle->m_buffer_size = 0;
+    p_handle->m_buffer_mode = WYINI_MODE_READ;
+    p_handle->m_map_len = 0;
+    if(p_handle->m_val_buffer != NULL) {
+        wyini_mem_free(&(p_handle->m_allocator), p_handle->m_val_buffer, WYINI_MAX_VAL_LEN);
+        p_handle->m_val_buffer = NULL;
+    }
+    wyini_index_clean(&(p_handle->m_index), &(p_handle->m_allocator));
+    wyini_edit_clean(p_handle);
+    wyini_typed_clean(p_handle);
+    wyini_mem_release(&(p_handle->m_allocator)); /* Everything has been freed, so e.g. an arena can be reset in one step. */
+    memset(&(p_handle->m_allocator), 0, sizeof(p_handle->m_allocator));
+}
+
+
+
+/**
+ * Reads a file into a handle, replacing any content it already holds.
+ * @param p_handle The handle to read into.
+ * @param p_file File to open.
+ * @param p_max_size Limits the size of the file to parse.
+ * @param p_mode WYINI_MODE_MMAP to try mapping the file first, falling back to WYINI_MODE_READ if that fails. WYINI_MODE_READ to always read the file. The mode used is recorded in m_buffer_mode.
+ * @param p_allocator Allocator for the buffers of the handle, which is copied into m_allocator. NULL for malloc().
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h. The handle is left empty on failure.
+ */
+static int wyini_open_handle(wyini_handle_t *restrict p_handle, const char *restrict const p_file, const unsigned int p_max_size, const int p_mode, const struct S_wyini_allocator *restrict p_allocator)
+{
+    wyini_clean_handle(p_handle); /* Frees the old content through the old allocator. */
+    int return_val = WYINI_IO_ERR;
+
+    if(p_allocator != NULL)
+        p_handle->m_allocator = *p_allocator;
+
+    struct S_wyini_file_id file_id; /* Taken before reading, so that a change made while reading is seen as a newer version by the next save. */
+    const bool tracked = (wyini_file_id(p_file, &file_id) == WYINI_OK);
+
+    WYINI_STATS_ADD(m_opens, 1);
+    WYINI_STATS_BEGIN(WYINI_PHASE_READ);
+    if((p_mode == WYINI_MODE_MMAP) && (wyini_map_file(p_file, p_max_size, &(p_handle->m_buffer_len), &(p_handle->m_buffer)) == WYINI_OK)) {
+        p_handle->m_buffer_mode = WYINI_MODE_MMAP;
+        p_handle->m_map_len = p_handle->m_buffer_len;
+        return_val = WYINI_OK;
+    } else {
+        return_val = wyini_read_file(p_file, p_max_size, &(p_handle->m_buffer_len), &(p_handle->m_buffer), &(p_handle->m_allocator));
+        p_handle->m_buffer_size = p_handle->m_buffer_len;
+    }
+    WYINI_STATS_END(WYINI_PHASE_READ);
+
+    if(return_val == WYINI_OK) {
+        WYINI_STATS_ADD(m_bytes_read, p_handle->m_buffer_len);
+        p_handle->m_max_file_size = p_max_size;
+        if((p_handle->m_val_buffer = (char*)wyini_mem_alloc(&(p_handle->m_allocator), WYINI_MAX_VAL_LEN)) == NULL)
             return_val = WYINI_MEMORY_ERR;
+        else {
+            WYINI_STATS_BEGIN(WYINI_PHASE_INDEX);
+            return_val = wyini_index_build(p_handle); /* Parse the buffer once so that later lookups do not need to rescan it. */
+            WYINI_STATS_END(WYINI_PHASE_INDEX);
+        }
+        if(return_val == WYINI_OK)
+            wyini_edit_track(tracked ? p_file : NULL, &file_id, p_handle);
     } 
 
     if(return_val != WYINI_OK)
-        wyini_clean();
+        wyini_clean_handle(p_handle);
     return return_val;
 }
 
 
 
-int wyini_save(const char *restrict const p_file)
+/**
+ * Opens a compiled image into a handle, replacing any content it already holds.
+ * @param p_handle The handle to open the image into.
+ * @param p_file The image written by wyini_compile().
+ * @param p_max_size Limits the size of the image.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h. The handle is left empty on failure.
+ */
+static int wyini_open_compiled_handle(wyini_handle_t *restrict p_handle, const char *restrict const p_file, const unsigned int p_max_size)
+{
+    wyini_clean_handle(p_handle);
+    WYINI_STATS_ADD(m_opens, 1);
+    WYINI_STATS_BEGIN(WYINI_PHASE_READ);
+    int return_val = wyini_compiled_open(p_file, p_max_size, p_handle);
+    WYINI_STATS_END(WYINI_PHASE_READ);
+
+    if(return_val == WYINI_OK) {
+        WYINI_STATS_ADD(m_bytes_read, p_handle->m_buffer_len);
+        p_handle->m_max_file_size = p_max_size;
+        if((p_handle->m_val_buffer = (char*)wyini_mem_alloc(&(p_handle->m_allocator), WYINI_MAX_VAL_LEN)) == NULL)
+            return_val = WYINI_MEMORY_ERR;
+    }
+
+    if(return_val != WYINI_OK)
+        wyini_clean_handle(p_handle);
+    return return_val;
+}
+
+
+
+int wyini_open_h(const char *restrict const p_file, const unsigned int p_max_size, wyini_handle_t *restrict *restrict p_handle)
 {
-    if((m_wyini_buffer.m_buffer == NULL) || (m_wyini_buffer.m_buffer_len <= 1))  /* No data to write. Exit. */
+    wyini_handle_t *handle;
+    int return_val;
+
+    *p_handle = NULL;
+    if((handle = (wyini_handle_t*)malloc(sizeof(wyini_handle_t))) == NULL)
         return WYINI_MEMORY_ERR;
-    return wyini_save_file(p_file, m_wyini_buffer.m_buffer_len, m_wyini_buffer.m_buffer); 
+    wyini_init_handle(handle);
+
+    if((return_val = wyini_open_handle(handle, p_file, p_max_size, WYINI_MODE_READ, NULL)) != WYINI_OK) {
+        free(handle);
+        return return_val;
+    }
+    *p_handle = handle;
+    return WYINI_OK;
 }
 
 
 
-void wyini_clean()
+int wyini_open_mmap_h(const char *restrict const p_file, const unsigned int p_max_size, int *restrict p_mode, wyini_handle_t *restrict *restrict p_handle)
+{
+    wyini_handle_t *handle;
+    int return_val;
+
+    *p_handle = NULL;
+    if((handle = (wyini_handle_t*)malloc(sizeof(wyini_handle_t))) == NULL)
+        return WYINI_MEMORY_ERR;
+    wyini_init_handle(handle);
+
+    if((return_val = wyini_open_handle(handle, p_file, p_max_size, WYINI_MODE_MMAP, NULL)) != WYINI_OK) {
+        free(handle);
+        return return_val;
+    }
+    if(p_mode != NULL)
+        *p_mode = handle->m_buffer_mode;
+    *p_handle = handle;
+    return WYINI_OK;
+}
+
+
+
+int wyini_open_compiled_h(const char *restrict const p_file, const unsigned int p_max_size, wyini_handle_t *restrict *restrict p_handle)
 {
-    m_wyini_buffer.m_max_file_size = 0;
-    m_wyini_buffer.m_buffer_len = 0;
-    if(m_wyini_buffer.m_buffer != NULL) { 
-        free(m_wyini_buffer.m_buffer);
-        m_wyini_buffer.m_buffer = NULL;
+    wyini_handle_t *handle;
+    int return_val;
+
+    *p_handle = NULL;
+    if((handle = (wyini_handle_t*)malloc(sizeof(wyini_handle_t))) == NULL)
+        return WYINI_MEMORY_ERR;
+    wyini_init_handle(handle);
+
+    if((return_val = wyini_open_compiled_handle(handle, p_file, p_max_size)) != WYINI_OK) {
+        free(handle);
+        return return_val;
     }
-    if(m_wyini_buffer.m_val_buffer != NULL) {
-        free(m_wyini_buffer.m_val_buffer);
-        m_wyini_buffer.m_val_buffer = NULL;
+    *p_handle = handle;
+    return WYINI_OK;
+}
+
+
+
+int wyini_open_with_h(const char *restrict const p_file, const unsigned int p_max_size, const wyini_allocator *restrict p_allocator, wyini_handle_t *restrict *restrict p_handle)
+{
+    wyini_handle_t *handle;
+    int return_val;
+
+    *p_handle = NULL;
+    if((handle = (wyini_handle_t*)malloc(sizeof(wyini_handle_t))) == NULL) /* Not from the allocator, so the handle outlives a reset of an arena. */
+        return WYINI_MEMORY_ERR;
+    wyini_init_handle(handle);
+
+    if((return_val = wyini_open_handle(handle, p_file, p_max_size, WYINI_MODE_READ, p_allocator)) != WYINI_OK) {
+        free(handle);
+        return return_val;
     }
+    *p_handle = handle;
+    return WYINI_OK;
 }
 
 
 
-int wyini_get_var_val(const char *restrict const p_var, char *restrict *restrict p_val)
+int wyini_compile(const char *restrict const p_src_file, const unsigned int p_max_size, const char *restrict const p_out_file)
+{
+    wyini_handle_t handle;
+
+    wyini_init_handle(&handle);
+    int return_val = wyini_open_handle(&handle, p_src_file, p_max_size, WYINI_MODE_READ, NULL);
+    if(return_val == WYINI_OK)
+        return_val = wyini_compiled_write(p_out_file, &handle);
+    wyini_clean_handle(&handle);
+    return return_val;
+}
+
+
+
+/**
+ * Saves the content of a handle to a file. If the file is the one the handle last read or saved, nobody else changed it since and every written value kept its length, only the blocks that changed are overwritten in place. Otherwise the whole file is written.
+ * @param p_handle The handle to save.
+ * @param p_file The file name.
+ * @param p_bytes_written Returns the number of bytes written to the file. May be NULL.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+static int wyini_save_handle(wyini_handle_t *restrict p_handle, const char *restrict const p_file, size_t *restrict p_bytes_written)
 {
-    if(m_wyini_buffer.m_buffer == NULL)
+    int return_val = WYINI_MEMORY_ERR;
+    unsigned int written = 0;
+
+    if(p_bytes_written != NULL)
+        *p_bytes_written = 0;
+    if(p_handle->m_buffer == NULL) /* No data to write. Exit. */
         return WYINI_MEMORY_ERR;
 
-    *p_val = m_wyini_buffer.m_val_buffer; /* This value would be invalid if wyini_get_val() below returns failure. */
+    WYINI_STATS_BEGIN(WYINI_PHASE_SAVE);
+    if((wyini_edit_flatten(p_handle) == WYINI_OK) && (p_handle->m_buffer_len > 1)) { /* Put the written values in place. This also copies a mapped buffer, since saving may truncate the mapped file. */
+        if((return_val = wyini_edit_patch(p_file, &written, p_handle)) != WYINI_OK) { /* The file cannot be patched, or a patch failed half way, so write it whole. */
+            struct S_wyini_file_id file_id;
+            written = p_handle->m_buffer_len;
+            if((return_val = wyini_save_file(p_file, p_handle->m_buffer_len, p_handle->m_buffer)) == WYINI_OK)
+                wyini_edit_track((wyini_file_id(p_file, &file_id) == WYINI_OK) ? p_file : NULL, &file_id, p_handle);
+            else if((p_handle->m_file != NULL) && (strcmp(p_handle->m_file, p_file) == 0)) /* The file may be partly written now, so it cannot be patched. */
+                wyini_edit_track(NULL, NULL, p_handle);
+        }
+    }
+    if(return_val == WYINI_OK) {
+        WYINI_STATS_ADD(m_bytes_written, written);
+        if(p_bytes_written != NULL)
+            *p_bytes_written = written;
+    }
+    WYINI_STATS_END(WYINI_PHASE_SAVE);
+    return return_val;
+}
 
-    const unsigned int max_len = m_wyini_buffer.m_buffer_len;
-    const unsigned int var_len = (unsigned int)strlen(p_var);
-    unsigned int start_offset = 0;
-    unsigned int end_offset = 0;
-    unsigned int val_offset = 0;
+
+
+int wyini_save_h(wyini_handle_t *restrict p_handle, const char *restrict const p_file)
+{
+    return wyini_save_handle(p_handle, p_file, NULL);
+}
+
+
+
+int wyini_save_bytes_h(wyini_handle_t *restrict p_handle, const char *restrict const p_file, size_t *restrict p_bytes_written)
+{
+    return wyini_save_handle(p_handle, p_file, p_bytes_written);
+}
+
+
+
+int wyini_save_atomic_h(wyini_handle_t *restrict p_handle, const char *restrict const p_file)
+{
+    struct S_wyini_segment *restrict segments;
+    unsigned int content_len = 0;
+    int return_val;
+
+    if(p_handle->m_buffer == NULL) /* No data to write. Exit. */
+        return WYINI_MEMORY_ERR;
+    if((segments = (struct S_wyini_segment*)malloc((2*p_handle->m_edit_count + 1) * sizeof(struct S_wyini_segment))) == NULL)
+        return WYINI_MEMORY_ERR;
+
+    WYINI_STATS_BEGIN(WYINI_PHASE_SAVE);
+    const unsigned int count = wyini_edit_segments(segments, p_handle); /* The written values are saved from where they are, without flattening. */
+    for(unsigned int i=0; i<count; ++i)
+        content_len += segments[i].m_len;
+    if(content_len <= 1) /* Same limit as wyini_save_h(). */
+        return_val = WYINI_MEMORY_ERR;
+    else
+        return_val = wyini_save_file_atomic(p_file, segments, count);
+    if(return_val == WYINI_OK) {
+        WYINI_STATS_ADD(m_bytes_written, content_len);
+        if((p_handle->m_file != NULL) && (strcmp(p_handle->m_file, p_file) == 0)) { /* The tracked file was replaced. It now holds m_buffer with the written values in place, and those are marked dirty when they are put in place, so track the new file. */
+            struct S_wyini_file_id file_id;
+            wyini_edit_track((wyini_file_id(p_file, &file_id) == WYINI_OK) ? p_file : NULL, &file_id, p_handle);
+        }
+    }
+    WYINI_STATS_END(WYINI_PHASE_SAVE);
+    free(segments);
+    return return_val;
+}
+
+
+
+void wyini_close_h(wyini_handle_t *restrict p_handle)
+{
+    if(p_handle == NULL)
+        return;
+    wyini_clean_handle(p_handle);
+    free(p_handle);
+}
+
+
+
+int wyini_get_var_val_s_h(wyini_handle_t *restrict p_handle, const char *restrict const p_section, const char *restrict const p_var, char *restrict *restrict p_val)
+{
+    if(p_handle->m_buffer == NULL)
+        return WYINI_MEMORY_ERR;
+
+    *p_val = p_handle->m_val_buffer; /* This value would be invalid if wyini_get_val() below returns failure. */
+
+    const char *val = NULL;
     unsigned int val_len = 0;
-    unsigned int nextline_len = 0;
-    int tmp = 0;
+    WYINI_STATS_BEGIN(WYINI_PHASE_LOOKUP);
+    const int return_val = wyini_find_val(p_handle, p_section, p_var, &val, &val_len);
+    WYINI_STATS_LOOKUP(return_val);
+    WYINI_STATS_END(WYINI_PHASE_LOOKUP);
+    if(return_val != WYINI_OK)
+        return return_val;
 
-    while(start_offset < max_len) {
-        nextline_len = 1 + wyini_get_nextline(start_offset, &end_offset, &m_wyini_buffer); /* Get the next line in m_buffer. */
-        
-        tmp = wyini_find_var_val_inline(false, start_offset, end_offset, var_len, p_var, &val_offset, &m_wyini_buffer);
-        if(tmp==WYINI_OK) { /* Found the variable=value pair in the line. */
-            val_len = wyini_remove_ending_whitespace(start_offset, end_offset, &m_wyini_buffer) - val_offset + 1; /* Remove trailing whitespace after variable=value. +1 is needed as our bounds include the starting and end index. */
-            if(val_len < WYINI_MAX_VAL_LEN) {
-                memcpy(m_wyini_buffer.m_val_buffer, m_wyini_buffer.m_buffer+val_offset, val_len);
-                m_wyini_buffer.m_val_buffer[val_len] = 0; /* Make sure to terminate the value buffer. */ 
-                return WYINI_OK; /* Found everything. Return success. */
-            } else
-                return WYINI_NOT_FOUND; /* If val_len exceeds buffer assume we'll get the wrong value. Return failure. */
-        } else if(tmp==WYINI_VAL_NOT_FOUND) /* Found the variable but it has no value assigned to it. */
-            return WYINI_VAL_NOT_FOUND;
-        
-        start_offset = end_offset + nextline_len; /* Pattern not found. Move on to the next line, skipping the nextline characters. */
+    if(val_len < WYINI_MAX_VAL_LEN) {
+        memcpy(p_handle->m_val_buffer, val, val_len);
+        p_handle->m_val_buffer[val_len] = 0; /* Make sure to terminate the value buffer. */ 
+        return WYINI_OK; /* Found everything. Return success. */
+    } else
+        return WYINI_NOT_FOUND; /* If val_len exceeds buffer assume we'll get the wrong value. Return failure. */
+}
+
+
+
+int wyini_get_var_val_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, char *restrict *restrict p_val)
+{
+    return wyini_get_var_val_s_h(p_handle, NULL, p_var, p_val);
+}
+
+
+
+int wyini_get_var_view_s_h(const wyini_handle_t *restrict p_handle, const char *restrict const p_section, const char *restrict const p_var, wyini_view *restrict p_view)
+{
+    if(p_handle->m_buffer == NULL)
+        return WYINI_MEMORY_ERR;
+
+    const char *val = NULL;
+    unsigned int val_len = 0;
+    WYINI_STATS_BEGIN(WYINI_PHASE_LOOKUP);
+    const int return_val = wyini_find_val(p_handle, p_section, p_var, &val, &val_len);
+    WYINI_STATS_LOOKUP(return_val);
+    WYINI_STATS_END(WYINI_PHASE_LOOKUP);
+    if(return_val == WYINI_OK) {
+        p_view->m_ptr = val;
+        p_view->m_len = val_len;
     }
+    return return_val;
+}
 
-    return WYINI_NOT_FOUND;
+
+
+int wyini_get_var_view_h(const wyini_handle_t *restrict p_handle, const char *restrict const p_var, wyini_view *restrict p_view)
+{
+    return wyini_get_var_view_s_h(p_handle, NULL, p_var, p_view);
 }
 
 
 
-int wyini_write_val(const char *restrict const p_var, const char *restrict const p_val)
+int wyini_get_many_h(const wyini_handle_t *restrict p_handle, const char *const *restrict p_vars, const size_t p_count, wyini_view *restrict p_views, int *restrict p_status)
 {
-    if(m_wyini_buffer.m_buffer == NULL) /* Empty buffer, exit. */
+    size_t *restrict pending = NULL;
+    size_t pending_count = 0;
+    const char *val = NULL;
+    unsigned int val_len = 0;
+    int return_val = WYINI_OK;
+
+    if(p_handle->m_buffer == NULL) {
+        for(size_t i=0; i<p_count; ++i)
+            p_status[i] = WYINI_MEMORY_ERR;
         return WYINI_MEMORY_ERR;
+    }
 
-    const unsigned int max_len = m_wyini_buffer.m_buffer_len;
-    const unsigned int val_len = (unsigned int)strlen(p_val);
-    unsigned int start_offset = 0;
-    unsigned int end_offset = 0;
-    unsigned int val_offset = 0;
-    unsigned int nextline_len  = 0;
+    WYINI_STATS_BEGIN(WYINI_PHASE_LOOKUP);
+    for(size_t i=0; i<p_count; ++i) { /* Resolve what we can through the index. */
+        const unsigned int var_len = (unsigned int)strlen(p_vars[i]);
+        if(wyini_index_can_lookup(var_len, p_vars[i])) {
+            p_status[i] = wyini_entry_val(p_handle, wyini_index_find(var_len, p_vars[i], p_handle), &val, &val_len);
+            if(p_status[i] == WYINI_OK) {
+                p_views[i].m_ptr = val;
+                p_views[i].m_len = val_len;
+            }
+        } else {
+            p_status[i] = WYINI_NOT_FOUND; /* Left for the scan below. */
+            ++pending_count;
+        }
+    }
 
-    if(val_len >= WYINI_MAX_VAL_LEN) /* Val size exceeds designated limit. Exit. */
+    if(pending_count > 0) { /* Scan the buffer once for all the rest. */
+        if((pending = (size_t*)malloc(2 * pending_count * sizeof(size_t))) == NULL) {
+            for(size_t i=0; i<p_count; ++i)
+                p_status[i] = WYINI_MEMORY_ERR;
+            return_val = WYINI_MEMORY_ERR;
+            goto do_exit;
+        }
+        pending_count = 0;
+        for(size_t i=0; i<p_count; ++i) {
+            if(!wyini_index_can_lookup((unsigned int)strlen(p_vars[i]), p_vars[i]))
+                pending[pending_count++] = i;
+        }
+        wyini_scan_many(p_handle, p_vars, pending, pending_count, p_views, p_status);
+        free(pending);
+    }
+
+    for(size_t i=0; (i<p_count) && (return_val==WYINI_OK); ++i) {
+        if(p_status[i] != WYINI_OK)
+            return_val = WYINI_NOT_FOUND;
+    }
+
+do_exit:
+#if defined WYINI_STATS
+    for(size_t i=0; i<p_count; ++i)
+        WYINI_STATS_LOOKUP(p_status[i]);
+#endif
+    WYINI_STATS_END(WYINI_PHASE_LOOKUP);
+    return return_val;
+}
+
+
+
+int wyini_iter_begin_h(const wyini_handle_t *restrict p_handle, wyini_iter *restrict p_iter)
+{
+    if(p_handle->m_buffer == NULL)
         return WYINI_MEMORY_ERR;
 
-    while(start_offset < max_len) {
-        nextline_len = 1 + wyini_get_nextline(start_offset, &end_offset, &m_wyini_buffer); /* Get the next line in m_buffer. */
-        if(wyini_find_var_val_inline(true, start_offset, end_offset, (unsigned int)strlen(p_var), p_var, &val_offset, &m_wyini_buffer)==WYINI_OK) /* Find the "variable=" pattern in the line. */
-            return wyini_write_val_inline(val_offset, end_offset, val_len, p_val, &m_wyini_buffer);
-        start_offset = end_offset + nextline_len; /* Pattern not found. Move on to the next line, skipping the '\n'. */
+    p_iter->m_handle = p_handle;
+    p_iter->m_entry = 0;
+    p_iter->m_line_offset = 0;
+    p_iter->m_line_no = 1;
+    return WYINI_OK;
+}
+
+
+
+int wyini_iter_next(wyini_iter *restrict p_iter, wyini_pair *restrict p_pair)
+{
+    const wyini_handle_t *restrict handle = p_iter->m_handle;
+    const char *val = NULL;
+    unsigned int val_len = 0;
+
+    if(p_iter->m_entry >= handle->m_index.m_count)
+        return WYINI_NOT_FOUND;
+
+    const struct S_wyini_index_entry *restrict entry = handle->m_index.m_entries + p_iter->m_entry;
+    const struct S_wyini_section *restrict section = handle->m_index.m_sections + entry->m_section;
+    while(p_iter->m_line_offset < entry->m_var_offset) { /* Count the lines since the last one visited. Every entry starts a line, so each line is searched once over the whole pass. */
+        p_iter->m_line_offset = wyini_find_delim(p_iter->m_line_offset, false, handle) + 1;
+        ++(p_iter->m_line_no);
+    }
+
+    if(wyini_entry_val(handle, p_iter->m_entry, &val, &val_len) != WYINI_OK) { /* No value assigned. */
+        val = handle->m_buffer + entry->m_val_offset;
+        val_len = 0;
     }
+    p_pair->m_section.m_ptr = handle->m_buffer + section->m_name_offset;
+    p_pair->m_section.m_len = section->m_name_len;
+    p_pair->m_var.m_ptr = handle->m_buffer + entry->m_var_offset;
+    p_pair->m_var.m_len = entry->m_var_len;
+    p_pair->m_val.m_ptr = val;
+    p_pair->m_val.m_len = val_len;
+    p_pair->m_line_no = p_iter->m_line_no;
+    ++(p_iter->m_entry);
+    return WYINI_OK;
+}
+
+
 
-    return WYINI_NOT_FOUND; /* Not found, return failure. */
+int wyini_foreach_h(const wyini_handle_t *restrict p_handle, const wyini_foreach_callback p_callback, void *p_user)
+{
+    wyini_iter iter;
+    wyini_pair pair;
+
+    int return_val = wyini_iter_begin_h(p_handle, &iter);
+    while((return_val == WYINI_OK) && (wyini_iter_next(&iter, &pair) == WYINI_OK))
+        return_val = p_callback(&pair, p_user);
+    return return_val;
 }
+
+
+
+int wyini_write_val_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const char *restrict const p_val)
+{
+    if(p_handle->m_buffer == NULL) /* Empty buffer, exit. */
+        return WYINI_MEMORY_ERR;
+
+    const unsigned int var_len = (unsigned int)strlen(p_var);
+    const unsigned int val_len = (unsigned int)strlen(p_val);
+    unsigned int val_offset = 0;
+    unsigned int raw_len = 0;
+
+    if(val_len >= WYINI_MAX_VAL_LEN) /* Val size exceeds designated limit. Exit. */
+        return WYINI_MEMORY_ERR;
+    if(wyini_compiled_detach(p_handle) != WYINI_OK) /* The image is read-only, so take a writable copy first. */
+        return WYINI_MEMORY_ERR;
+
+    int return_val = WYINI_NOT_FOUND; /* Until the variable is found. */
+    WYINI_STATS_BEGIN(WYINI_PHASE_WRITE);
+    if(wyini_index_can_lookup(var_len, p_var)) {
+        for(unsigned int i=wyini_index_find(var_len, p_var, p_handle); i!=WYINI_INDEX_NONE; i=p_handle->m_index.m_entries[i].m_next) { /* Same as the scan below, use the first line where 'var=' is followed by at least 1 char. */
+            wyini_edit_get_val(i, &raw_len, p_handle);
+            if(raw_len > 0) {
+                return_val = wyini_edit_write(i, 0, val_len, p_val, p_handle);
+                break;
+            }
+        }
+    } else {
+        unsigned int i;
+        for(i=0; i<p_handle->m_index.m_count; ++i) {
+            if(wyini_edit_find_var_val(true, i, var_len, p_var, &val_offset, p_handle)==WYINI_OK) { /* Find the "variable=" pattern in the line. Everything before the match is kept. */
+                return_val = wyini_edit_write(i, val_offset, val_len, p_val, p_handle);
+                break;
+            }
+        }
+        WYINI_STATS_ADD(m_lines_scanned, (i < p_handle->m_index.m_count) ? i + 1 : i);
+    }
+    WYINI_STATS_END(WYINI_PHASE_WRITE);
+    return return_val;
+}
+
+
+
+/**
+ * Compares two variable names for qsort().
+ * @param p_a Pointer to the first name pointer.
+ * @param p_b Pointer to the second name pointer.
+ * @return As strcmp() for the two names.
+ */
+static int wyini_compare_names(const void *p_a, const void *p_b)
+{
+    return strcmp(*(const char *const *)p_a, *(const char *const *)p_b);
+}
+
+
+
+/**
+ * Checks whether a batch of variable names names any variable twice.
+ * @param p_vars The variable names.
+ * @param p_count Number of variables in p_vars.
+ * @return WYINI_OK if the names all differ. WYINI_EXISTS if one is given twice. WYINI_MEMORY_ERR if memory allocation failed.
+ */
+static int wyini_check_batch_names(const char *const *restrict p_vars, const size_t p_count)
+{
+    if(p_count < 2)
+        return WYINI_OK;
+    const char **restrict sorted = (const char**)malloc(p_count * sizeof(*sorted));
+    if(sorted == NULL)
+        return WYINI_MEMORY_ERR;
+    memcpy(sorted, p_vars, p_count * sizeof(*sorted));
+    qsort(sorted, p_count, sizeof(*sorted), wyini_compare_names); /* Equal names end up next to each other. */
+    int return_val = WYINI_OK;
+    for(size_t i=1; i<p_count; ++i) {
+        if(strcmp(sorted[i-1], sorted[i]) == 0) {
+            return_val = WYINI_EXISTS;
+            break;
+        }
+    }
+    free(sorted);
+    return return_val;
+}
+
+
+
+int wyini_insert_many_h(wyini_handle_t *restrict p_handle, const char *restrict const p_section, const char *const *restrict p_vars, const char *const *restrict p_vals, const size_t p_count)
+{
+    unsigned int section = WYINI_INDEX_NONE;
+    struct S_wyini_splice splice;
+    char *restrict text = NULL;
+    size_t text_len = 0;
+    size_t i;
+    int return_val = WYINI_OK;
+
+    if(p_handle->m_buffer == NULL) /* Empty buffer, exit. */
+        return WYINI_MEMORY_ERR;
+    if(p_count == 0)
+        return WYINI_OK;
+
+    WYINI_STATS_BEGIN(WYINI_PHASE_WRITE);
+    const char *restrict nextline = wyini_nextline_of(p_handle);
+    const size_t nextline_len = strlen(nextline);
+    if(p_section != NULL)
+        section = wyini_index_find_section((unsigned int)strlen(p_section), p_section, p_handle);
+    for(i=0; (i<p_count) && (return_val==WYINI_OK); ++i) { /* Check the whole batch first, so that either all of it is inserted or none. */
+        if((return_val = wyini_check_insert(p_section, p_vars[i], p_vals[i])) != WYINI_OK)
+            break;
+        if(((p_section == NULL) || (section != WYINI_INDEX_NONE)) && (wyini_find_entry(p_handle, p_section, p_vars[i]) != WYINI_INDEX_NONE))
+            return_val = WYINI_EXISTS;
+        text_len += strlen(p_vars[i]) + 1 + strlen(p_vals[i]) + nextline_len;
+    }
+    if((return_val != WYINI_OK) || ((return_val = wyini_check_batch_names(p_vars, p_count)) != WYINI_OK)) /* A name given twice would be assigned twice. */
+        goto do_exit;
+    if(wyini_compiled_detach(p_handle) != WYINI_OK) { /* The image is read-only, so take a writable copy first. */
+        return_val = WYINI_MEMORY_ERR;
+        goto do_exit;
+    }
+
+    splice.m_offset = (section != WYINI_INDEX_NONE) ? wyini_insert_offset(p_handle, section) : p_handle->m_buffer_len;
+    splice.m_remove_len = 0;
+    const bool join_line = (splice.m_offset == p_handle->m_buffer_len) && (splice.m_offset > 0) && (p_handle->m_buffer[splice.m_offset-1] != '\n') && (p_handle->m_buffer[splice.m_offset-1] != '\0'); /* The last line has no nextline indicator, so it needs one before the new lines. */
+    if(join_line)
+        text_len += nextline_len;
+    if((p_section != NULL) && (section == WYINI_INDEX_NONE)) /* New section. Its header goes first. */
+        text_len += strlen(p_section) + 2 + nextline_len;
+    if((text_len > UINT_MAX) || ((text = (char*)malloc(text_len + 1)) == NULL)) { /* sprintf() below also writes a terminating 0. */
+        return_val = WYINI_MEMORY_ERR;
+        goto do_exit;
+    }
+
+    char *restrict out = text;
+    if(join_line)
+        out += sprintf(out, "%s", nextline);
+    if((p_section != NULL) && (section == WYINI_INDEX_NONE))
+        out += sprintf(out, "[%s]%s", p_section, nextline);
+    for(i=0; i<p_count; ++i)
+        out += sprintf(out, "%s=%s%s", p_vars[i], p_vals[i], nextline);
+    splice.m_insert = text;
+    splice.m_insert_len = (unsigned int)text_len;
+    return_val = wyini_edit_splice(&splice, 1, p_handle);
+    free(text);
+
+do_exit:
+    WYINI_STATS_END(WYINI_PHASE_WRITE);
+    return return_val;
+}
+
+
+
+int wyini_insert_val_s_h(wyini_handle_t *restrict p_handle, const char *restrict const p_section, const char *restrict const p_var, const char *restrict const p_val)
+{
+    const char *var = p_var; /* Not restrict, as the batch takes an array of names. */
+    const char *val = p_val;
+    return wyini_insert_many_h(p_handle, p_section, &var, &val, 1);
+}
+
+
+
+int wyini_insert_val_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const char *restrict const p_val)
+{
+    return wyini_insert_val_s_h(p_handle, NULL, p_var, p_val);
+}
+
+
+
+int wyini_upsert_val_s_h(wyini_handle_t *restrict p_handle, const char *restrict const p_section, const char *restrict const p_var, const char *restrict const p_val)
+{
+    if(p_handle->m_buffer == NULL) /* Empty buffer, exit. */
+        return WYINI_MEMORY_ERR;
+
+    int return_val = wyini_check_insert(p_section, p_var, p_val);
+    if(return_val != WYINI_OK)
+        return return_val;
+    if(wyini_compiled_detach(p_handle) != WYINI_OK) /* The image is read-only, so take a writable copy first. */
+        return WYINI_MEMORY_ERR;
+
+    const unsigned int entry = wyini_find_entry(p_handle, p_section, p_var);
+    if(entry == WYINI_INDEX_NONE)
+        return wyini_insert_val_s_h(p_handle, p_section, p_var, p_val);
+
+    WYINI_STATS_BEGIN(WYINI_PHASE_WRITE);
+    return_val = wyini_edit_write(entry, 0, (unsigned int)strlen(p_val), p_val, p_handle);
+    WYINI_STATS_END(WYINI_PHASE_WRITE);
+    return return_val;
+}
+
+
+
+int wyini_upsert_val_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const char *restrict const p_val)
+{
+    return wyini_upsert_val_s_h(p_handle, NULL, p_var, p_val);
+}
+
+
+
+int wyini_delete_var_s_h(wyini_handle_t *restrict p_handle, const char *restrict const p_section, const char *restrict const p_var)
+{
+    struct S_wyini_splice *restrict splices = NULL;
+    unsigned int section = WYINI_INDEX_NONE;
+    unsigned int count = 0;
+    unsigned int i;
+
+    if(p_handle->m_buffer == NULL) /* Empty buffer, exit. */
+        return WYINI_MEMORY_ERR;
+
+    int return_val = wyini_check_insert(p_section, p_var, NULL);
+    if(return_val != WYINI_OK)
+        return return_val;
+    if(p_section != NULL) {
+        if((section = wyini_index_find_section((unsigned int)strlen(p_section), p_section, p_handle)) == WYINI_INDEX_NONE)
+            return WYINI_NOT_FOUND;
+    }
+    if(wyini_compiled_detach(p_handle) != WYINI_OK) /* The image is read-only, so take a writable copy first. */
+        return WYINI_MEMORY_ERR;
+
+    WYINI_STATS_BEGIN(WYINI_PHASE_WRITE);
+    const struct S_wyini_index *restrict index = &(p_handle->m_index);
+    const unsigned int first = wyini_index_find((unsigned int)strlen(p_var), p_var, p_handle);
+    for(i=first; i!=WYINI_INDEX_NONE; i=index->m_entries[i].m_next) { /* The chain holds every line assigning to the variable, in file order. */
+        if((section == WYINI_INDEX_NONE) || (index->m_entries[i].m_section == section))
+            ++count;
+    }
+    if(count == 0) {
+        return_val = WYINI_NOT_FOUND;
+        goto do_exit;
+    }
+    if((splices = (struct S_wyini_splice*)malloc(count * sizeof(struct S_wyini_splice))) == NULL) {
+        return_val = WYINI_MEMORY_ERR;
+        goto do_exit;
+    }
+
+    count = 0;
+    for(i=first; i!=WYINI_INDEX_NONE; i=index->m_entries[i].m_next) { /* Remove each line whole, with its nextline indicator. */
+        const struct S_wyini_index_entry *restrict entry = index->m_entries + i;
+        if((section != WYINI_INDEX_NONE) && (entry->m_section != section))
+            continue;
+        const unsigned int line_end = entry->m_val_end + 1;
+        const unsigned int nextline_len = (line_end >= p_handle->m_buffer_len) ? 0 : ((p_handle->m_buffer[line_end] == '\r') ? 2 : 1);
+        splices[count].m_offset = entry->m_var_offset;
+        splices[count].m_remove_len = line_end + nextline_len - entry->m_var_offset;
+        splices[count].m_insert = NULL;
+        splices[count++].m_insert_len = 0;
+    }
+    return_val = wyini_edit_splice(splices, count, p_handle);
+    free(splices);
+
+do_exit:
+    WYINI_STATS_END(WYINI_PHASE_WRITE);
+    return return_val;
+}
+
+
+
+int wyini_delete_var_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var)
+{
+    return wyini_delete_var_s_h(p_handle, NULL, p_var);
+}
+
+
+int wyini_get_int64_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, int64_t *restrict p_val)
+{
+    struct S_wyini_typed typed;
+    const int return_val = wyini_get_typed(p_handle, p_var, WYINI_TYPED_INT64, &typed);
+    if(return_val == WYINI_OK)
+        *p_val = typed.m_int64;
+    return return_val;
+}
+
+
+
+int wyini_get_uint64_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, uint64_t *restrict p_val)
+{
+    struct S_wyini_typed typed;
+    const int return_val = wyini_get_typed(p_handle, p_var, WYINI_TYPED_UINT64, &typed);
+    if(return_val == WYINI_OK)
+        *p_val = typed.m_uint64;
+    return return_val;
+}
+
+
+
+int wyini_get_double_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, double *restrict p_val)
+{
+    struct S_wyini_typed typed;
+    const int return_val = wyini_get_typed(p_handle, p_var, WYINI_TYPED_DOUBLE, &typed);
+    if(return_val == WYINI_OK)
+        *p_val = typed.m_double;
+    return return_val;
+}
+
+
+
+int wyini_get_bool_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, bool *restrict p_val)
+{
+    struct S_wyini_typed typed;
+    const int return_val = wyini_get_typed(p_handle, p_var, WYINI_TYPED_BOOL, &typed);
+    if(return_val == WYINI_OK)
+        *p_val = typed.m_bool;
+    return return_val;
+}
+
+
+
+int wyini_get_duration_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, uint64_t *restrict p_ms)
+{
+    struct S_wyini_typed typed;
+    const int return_val = wyini_get_typed(p_handle, p_var, WYINI_TYPED_DURATION, &typed);
+    if(return_val == WYINI_OK)
+        *p_ms = typed.m_uint64;
+    return return_val;
+}
+
+
+
+int wyini_set_int64_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const int64_t p_val)
+{
+    char val[WYINI_TYPED_MAX_CHARS];
+    wyini_format_int64(p_val, val);
+    return wyini_write_val_h(p_handle, p_var, val);
+}
+
+
+
+int wyini_set_uint64_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const uint64_t p_val)
+{
+    char val[WYINI_TYPED_MAX_CHARS];
+    wyini_format_uint64(p_val, val);
+    return wyini_write_val_h(p_handle, p_var, val);
+}
+
+
+
+int wyini_set_double_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const double p_val)
+{
+    char val[WYINI_TYPED_MAX_CHARS];
+    wyini_format_double(p_val, val);
+    return wyini_write_val_h(p_handle, p_var, val);
+}
+
+
+
+int wyini_set_bool_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const bool p_val)
+{
+    return wyini_write_val_h(p_handle, p_var, p_val ? "true" : "false");
+}
+
+
+
+int wyini_set_duration_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const uint64_t p_ms)
+{
+    char val[WYINI_TYPED_MAX_CHARS];
+    wyini_format_duration(p_ms, val);
+    return wyini_write_val_h(p_handle, p_var, val);
+}
+
+
+
+int wyini_schema_load_h(const wyini_handle_t *restrict p_handle, const wyini_schema_key *restrict p_keys, const size_t p_count, void *restrict p_values, int *restrict p_status)
+{
+    char *restrict values = (char*)p_values;
+    struct S_wyini_typed typed;
+    const char *val = NULL;
+    unsigned int val_len = 0;
+    int return_val = WYINI_OK;
+
+    if(p_handle->m_buffer == NULL) {
+        for(size_t i=0; (i<p_count) && (p_status!=NULL); ++i)
+            p_status[i] = WYINI_MEMORY_ERR;
+        return WYINI_MEMORY_ERR;
+    }
+
+    WYINI_STATS_BEGIN(WYINI_PHASE_LOOKUP);
+    for(size_t i=0; i<p_count; ++i) {
+        const wyini_schema_key *restrict key = p_keys + i;
+        int status = wyini_find_val(p_handle, key->m_section, key->m_var, &val, &val_len);
+        if((status == WYINI_OK) && (key->m_type == WYINI_TYPED_STRING)) {
+            const wyini_view view = { val, val_len };
+            memcpy(values + key->m_offset, &view, sizeof(view)); /* The struct of values is only known to the caller, so store through its offsets. */
+        } else if((status == WYINI_OK) && ((status = wyini_typed_parse(key->m_type, val, val_len, &typed)) == WYINI_OK)) {
+            if(key->m_type == WYINI_TYPED_INT64)
+                memcpy(values + key->m_offset, &(typed.m_int64), sizeof(typed.m_int64));
+            else if(key->m_type == WYINI_TYPED_DOUBLE)
+                memcpy(values + key->m_offset, &(typed.m_double), sizeof(typed.m_double));
+            else if(key->m_type == WYINI_TYPED_BOOL)
+                memcpy(values + key->m_offset, &(typed.m_bool), sizeof(typed.m_bool));
+            else /* WYINI_TYPED_UINT64 and WYINI_TYPED_DURATION. */
+                memcpy(values + key->m_offset, &(typed.m_uint64), sizeof(typed.m_uint64));
+        }
+        WYINI_STATS_LOOKUP(status);
+        if(p_status != NULL)
+            p_status[i] = status;
+        if(return_val == WYINI_OK) /* Report the first key that failed. Its default is kept. */
+            return_val = status;
+    }
+    WYINI_STATS_END(WYINI_PHASE_LOOKUP);
+    return return_val;
+}
+
+
+
+void wyini_init()
+{
+    wyini_init_handle(&m_wyini_buffer);
+}
+
+
+
+int wyini_open(const char *restrict const p_file, const unsigned int p_max_size)
+{
+    return wyini_open_handle(&m_wyini_buffer, p_file, p_max_size, WYINI_MODE_READ, NULL);
+}
+
+
+
+int wyini_open_mmap(const char *restrict const p_file, const unsigned int p_max_size, int *restrict p_mode)
+{
+    const int return_val = wyini_open_handle(&m_wyini_buffer, p_file, p_max_size, WYINI_MODE_MMAP, NULL);
+    if((return_val == WYINI_OK) && (p_mode != NULL))
+        *p_mode = m_wyini_buffer.m_buffer_mode;
+    return return_val;
+}
+
+
+
+int wyini_open_compiled(const char *restrict const p_file, const unsigned int p_max_size)
+{
+    return wyini_open_compiled_handle(&m_wyini_buffer, p_file, p_max_size);
+}
+
+
+
+int wyini_open_with(const char *restrict const p_file, const unsigned int p_max_size, const wyini_allocator *restrict p_allocator)
+{
+    return wyini_open_handle(&m_wyini_buffer, p_file, p_max_size, WYINI_MODE_READ, p_allocator);
+}
+
+
+
+int wyini_save(const char *restrict const p_file)
+{
+    return wyini_save_h(&m_wyini_buffer, p_file);
+}
+
+
+
+int wyini_save_bytes(const char *restrict const p_file, size_t *restrict p_bytes_written)
+{
+    return wyini_save_handle(&m_wyini_buffer, p_file, p_bytes_written);
+}
+
+
+
+int wyini_save_atomic(const char *restrict const p_file)
+{
+    return wyini_save_atomic_h(&m_wyini_buffer, p_file);
+}
+
+
+
+void wyini_clean()
+{
+    wyini_clean_handle(&m_wyini_buffer);
+}
+
+
+
+int wyini_get_var_val(const char *restrict const p_var, char *restrict *restrict p_val)
+{
+    return wyini_get_var_val_h(&m_wyini_buffer, p_var, p_val);
+}
+
+
+
+int wyini_get_var_view(const char *restrict const p_var, wyini_view *restrict p_view)
+{
+    return wyini_get_var_view_h(&m_wyini_buffer, p_var, p_view);
+}
+
+
+
+int wyini_get_many(const char *const *restrict p_vars, const size_t p_count, wyini_view *restrict p_views, int *restrict p_status)
+{
+    return wyini_get_many_h(&m_wyini_buffer, p_vars, p_count, p_views, p_status);
+}
+
+
+
+int wyini_iter_begin(wyini_iter *restrict p_iter)
+{
+    return wyini_iter_begin_h(&m_wyini_buffer, p_iter);
+}
+
+
+
+int wyini_foreach(const wyini_foreach_callback p_callback, void *p_user)
+{
+    return wyini_foreach_h(&m_wyini_buffer, p_callback, p_user);
+}
+
+
+
+int wyini_get_var_val_s(const char *restrict const p_section, const char *restrict const p_var, char *restrict *restrict p_val)
+{
+    return wyini_get_var_val_s_h(&m_wyini_buffer, p_section, p_var, p_val);
+}
+
+
+
+int wyini_get_var_view_s(const char *restrict const p_section, const char *restrict const p_var, wyini_view *restrict p_view)
+{
+    return wyini_get_var_view_s_h(&m_wyini_buffer, p_section, p_var, p_view);
+}
+
+
+
+int wyini_write_val(const char *restrict const p_var, const char *restrict const p_val)
+{
+    return wyini_write_val_h(&m_wyini_buffer, p_var, p_val);
+}
+
+
+
+int wyini_insert_val(const char *restrict const p_var, const char *restrict const p_val)
+{
+    return wyini_insert_val_h(&m_wyini_buffer, p_var, p_val);
+}
+
+
+
+int wyini_insert_val_s(const char *restrict const p_section, const char *restrict const p_var, const char *restrict const p_val)
+{
+    return wyini_insert_val_s_h(&m_wyini_buffer, p_section, p_var, p_val);
+}
+
+
+
+int wyini_insert_many(const char *restrict const p_section, const char *const *restrict p_vars, const char *const *restrict p_vals, const size_t p_count)
+{
+    return wyini_insert_many_h(&m_wyini_buffer, p_section, p_vars, p_vals, p_count);
+}
+
+
+
+int wyini_upsert_val(const char *restrict const p_var, const char *restrict const p_val)
+{
+    return wyini_upsert_val_h(&m_wyini_buffer, p_var, p_val);
+}
+
+
+
+int wyini_upsert_val_s(const char *restrict const p_section, const char *restrict const p_var, const char *restrict const p_val)
+{
+    return wyini_upsert_val_s_h(&m_wyini_buffer, p_section, p_var, p_val);
+}
+
+
+
+int wyini_delete_var(const char *restrict const p_var)
+{
+    return wyini_delete_var_h(&m_wyini_buffer, p_var);
+}
+
+
+
+int wyini_delete_var_s(const char *restrict const p_section, const char *restrict const p_var)
+{
+    return wyini_delete_var_s_h(&m_wyini_buffer, p_section, p_var);
+}
+
+
+int wyini_get_int64(const char *restrict const p_var, int64_t *restrict p_val)
+{
+    return wyini_get_int64_h(&m_wyini_buffer, p_var, p_val);
+}
+
+
+int wyini_get_uint64(const char *restrict const p_var, uint64_t *restrict p_val)
+{
+    return wyini_get_uint64_h(&m_wyini_buffer, p_var, p_val);
+}
+
+
+int wyini_get_double(const char *restrict const p_var, double *restrict p_val)
+{
+    return wyini_get_double_h(&m_wyini_buffer, p_var, p_val);
+}
+
+
+int wyini_get_bool(const char *restrict const p_var, bool *restrict p_val)
+{
+    return wyini_get_bool_h(&m_wyini_buffer, p_var, p_val);
+}
+
+
+int wyini_get_duration(const char *restrict const p_var, uint64_t *restrict p_ms)
+{
+    return wyini_get_duration_h(&m_wyini_buffer, p_var, p_ms);
+}
+
+
+int wyini_set_int64(const char *restrict const p_var, const int64_t p_val)
+{
+    return wyini_set_int64_h(&m_wyini_buffer, p_var, p_val);
+}
+
+
+int wyini_set_uint64(const char *restrict const p_var, const uint64_t p_val)
+{
+    return wyini_set_uint64_h(&m_wyini_buffer, p_var, p_val);
+}
+
+
+int wyini_set_double(const char *restrict const p_var, const double p_val)
+{
+    return wyini_set_double_h(&m_wyini_buffer, p_var, p_val);
+}
+
+
+int wyini_set_bool(const char *restrict const p_var, const bool p_val)
+{
+    return wyini_set_bool_h(&m_wyini_buffer, p_var, p_val);
+}
+
+
+int wyini_set_duration(const char *restrict const p_var, const uint64_t p_ms)
+{
+    return wyini_set_duration_h(&m_wyini_buffer, p_var, p_ms);
+}
+
+
+
+int wyini_schema_load(const wyini_schema_key *restrict p_keys, const size_t p_count, void *restrict p_values, int *restrict p_status)
+{
+    return wyini_schema_load_h(&m_wyini_buffer, p_keys, p_count, p_values, p_status);
+}
\ No newline at end of file
@@ -19,6 +19,186 @@
 #ifndef _WY_INIMGR_H_
 #define _WY_INIMGR_H_
 
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Handle to an opened INI file. Each handle owns its own buffers, so separate handles can be used by separate threads at the same time. A single handle must not be used by more than one thread at a time. The API functions without the _h suffix operate on a default handle maintained by the library.
+ */
+typedef struct S_wyini_buffer wyini_handle_t;
+
+/**
+ * A file watched for changes by wyini_watch_open(). A watcher thread reloads the file into a new read-only handle whenever it changes, while any number of registered reader threads read the latest handle.
+ */
+typedef struct S_wyini_watch wyini_watch_t;
+
+/**
+ * A layered configuration opened by wyini_layers_open(), e.g. a base file with environment and host overrides. Lookups see all layers merged, with later layers overriding earlier ones.
+ */
+typedef struct S_wyini_layers wyini_layers_t;
+
+/**
+ * A configuration published in shared memory by wyini_shm_publish() and attached to by wyini_shm_attach(). All attached processes share one copy of the parsed file.
+ */
+typedef struct S_wyini_shm wyini_shm_t;
+
+/**
+ * An allocator for the memory held by a handle, i.e. the content of the file, its index, written values and cached numbers. The members are listed in WY_IniDefs.h. Pass one to wyini_open_with() to take the memory from somewhere other than malloc(), e.g. an arena from wyini_arena_allocator().
+ */
+typedef struct S_wyini_allocator wyini_allocator;
+
+/**
+ * An arena created by wyini_arena_create(). Allocating from an arena only moves a pointer forward, and everything allocated from it is released at once when the handle using it is cleaned.
+ */
+typedef struct S_wyini_arena wyini_arena_t;
+
+/**
+ * The counters returned by wyini_get_stats(). The members are listed in WY_IniDefs.h.
+ */
+typedef struct S_wyini_stats wyini_stats;
+
+/**
+ * A tracing hook registered with wyini_set_trace_hooks(), called at the beginning and end of every phase.
+ * @param p_phase One of the WYINI_PHASE_* definitions in WY_IniDefs.h.
+ * @param p_user The pointer passed to wyini_set_trace_hooks().
+ */
+typedef void (*wyini_trace_hook)(const int p_phase, void *p_user);
+
+/**
+ * A read-only view of a value inside the internal buffer of a handle. The value is not copied and is not terminated with a 0, so always use m_len. A view stays valid until the handle is next modified, i.e. by a write, save, open, clean or close on the same handle.
+ */
+typedef struct S_wyini_view
+{
+    const char *m_ptr; /**< Points at the first char of the value. */
+    size_t m_len; /**< Length of the value, excluding leading and trailing whitespace. */
+} wyini_view;
+
+/**
+ * A parse of INI content fed in chunks, started by wyini_stream_open(). Unlike a handle it never holds the whole content, so it can parse input of any size, e.g. a generated dump arriving over a pipe.
+ */
+typedef struct S_wyini_stream wyini_stream_t;
+
+/**
+ * A line passed to the callback of a stream. The views point into the chunk being fed or into the stream, so they are only valid until the callback returns.
+ */
+typedef struct S_wyini_stream_line
+{
+    wyini_view m_line; /**< The whole line, excluding the nextline indicator. */
+    wyini_view m_nextline; /**< The nextline indicator that ends the line, i.e. '\n', '\r\n' or a terminating '\0'. Empty for a last line that has none. Writing m_line and m_nextline of every line reproduces the input exactly. */
+    wyini_view m_section; /**< Name of the section the line is in, or of the section it starts if m_header is true. Empty before the first header. */
+    wyini_view m_var; /**< The variable before the first '=', excluding whitespace before the '='. m_ptr is NULL if the line contains no '='. */
+    wyini_view m_val; /**< The value after the first '=', excluding leading and trailing whitespace. Empty if the line contains no '=' or there is no value. */
+    size_t m_line_no; /**< Number of the line, starting from 1. */
+    bool m_header; /**< true if the line is a section header. */
+} wyini_stream_line;
+
+/**
+ * Callback of a stream, called once for every line in file order.
+ * @param p_line The line.
+ * @param p_user The pointer passed to wyini_stream_open().
+ * @return WYINI_OK to continue. Any other value stops the stream and is returned by the wyini_stream_feed() call that passed the line, and by every later call on the stream.
+ */
+typedef int (*wyini_stream_callback)(const wyini_stream_line *p_line, void *p_user);
+
+/**
+ * A variable visited by wyini_iter_next() or wyini_foreach(). The views point into the handle, so like those returned by wyini_get_var_view() they stay valid until the next write, open or clean.
+ */
+typedef struct S_wyini_pair
+{
+    wyini_view m_section; /**< Name of the section the line is in. Empty before the first header. */
+    wyini_view m_var; /**< The variable before the first '=', excluding whitespace before the '='. Empty if the line starts with the '='. */
+    wyini_view m_val; /**< The value after the first '=', excluding leading and trailing whitespace. Values written since the file was opened are included. Empty if there is no value. */
+    size_t m_line_no; /**< Number of the line, starting from 1. Lines are counted like in a stream, so this matches wyini_stream_line::m_line_no for the same content. */
+} wyini_pair;
+
+/**
+ * A cursor over the variables of a handle, set up by wyini_iter_begin(). The members are only meant to be used by wyini_iter_next().
+ */
+typedef struct S_wyini_iter
+{
+    const wyini_handle_t *m_handle; /**< The handle iterated over. */
+    unsigned int m_entry; /**< Index in the index of the handle of the next line to visit. */
+    unsigned int m_line_offset; /**< Offset of the start of line m_line_no. Lines are only counted up to the last line visited. */
+    size_t m_line_no; /**< Number of the line starting at m_line_offset. */
+} wyini_iter;
+
+/**
+ * Callback of wyini_foreach(), called once for every variable in file order.
+ * @param p_pair The variable. Its views stay valid after the callback returns.
+ * @param p_user The pointer passed to wyini_foreach().
+ * @return WYINI_OK to continue. Any other value stops the iteration and is returned by wyini_foreach().
+ */
+typedef int (*wyini_foreach_callback)(const wyini_pair *p_pair, void *p_user);
+
+/**
+ * A key of a schema declared with WYINI_SCHEMA(), which fills in the key table so this is rarely written by hand.
+ */
+typedef struct S_wyini_schema_key
+{
+    const char *m_section; /**< The section to look the variable up in, without the '[' and ']'. NULL to search the whole file regardless of sections. */
+    const char *m_var; /**< The variable name. */
+    int m_type; /**< The type of the value, one of WYINI_TYPED_INT64, WYINI_TYPED_UINT64, WYINI_TYPED_DOUBLE, WYINI_TYPED_BOOL, WYINI_TYPED_DURATION or WYINI_TYPED_STRING. */
+    size_t m_offset; /**< Offset of the member that holds the value in the struct of values. */
+} wyini_schema_key;
+
+#define WYINI_SCHEMA_CTYPE_INT64 int64_t /**< C type of a schema key of type INT64. */
+#define WYINI_SCHEMA_CTYPE_UINT64 uint64_t /**< C type of a schema key of type UINT64. */
+#define WYINI_SCHEMA_CTYPE_DOUBLE double /**< C type of a schema key of type DOUBLE. */
+#define WYINI_SCHEMA_CTYPE_BOOL bool /**< C type of a schema key of type BOOL. */
+#define WYINI_SCHEMA_CTYPE_DURATION uint64_t /**< C type of a schema key of type DURATION, in milliseconds. */
+#define WYINI_SCHEMA_CTYPE_STRING wyini_view /**< C type of a schema key of type STRING. */
+#define WYINI_SCHEMA_INIT_INT64(p_default) (p_default) /**< Initialises the member of a key of type INT64 with its default. */
+#define WYINI_SCHEMA_INIT_UINT64(p_default) (p_default) /**< Initialises the member of a key of type UINT64 with its default. */
+#define WYINI_SCHEMA_INIT_DOUBLE(p_default) (p_default) /**< Initialises the member of a key of type DOUBLE with its default. */
+#define WYINI_SCHEMA_INIT_BOOL(p_default) (p_default) /**< Initialises the member of a key of type BOOL with its default. */
+#define WYINI_SCHEMA_INIT_DURATION(p_default) (p_default) /**< Initialises the member of a key of type DURATION with its default in milliseconds. */
+#define WYINI_SCHEMA_INIT_STRING(p_default) { (p_default), sizeof(p_default) - 1 } /**< Initialises the member of a key of type STRING with its default, which must be a string literal. */
+#define WYINI_SCHEMA_MEMBER(p_id, p_section, p_var, p_type, p_default) WYINI_SCHEMA_CTYPE_##p_type p_id; /**< Declares the member of a key in the struct of values. */
+#define WYINI_SCHEMA_DEFAULT(p_id, p_section, p_var, p_type, p_default) .p_id = WYINI_SCHEMA_INIT_##p_type(p_default), /**< Initialises the member of a key with its default. */
+#define WYINI_SCHEMA_KEY(p_id, p_section, p_var, p_type, p_default) { (p_section), (p_var), WYINI_TYPED_##p_type, offsetof(wyini_schema_values, p_id) }, /**< Describes a key in the key table. */
+
+/**
+ * Declares a schema, i.e. the fixed set of variables an application reads, each with a type and a default. The keys are listed once in an X-macro that calls its argument for every key with an identifier, a section (NULL for the whole file), the variable name, a type of INT64, UINT64, DOUBLE, BOOL, DURATION or STRING, and a default. E.g. <br>
+ * @code
+ * #define APP_KEYS(X) \
+ *  X(port, "server", "port", INT64, 8080) \
+ *  X(host, "server", "host", STRING, "localhost") \
+ *  X(timeout, NULL, "timeout", DURATION, 30000)
+ *
+ * WYINI_SCHEMA(app_config, APP_KEYS)
+ *
+ * app_config config;
+ * if(app_config_load(&config, NULL) != WYINI_OK)
+ *  printf("Some keys are missing or malformed, using their defaults.\n");
+ * listen_on(config.host, config.port);
+ * @endcode
+ * This declares a struct named p_name with one member of the matching C type for every key, so each value is read with a plain member access. A misspelt identifier or a value used as the wrong type is a compile error rather than a failed lookup at runtime.
+ * It also declares p_name_load() and p_name_load_h(), which fill in the struct from the default handle or a given handle. They resolve every key through the index in one call, right after the file is opened, and convert the values as wyini_get_int64() and the other typed accessors do. Keys that are missing or cannot be converted keep their defaults and are reported once, through the return value and the optional status array with one element per key, in the order the keys are listed.
+ * Values of type STRING are views into the handle, so they are only valid until the handle is next modified. Take copies of those that need to outlive it.
+ * @param p_name Name of the struct of values, which also prefixes the load functions.
+ * @param p_keys The X-macro listing the keys.
+ */
+#define WYINI_SCHEMA(p_name, p_keys) \
+    typedef struct p_name { p_keys(WYINI_SCHEMA_MEMBER) } p_name; \
+    static inline int p_name##_load_h(const wyini_handle_t *restrict p_handle, p_name *restrict p_values, int *restrict p_status) \
+    { \
+        typedef p_name wyini_schema_values; \
+        static const wyini_schema_key keys[] = { p_keys(WYINI_SCHEMA_KEY) }; \
+        static const p_name defaults = { p_keys(WYINI_SCHEMA_DEFAULT) }; \
+        *p_values = defaults; \
+        return wyini_schema_load_h(p_handle, keys, sizeof(keys)/sizeof(keys[0]), p_values, p_status); \
+    } \
+    static inline int p_name##_load(p_name *restrict p_values, int *restrict p_status) \
+    { \
+        typedef p_name wyini_schema_values; \
+        static const wyini_schema_key keys[] = { p_keys(WYINI_SCHEMA_KEY) }; \
+        static const p_name defaults = { p_keys(WYINI_SCHEMA_DEFAULT) }; \
+        *p_values = defaults; \
+        return wyini_schema_load(keys, sizeof(keys)/sizeof(keys[0]), p_values, p_status); \
+    }
+
 /**
  * Initialises WY_IniMgr internals. Always call this function first before calling any other API or bad things will happen.
  */
@@ -47,12 +227,97 @@ void wyini_init();
 int wyini_open(const char *restrict const p_file, const unsigned int p_max_size);
 
 /**
- * Saves the content of the internal buffer to a file - overwriting it if it already exists. Obviusly this only works if the internal buffer is already populated via an earlier API calls such as wyini_open(). 
+ * Works like wyini_open() but maps the file into memory instead of copying it into an allocated buffer. This avoids the upfront copy and the allocation of p_max_size bytes, which matters for large or frequently reopened files. 
+ * The mapping is read-only. wyini_write_val() never modifies the mapped content, so the file itself is never modified by it.
+ * If the file cannot be mapped, e.g. on systems without mmap(), the file is read as with wyini_open().
+ * The file must not be truncated or rewritten by anyone else while it is mapped. wyini_save() copies the content out of the mapping before writing, after which the handle behaves as if opened with wyini_open().
+ * @param p_file File to open. 
+ * @param p_max_size Limits the size of the file to parse. E.g. passing 1024*1024 limits us to not parsing a file more than 1MB in size.
+ * @param p_mode Returns the mode used: WYINI_MODE_MMAP if the file was mapped, or WYINI_MODE_READ if it was read. May be NULL.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h. 
+ */
+int wyini_open_mmap(const char *restrict const p_file, const unsigned int p_max_size, int *restrict p_mode);
+
+/**
+ * Compiles an INI file into a binary image for wyini_open_compiled(). The image holds the content of the file together with its index, laid out as they are in memory, plus a version and a checksum. It is saved atomically, so processes that have the previous image open are not disturbed.
+ * Example Usage: <br>
+ * @code
+ * // Once, e.g. when the INI file is generated:
+ * wyini_compile("app.ini", 1024*1024, "app.ini.bin");
+ * // Then in every process:
+ * if(wyini_open_compiled("app.ini.bin", 1024*1024*4) != WYINI_OK)
+ *  wyini_open("app.ini", 1024*1024); // Fall back to parsing the INI file.
+ * @endcode
+ * The image can only be opened on machines with the same byte order and struct layout as the one it was compiled on. Otherwise compile it again from the INI file.
+ * @param p_src_file The INI file to compile.
+ * @param p_max_size Limits the size of the INI file, as in wyini_open().
+ * @param p_out_file The image file to write.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_compile(const char *restrict const p_src_file, const unsigned int p_max_size, const char *restrict const p_out_file);
+
+/**
+ * Works like wyini_open() but opens an image written by wyini_compile(). The image is mapped read-only and used as it is: nothing is parsed, and no memory is allocated for the content or the index, so opening costs about the same for any size of file and processes that open the same image share its memory. Lookups behave exactly as if the INI file had been opened with wyini_open().
+ * The first wyini_write_val() copies the content out of the image and indexes it, after which the handle behaves as if opened with wyini_open(). The image itself is never modified. Where files cannot be mapped, the image is read into memory instead.
+ * @param p_file The image file.
+ * @param p_max_size Limits the size of the image, which is larger than the INI file it was compiled from.
+ * @return WYINI_OK if success. WYINI_IO_ERR if the file cannot be read, or is damaged, of another version or compiled on a different kind of machine. Else another negative value defined in WY_IniDefs.h.
+ */
+int wyini_open_compiled(const char *restrict const p_file, const unsigned int p_max_size);
+
+/**
+ * Works like wyini_open() but takes all the memory held by the internal buffers from an allocator instead of malloc(). With an arena, every buffer is allocated from one region, wyini_clean() releases them all in one step, and opening the next file reuses the same memory, so a reload does not allocate at all once the arena is large enough. E.g. <br>
+ * @code
+ * static char region[1024*1024];
+ * wyini_arena_t *arena;
+ * wyini_allocator allocator;
+ *
+ * if(wyini_arena_create(region, sizeof(region), &arena) == WYINI_OK) {
+ *  wyini_arena_allocator(arena, &allocator);
+ *  if(wyini_open_with("inifile", 1024*64, &allocator) == WYINI_OK)
+ *      ... // Read and write as usual.
+ *  wyini_clean();
+ *  wyini_arena_destroy(arena);
+ * }
+ * @endcode
+ * The allocator is used until the next wyini_open() or wyini_clean(), after which the default allocator is used again. An arena must only be used by one handle at a time, since cleaning the handle resets the whole arena.
+ * @param p_file File to open.
+ * @param p_max_size Limits the size of the file to parse.
+ * @param p_allocator The allocator, which is copied. NULL uses malloc() like wyini_open().
+ * @return WYINI_OK if success. WYINI_MEMORY_ERR if the allocator ran out of memory. Else another negative value defined in WY_IniDefs.h.
+ */
+int wyini_open_with(const char *restrict const p_file, const unsigned int p_max_size, const wyini_allocator *restrict p_allocator);
+
+/**
+ * Saves the content of the internal buffer to a file - overwriting it if it already exists. Obviusly this only works if the internal buffer is already populated via an earlier API calls such as wyini_open(). Where possible only the blocks holding changed values are overwritten, as described in wyini_save_bytes().
  * @param p_file The file name.
  * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
  */
 int wyini_save(const char *restrict const p_file);
 
+/**
+ * Saves the content of the internal buffer to a file and returns how many bytes that took. Works like wyini_save(), which also only writes what changed: if p_file is the file last read or saved, nobody else modified or replaced it since, and every value written since kept its length, only the blocks of WYINI_DIRTY_BLOCK bytes holding changed values are overwritten in place and the file keeps its length. Otherwise, e.g. after a value changed length, a variable was inserted or deleted, or another process saved the file, the whole file is written. Partial writes need pwrite() and are not done on Windows.
+ * Example Usage: <br>
+ * @code
+ * size_t bytes;
+ * wyini_write_val("LOG_LEVEL", "2");
+ * if(wyini_save_bytes("settings.ini", &bytes) == WYINI_OK)
+ *  printf("Saved %zu bytes.\n", bytes); // At most 2*WYINI_DIRTY_BLOCK bytes if the old value was one char.
+ * @endcode
+ * @param p_file The file name.
+ * @param p_bytes_written Returns the number of bytes written, which is 0 if nothing changed since the last save. 0 if the save fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_save_bytes(const char *restrict const p_file, size_t *restrict p_bytes_written);
+
+/**
+ * Saves the content of the internal buffer to a file atomically. Works like wyini_save() but the content is first written to a temporary file in the same directory and synced to disk, then renamed over p_file. A crash or failed write during the save never leaves a partly written p_file, and other processes reading p_file see either the complete old or the complete new content.
+ * Unlike wyini_save() the internal buffer is not modified. Written values are saved straight from where they are held, and a file opened with wyini_open_mmap() stays mapped, since the mapped file is replaced rather than overwritten. The whole file is always written. If p_file is the file last read or saved, the replaced file is tracked from then on, so the next wyini_save() to it still only writes what changed.
+ * @param p_file The file name. The directory must allow creating the temporary file.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h, in which case p_file is unchanged.
+ */
+int wyini_save_atomic(const char *restrict const p_file);
+
 /**
  * Cleans up the internal buffers. Call this function when all read/write operations are completed. Note that wyini_open() calls this function implicitly at the beginning of execution, but NOT at the end of execution. Hence this function must be called for a final clean-up. 
  */
@@ -67,15 +332,955 @@ void wyini_clean();
 int wyini_get_var_val(const char *restrict const p_var, char *restrict *restrict p_val);
 
 /**
- * Writes the char value of an existing variable to the internal buffer opened by wyini_open().  
+ * Gets a view of the value of a variable without copying it. Unlike wyini_get_var_val() there is no limit on the length of the value, and views returned by earlier calls are not overwritten.
+ * Example Usage: <br>
+ * @code
+ * wyini_view view;
+ * 
+ * if(wyini_get_var_view("VAR_1", &view) == WYINI_OK)
+ *  printf("The value of VAR_1 is %.*s\n", (int)view.m_len, view.m_ptr);
+ * @endcode
+ * @param p_var The variable name to search for.
+ * @param p_view Returns the view of the value assigned to p_var. Left unchanged if the function fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_get_var_view(const char *restrict const p_var, wyini_view *restrict p_view);
+
+/**
+ * Gets views of the values of several variables in one call. Variables that can be looked up through the index are resolved directly, and all the others are found together in a single pass over the buffer, so reading many variables right after wyini_open() costs at most one scan instead of one per variable. Each result is the same as wyini_get_var_view() would have returned for that variable. E.g. <br>
+ * @code
+ * const char *vars[] = { "VAR_1", "VAR_2", "VAR_3" };
+ * wyini_view views[3];
+ * int status[3];
+ * wyini_get_many(vars, 3, views, status);
+ * if(status[1] == WYINI_OK)
+ *  printf("VAR_2=%.*s\n", (int)views[1].m_len, views[1].m_ptr);
+ * @endcode
+ * @param p_vars The variable names to search for.
+ * @param p_count Number of variable names in p_vars.
+ * @param p_views Returns the view of the value of each variable, at the same position as its name in p_vars. Views of variables that are not found are left unchanged.
+ * @param p_status Returns the result for each variable, at the same position as its name in p_vars: WYINI_OK if found, else a negative value defined in WY_IniDefs.h.
+ * @return WYINI_OK if every variable was found. WYINI_NOT_FOUND if at least one was not, in which case p_status tells which. WYINI_MEMORY_ERR if nothing could be searched.
+ */
+int wyini_get_many(const char *const *restrict p_vars, const size_t p_count, wyini_view *restrict p_views, int *restrict p_status);
+
+/**
+ * Starts a cursor over every 'var=val' line in file order, for dumping, validating or comparing a whole configuration. The lines are visited straight from the index built by wyini_open(), so a full pass costs one walk over the buffer and nothing is copied. E.g. <br>
+ * @code
+ * wyini_iter iter;
+ * wyini_pair pair;
+ *
+ * wyini_iter_begin(&iter);
+ * while(wyini_iter_next(&iter, &pair) == WYINI_OK)
+ *  printf("%zu: [%.*s] %.*s=%.*s\n", pair.m_line_no, (int)pair.m_section.m_len, pair.m_section.m_ptr, (int)pair.m_var.m_len, pair.m_var.m_ptr, (int)pair.m_val.m_len, pair.m_val.m_ptr);
+ * @endcode
+ * Every line with a '=' is visited, including variables defined more than once and lines with no value, so the results may differ from looking the variables up. The cursor must not be used after the next write, open or clean.
+ * @param p_iter Returns the cursor. It holds no memory, so there is nothing to release.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_iter_begin(wyini_iter *restrict p_iter);
+
+/**
+ * Moves a cursor to the next 'var=val' line.
+ * @param p_iter The cursor set up by wyini_iter_begin() or wyini_iter_begin_h().
+ * @param p_pair Returns the variable on the line. Left unchanged if the function fails.
+ * @return WYINI_OK if success. WYINI_NOT_FOUND once every line has been visited.
+ */
+int wyini_iter_next(wyini_iter *restrict p_iter, wyini_pair *restrict p_pair);
+
+/**
+ * Calls a function for every 'var=val' line in file order. Visits the same lines as wyini_iter_next() with a cursor. E.g. <br>
+ * @code
+ * static int print_pair(const wyini_pair *p_pair, void *p_user)
+ * {
+ *  printf("%.*s=%.*s\n", (int)p_pair->m_var.m_len, p_pair->m_var.m_ptr, (int)p_pair->m_val.m_len, p_pair->m_val.m_ptr);
+ *  return WYINI_OK;
+ * }
+ *
+ * wyini_foreach(print_pair, NULL);
+ * @endcode
+ * @param p_callback Called for every line. It must not modify the handle.
+ * @param p_user Passed to p_callback.
+ * @return WYINI_OK if every line was visited. The value returned by p_callback if it stopped the iteration. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_foreach(const wyini_foreach_callback p_callback, void *p_user);
+
+/**
+ * Gets the char value of a variable within a section. A section starts at a header line of the form '[name]' and runs until the next header. Works like wyini_get_var_val() but only the lines of the section are considered, so the same variable can be read from different sections.
+ * If several sections have the same name, they are searched as one in file order. Lines before the first header belong to the section with the empty name "".
+ * Example Usage: <br>
+ * @code
+ * char *val;
+ * 
+ * if(wyini_get_var_val_s("backend_1", "port", &val) == WYINI_OK)
+ *  printf("port of backend_1 is %s\n", val);
+ * @endcode
+ * @param p_section The section name without the '[' and ']' and without surrounding whitespace. 
+ * @param p_var The variable name to search for.
+ * @param p_val Returns the value assigned to p_var.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h. WYINI_NOT_FOUND is returned if either the section or the variable does not exist.
+ */
+int wyini_get_var_val_s(const char *restrict const p_section, const char *restrict const p_var, char *restrict *restrict p_val);
+
+/**
+ * Gets a view of the value of a variable within a section without copying it. Combines wyini_get_var_val_s() and wyini_get_var_view().
+ * @param p_section The section name without the '[' and ']' and without surrounding whitespace. 
+ * @param p_var The variable name to search for.
+ * @param p_view Returns the view of the value assigned to p_var. Left unchanged if the function fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_get_var_view_s(const char *restrict const p_section, const char *restrict const p_var, wyini_view *restrict p_view);
+
+/**
+ * Writes the char value of an existing variable to the internal buffer opened by wyini_open(). To add or remove variables, see wyini_insert_val_s(), wyini_upsert_val_s() and wyini_delete_var_s().
+ * The value is recorded separately and the content is only put back together in one piece by wyini_save(), so a write costs about the length of the value regardless of the size of the file, and the content may grow past the size passed to wyini_open().
  * @param p_var The variable name.
  * @param p_val The value to write.
  * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h. Causes for error are usually:<br>
  * (1) The internal buffer is empty. <br>
  * (2) The variable does not exist. <br>
- * (3) Writing the variable exceeds the maximum allowed size of the file or variable length.
+ * (3) The value is longer than WYINI_MAX_VAL_LEN-1 or memory allocation failed.
 */
 int wyini_write_val(const char *restrict const p_var, const char *restrict const p_val);
 
+/**
+ * Inserts a new variable as a line of the form 'var=val'. Works like wyini_insert_val_s() with no section, i.e. the line is appended to the end of the content and p_var must not be assigned anywhere in it yet.
+ * @param p_var The variable name.
+ * @param p_val The value.
+ * @return WYINI_OK if success. WYINI_EXISTS if the variable is already assigned. Else another negative value defined in WY_IniDefs.h.
+ */
+int wyini_insert_val(const char *restrict const p_var, const char *restrict const p_val);
+
+/**
+ * Inserts a new variable into a section as a line of the form 'var=val'. The line is inserted after the last line of the section that is not blank, so that blank lines before the next header stay in place. If several sections have the name, it goes into the last of them. If no section has the name, a '[section]' header is appended to the end of the content, followed by the line.
+ * Lines inserted at the end of the content are appended in place. The internal buffer grows geometrically as needed and only the new lines are indexed, so inserting variables one by one at the end costs about as much as reading them. Inserting anywhere else puts the content together in a new buffer, in which case wyini_insert_many() should be used to insert many variables in one pass.
+ * New lines end with the nextline indicator of the first line in the content, i.e. "\r\n" or "\n".
+ * Example Usage: <br>
+ * @code
+ * if(wyini_insert_val_s("backend_3", "port", "8083") == WYINI_EXISTS)
+ *  wyini_write_val("port", "8083");
+ * @endcode
+ * @param p_section The section name without the '[' and ']'. May be "" for the lines before the first header. NULL appends the line to the end of the content regardless of sections.
+ * @param p_var The variable name. Must not be empty, contain '=', '\r' or '\n', start with '[' or whitespace, or end with whitespace.
+ * @param p_val The value. Must not contain '\r' or '\n'.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h. Causes for error are usually:<br>
+ * (1) The internal buffer is empty. <br>
+ * (2) The variable is already assigned in the section, or anywhere in the content if p_section is NULL. WYINI_EXISTS is returned. <br>
+ * (3) The section, variable or value cannot be written as a line. WYINI_NAME_ERR is returned. <br>
+ * (4) The value is longer than WYINI_MAX_VAL_LEN-1 or memory allocation failed.
+ */
+int wyini_insert_val_s(const char *restrict const p_section, const char *restrict const p_var, const char *restrict const p_val);
+
+/**
+ * Inserts many new variables into a section in one pass. The lines are inserted together, in the order given, where wyini_insert_val_s() would insert the first of them, so the content is put together or appended to once for the whole batch.
+ * Either every variable is inserted or none is. A batch naming the same variable twice returns WYINI_EXISTS.
+ * Example Usage: <br>
+ * @code
+ * const char *vars[] = { "host", "port", "timeout" };
+ * const char *vals[] = { "10.0.0.3", "8083", "30s" };
+ * wyini_insert_many("backend_3", vars, vals, 3);
+ * @endcode
+ * @param p_section The section name, as for wyini_insert_val_s().
+ * @param p_vars The variable names.
+ * @param p_vals The values, at the same position as their names in p_vars.
+ * @param p_count Number of variables in p_vars.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h, as for wyini_insert_val_s(), for the first variable that cannot be inserted.
+ */
+int wyini_insert_many(const char *restrict const p_section, const char *const *restrict p_vars, const char *const *restrict p_vals, const size_t p_count);
+
+/**
+ * Writes the value of a variable, inserting it if it does not exist. Works like wyini_upsert_val_s() with no section.
+ * @param p_var The variable name.
+ * @param p_val The value.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_upsert_val(const char *restrict const p_var, const char *restrict const p_val);
+
+/**
+ * Writes the value of a variable within a section, inserting it if it does not exist. The first line assigning to the variable in the section is written like wyini_write_val() would, even if it has no value yet. Otherwise the variable is inserted with wyini_insert_val_s().
+ * @param p_section The section name, as for wyini_insert_val_s(). NULL writes the first line assigning to the variable anywhere in the content.
+ * @param p_var The variable name, as for wyini_insert_val_s().
+ * @param p_val The value, as for wyini_insert_val_s().
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_upsert_val_s(const char *restrict const p_section, const char *restrict const p_var, const char *restrict const p_val);
+
+/**
+ * Deletes a variable. Works like wyini_delete_var_s() with no section.
+ * @param p_var The variable name.
+ * @return WYINI_OK if success. WYINI_NOT_FOUND if the variable is not assigned anywhere. Else another negative value defined in WY_IniDefs.h.
+ */
+int wyini_delete_var(const char *restrict const p_var);
+
+/**
+ * Deletes a variable within a section by removing every line that assigns to it there, so that it is no longer found at all. The content is put together in a new buffer, with all values written so far in place.
+ * @param p_section The section name without the '[' and ']'. All sections with the name are considered. NULL removes the lines assigning to the variable anywhere in the content.
+ * @param p_var The variable name, as for wyini_insert_val_s().
+ * @return WYINI_OK if success. WYINI_NOT_FOUND if the section does not exist or the variable is not assigned in it. Else another negative value defined in WY_IniDefs.h.
+ */
+int wyini_delete_var_s(const char *restrict const p_section, const char *restrict const p_var);
+
+/**
+ * Gets the value of a variable as a signed 64-bit integer. The value may be decimal, or hexadecimal with a "0x" prefix, with an optional sign.
+ * The converted value is cached with the line it was read from, so calling this again, e.g. to poll a setting in a loop, costs one index lookup and no conversion until the line is written. Lookups of names that cannot use the index, such as names ending in whitespace, are converted on every call. The other typed accessors below behave the same.
+ * Example Usage: <br>
+ * @code
+ * int64_t count;
+ * 
+ * if(wyini_get_int64("NUM_VAR_1", &count) == WYINI_OK)
+ *  wyini_set_int64("NUM_VAR_1", count + 1);
+ * @endcode
+ * @param p_var The variable name to search for.
+ * @param p_val Returns the value. Left unchanged if the function fails.
+ * @return WYINI_OK if success. WYINI_TYPE_ERR if the value is not an integer or out of range. Else another negative value defined in WY_IniDefs.h.
+ */
+int wyini_get_int64(const char *restrict const p_var, int64_t *restrict p_val);
+
+/**
+ * Gets the value of a variable as an unsigned 64-bit integer. Works like wyini_get_int64() but the value must not be negative.
+ * @param p_var The variable name to search for.
+ * @param p_val Returns the value. Left unchanged if the function fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_get_uint64(const char *restrict const p_var, uint64_t *restrict p_val);
+
+/**
+ * Gets the value of a variable as a double. Any number strtod() accepts is allowed, but the whole value must be the number.
+ * @param p_var The variable name to search for.
+ * @param p_val Returns the value. Left unchanged if the function fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_get_double(const char *restrict const p_var, double *restrict p_val);
+
+/**
+ * Gets the value of a variable as a boolean. "true", "yes", "on" and "1" are true and "false", "no", "off" and "0" are false, in any case.
+ * @param p_var The variable name to search for.
+ * @param p_val Returns the value. Left unchanged if the function fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_get_bool(const char *restrict const p_var, bool *restrict p_val);
+
+/**
+ * Gets the value of a variable as a duration in milliseconds. The value is one or more numbers each followed by a unit of "d", "h", "m", "s" or "ms", e.g. "1h30m", "90s" or "250 ms". A lone number without a unit is taken as milliseconds.
+ * @param p_var The variable name to search for.
+ * @param p_ms Returns the duration in milliseconds. Left unchanged if the function fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_get_duration(const char *restrict const p_var, uint64_t *restrict p_ms);
+
+/**
+ * Writes a signed 64-bit integer to an existing variable, in decimal. Works like wyini_write_val().
+ * @param p_var The variable name.
+ * @param p_val The value to write.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_set_int64(const char *restrict const p_var, const int64_t p_val);
+
+/**
+ * Writes an unsigned 64-bit integer to an existing variable, in decimal. Works like wyini_write_val().
+ * @param p_var The variable name.
+ * @param p_val The value to write.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_set_uint64(const char *restrict const p_var, const uint64_t p_val);
+
+/**
+ * Writes a double to an existing variable. Works like wyini_write_val(). The value is written with the fewest digits that wyini_get_double() reads back as exactly the same double, and whole numbers are written without a fraction.
+ * @param p_var The variable name.
+ * @param p_val The value to write.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_set_double(const char *restrict const p_var, const double p_val);
+
+/**
+ * Writes "true" or "false" to an existing variable. Works like wyini_write_val().
+ * @param p_var The variable name.
+ * @param p_val The value to write.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_set_bool(const char *restrict const p_var, const bool p_val);
+
+/**
+ * Writes a duration to an existing variable in the largest unit that holds it exactly, e.g. "90s" for 90000. Works like wyini_write_val().
+ * @param p_var The variable name.
+ * @param p_ms The duration in milliseconds.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_set_duration(const char *restrict const p_var, const uint64_t p_ms);
+
+/**
+ * Looks up every key of a schema and stores the converted values in a struct. Usually called through the p_name_load() function declared by WYINI_SCHEMA().
+ * @param p_keys The keys.
+ * @param p_count Number of keys.
+ * @param p_values The struct of values, already holding the defaults. The member of each key found and converted is overwritten.
+ * @param p_status Returns the result for each key: WYINI_OK, WYINI_NOT_FOUND or WYINI_VAL_NOT_FOUND if the variable or its value is missing, or WYINI_TYPE_ERR if the value is not of the type. May be NULL.
+ * @return WYINI_OK if every key was found and converted. Else the result of the first key that was not.
+ */
+int wyini_schema_load(const wyini_schema_key *restrict p_keys, const size_t p_count, void *restrict p_values, int *restrict p_status);
+
+
+/**
+ * Opens a file into a new handle. Works like wyini_open() but does not touch the default handle, and there is no need to call wyini_init() first. 
+ * Example Usage: <br>
+ * @code
+ * wyini_handle_t *handle;
+ * char *val;
+ * 
+ * if(wyini_open_h("inifile", 1024, &handle) == WYINI_OK) { 
+ *  if(wyini_get_var_val_h(handle, "VAR_1", &val) == WYINI_OK)
+ *      printf("The value of VAR_1 in inifile is %s\n", val);
+ *  wyini_close_h(handle); 
+ * } 
+ * @endcode
+ * @param p_file File to open. 
+ * @param p_max_size Limits the size of the file to parse. E.g. passing 1024*1024 limits us to not parsing a file more than 1MB in size.
+ * @param p_handle Returns the new handle. This is set to NULL if the function fails. Release the handle with wyini_close_h().
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h. 
+ */
+int wyini_open_h(const char *restrict const p_file, const unsigned int p_max_size, wyini_handle_t *restrict *restrict p_handle);
+
+/**
+ * Opens a file into a new handle by mapping it into memory. Works like wyini_open_mmap().
+ * @param p_file File to open. 
+ * @param p_max_size Limits the size of the file to parse.
+ * @param p_mode Returns the mode used: WYINI_MODE_MMAP or WYINI_MODE_READ. May be NULL.
+ * @param p_handle Returns the new handle. This is set to NULL if the function fails. Release the handle with wyini_close_h().
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h. 
+ */
+int wyini_open_mmap_h(const char *restrict const p_file, const unsigned int p_max_size, int *restrict p_mode, wyini_handle_t *restrict *restrict p_handle);
+
+/**
+ * Opens an image written by wyini_compile() into a new handle. Works like wyini_open_compiled().
+ * @param p_file The image file.
+ * @param p_max_size Limits the size of the image.
+ * @param p_handle Returns the new handle. This is set to NULL if the function fails. Release the handle with wyini_close_h().
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_open_compiled_h(const char *restrict const p_file, const unsigned int p_max_size, wyini_handle_t *restrict *restrict p_handle);
+
+/**
+ * Opens a file into a new handle whose buffers are allocated by an allocator. Works like wyini_open_with(). The handle itself is allocated with malloc(), so it stays valid while the allocator is reset. wyini_close_h() frees the buffers through the allocator and then calls its m_release.
+ * @param p_file File to open.
+ * @param p_max_size Limits the size of the file to parse.
+ * @param p_allocator The allocator, which is copied. NULL uses malloc() like wyini_open_h().
+ * @param p_handle Returns the new handle. This is set to NULL if the function fails. Release the handle with wyini_close_h().
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_open_with_h(const char *restrict const p_file, const unsigned int p_max_size, const wyini_allocator *restrict p_allocator, wyini_handle_t *restrict *restrict p_handle);
+
+/**
+ * Saves the content of a handle to a file - overwriting it if it already exists. Works like wyini_save(). The written values are first put in place in a new buffer. This also copies the content out of a mapping made by wyini_open_mmap_h(), since the file being saved to may be the mapped file.
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_file The file name.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_save_h(wyini_handle_t *restrict p_handle, const char *restrict const p_file);
+
+/**
+ * Saves the content of a handle to a file and returns how many bytes that took. Works like wyini_save_bytes().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_file The file name.
+ * @param p_bytes_written Returns the number of bytes written. 0 if the save fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_save_bytes_h(wyini_handle_t *restrict p_handle, const char *restrict const p_file, size_t *restrict p_bytes_written);
+
+/**
+ * Saves the content of a handle to a file atomically. Works like wyini_save_atomic(). The content of the handle is not modified, only the version of the file it tracks for wyini_save_h(), so this may be called while other threads read the handle.
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_file The file name.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h, in which case p_file is unchanged.
+ */
+int wyini_save_atomic_h(wyini_handle_t *restrict p_handle, const char *restrict const p_file);
+
+/**
+ * Frees a handle returned by wyini_open_h() along with all its buffers. Passing NULL does nothing.
+ * @param p_handle The handle to close.
+ */
+void wyini_close_h(wyini_handle_t *restrict p_handle);
+
+/**
+ * Gets the char value of a variable in a handle. Works like wyini_get_var_val(). The value returned is held by the handle and is overwritten by the next call with the same handle.
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_var The variable name to search for.
+ * @param p_val Returns the value assigned to p_var.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_get_var_val_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, char *restrict *restrict p_val);
+
+/**
+ * Gets a view of the value of a variable in a handle without copying it. Works like wyini_get_var_view(). This function does not modify the handle, so several threads may call it on the same handle at once as long as none of them modifies the handle.
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_var The variable name to search for.
+ * @param p_view Returns the view of the value assigned to p_var. Left unchanged if the function fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_get_var_view_h(const wyini_handle_t *restrict p_handle, const char *restrict const p_var, wyini_view *restrict p_view);
+
+/**
+ * Gets views of the values of several variables in a handle in one call. Works like wyini_get_many(). Like wyini_get_var_view_h() this does not modify the handle.
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_vars The variable names to search for.
+ * @param p_count Number of variable names in p_vars.
+ * @param p_views Returns the view of the value of each variable. Views of variables that are not found are left unchanged.
+ * @param p_status Returns the result for each variable.
+ * @return WYINI_OK if every variable was found. WYINI_NOT_FOUND if at least one was not. WYINI_MEMORY_ERR if nothing could be searched.
+ */
+int wyini_get_many_h(const wyini_handle_t *restrict p_handle, const char *const *restrict p_vars, const size_t p_count, wyini_view *restrict p_views, int *restrict p_status);
+
+/**
+ * Starts a cursor over every 'var=val' line of a handle. Works like wyini_iter_begin(). Like wyini_get_var_view_h() this does not modify the handle, so several threads may iterate over the same handle at once, each with its own cursor.
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_iter Returns the cursor. Move it with wyini_iter_next().
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_iter_begin_h(const wyini_handle_t *restrict p_handle, wyini_iter *restrict p_iter);
+
+/**
+ * Calls a function for every 'var=val' line of a handle in file order. Works like wyini_foreach(), and does not modify the handle.
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_callback Called for every line. It must not modify the handle.
+ * @param p_user Passed to p_callback.
+ * @return WYINI_OK if every line was visited. The value returned by p_callback if it stopped the iteration. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_foreach_h(const wyini_handle_t *restrict p_handle, const wyini_foreach_callback p_callback, void *p_user);
+
+/**
+ * Gets the char value of a variable within a section of a handle. Works like wyini_get_var_val_s().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_section The section name without the '[' and ']' and without surrounding whitespace. 
+ * @param p_var The variable name to search for.
+ * @param p_val Returns the value assigned to p_var.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_get_var_val_s_h(wyini_handle_t *restrict p_handle, const char *restrict const p_section, const char *restrict const p_var, char *restrict *restrict p_val);
+
+/**
+ * Gets a view of the value of a variable within a section of a handle. Works like wyini_get_var_view_s().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_section The section name without the '[' and ']' and without surrounding whitespace. 
+ * @param p_var The variable name to search for.
+ * @param p_view Returns the view of the value assigned to p_var. Left unchanged if the function fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_get_var_view_s_h(const wyini_handle_t *restrict p_handle, const char *restrict const p_section, const char *restrict const p_var, wyini_view *restrict p_view);
+
+/**
+ * Writes the char value of an existing variable in a handle. Works like wyini_write_val().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_var The variable name.
+ * @param p_val The value to write.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_write_val_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const char *restrict const p_val);
+
+/**
+ * Inserts a new variable into a handle. Works like wyini_insert_val().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_var The variable name.
+ * @param p_val The value.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_insert_val_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const char *restrict const p_val);
+
+/**
+ * Inserts a new variable into a section of a handle. Works like wyini_insert_val_s().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_section The section name, or NULL.
+ * @param p_var The variable name.
+ * @param p_val The value.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_insert_val_s_h(wyini_handle_t *restrict p_handle, const char *restrict const p_section, const char *restrict const p_var, const char *restrict const p_val);
+
+/**
+ * Inserts many new variables into a section of a handle in one pass. Works like wyini_insert_many().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_section The section name, or NULL.
+ * @param p_vars The variable names.
+ * @param p_vals The values.
+ * @param p_count Number of variables in p_vars.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_insert_many_h(wyini_handle_t *restrict p_handle, const char *restrict const p_section, const char *const *restrict p_vars, const char *const *restrict p_vals, const size_t p_count);
+
+/**
+ * Writes the value of a variable in a handle, inserting it if it does not exist. Works like wyini_upsert_val().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_var The variable name.
+ * @param p_val The value.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_upsert_val_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const char *restrict const p_val);
+
+/**
+ * Writes the value of a variable within a section of a handle, inserting it if it does not exist. Works like wyini_upsert_val_s().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_section The section name, or NULL.
+ * @param p_var The variable name.
+ * @param p_val The value.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_upsert_val_s_h(wyini_handle_t *restrict p_handle, const char *restrict const p_section, const char *restrict const p_var, const char *restrict const p_val);
+
+/**
+ * Deletes a variable from a handle. Works like wyini_delete_var().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_var The variable name.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_delete_var_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var);
+
+/**
+ * Deletes a variable within a section of a handle. Works like wyini_delete_var_s().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_section The section name, or NULL.
+ * @param p_var The variable name.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_delete_var_s_h(wyini_handle_t *restrict p_handle, const char *restrict const p_section, const char *restrict const p_var);
+
+/**
+ * Gets the value of a variable in a handle as a signed 64-bit integer. Works like wyini_get_int64(). The converted value is cached in the handle, so unlike wyini_get_var_view_h() this needs a non-const handle and must not be used on a handle returned by wyini_watch_enter().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_var The variable name to search for.
+ * @param p_val Returns the value. Left unchanged if the function fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_get_int64_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, int64_t *restrict p_val);
+
+/**
+ * Gets the value of a variable in a handle as an unsigned 64-bit integer. Works like wyini_get_uint64().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_var The variable name to search for.
+ * @param p_val Returns the value. Left unchanged if the function fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_get_uint64_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, uint64_t *restrict p_val);
+
+/**
+ * Gets the value of a variable in a handle as a double. Works like wyini_get_double().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_var The variable name to search for.
+ * @param p_val Returns the value. Left unchanged if the function fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_get_double_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, double *restrict p_val);
+
+/**
+ * Gets the value of a variable in a handle as a boolean. Works like wyini_get_bool().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_var The variable name to search for.
+ * @param p_val Returns the value. Left unchanged if the function fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_get_bool_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, bool *restrict p_val);
+
+/**
+ * Gets the value of a variable in a handle as a duration in milliseconds. Works like wyini_get_duration().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_var The variable name to search for.
+ * @param p_ms Returns the duration in milliseconds. Left unchanged if the function fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_get_duration_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, uint64_t *restrict p_ms);
+
+/**
+ * Writes a signed 64-bit integer to an existing variable in a handle. Works like wyini_set_int64().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_var The variable name.
+ * @param p_val The value to write.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_set_int64_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const int64_t p_val);
+
+/**
+ * Writes an unsigned 64-bit integer to an existing variable in a handle. Works like wyini_set_uint64().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_var The variable name.
+ * @param p_val The value to write.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_set_uint64_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const uint64_t p_val);
+
+/**
+ * Writes a double to an existing variable in a handle. Works like wyini_set_double().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_var The variable name.
+ * @param p_val The value to write.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_set_double_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const double p_val);
+
+/**
+ * Writes "true" or "false" to an existing variable in a handle. Works like wyini_set_bool().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_var The variable name.
+ * @param p_val The value to write.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_set_bool_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const bool p_val);
+
+/**
+ * Writes a duration to an existing variable in a handle. Works like wyini_set_duration().
+ * @param p_handle The handle returned by wyini_open_h().
+ * @param p_var The variable name.
+ * @param p_ms The duration in milliseconds.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_set_duration_h(wyini_handle_t *restrict p_handle, const char *restrict const p_var, const uint64_t p_ms);
+
+/**
+ * Looks up every key of a schema in a handle. Works like wyini_schema_load(). Nothing is cached in the handle, so this can be used on the handles returned by wyini_watch_enter().
+ * @param p_handle The handle to search.
+ * @param p_keys The keys.
+ * @param p_count Number of keys.
+ * @param p_values The struct of values, already holding the defaults.
+ * @param p_status Returns the result for each key. May be NULL.
+ * @return WYINI_OK if every key was found and converted. Else the result of the first key that was not.
+ */
+int wyini_schema_load_h(const wyini_handle_t *restrict p_handle, const wyini_schema_key *restrict p_keys, const size_t p_count, void *restrict p_values, int *restrict p_status);
+
+
+/**
+ * Opens a file and starts watching it for changes. Whenever the file is written or replaced, e.g. by wyini_save() or wyini_save_atomic() in another process, a watcher thread reads it into a new handle and publishes it to readers. If the new version cannot be read, the previous one stays published. Only supported on Linux.
+ * @param p_file The file to watch.
+ * @param p_max_size Maximum size of the file. Works like in wyini_open_h().
+ * @param p_watch Returns the watch. This is set to NULL if the function fails. Release it with wyini_watch_close().
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h. WYINI_IO_ERR if the file cannot be watched, including on systems other than Linux.
+ */
+int wyini_watch_open(const char *restrict const p_file, const unsigned int p_max_size, wyini_watch_t *restrict *restrict p_watch);
+
+/**
+ * Stops watching a file and frees all its handles. All readers must have unregistered first.
+ * @param p_watch The watch returned by wyini_watch_open(). May be NULL.
+ */
+void wyini_watch_close(wyini_watch_t *restrict p_watch);
+
+/**
+ * Registers the calling thread as a reader of a watch. Each reader thread needs its own slot.
+ * @param p_watch The watch returned by wyini_watch_open().
+ * @param p_reader Returns the reader slot to pass to wyini_watch_enter() and wyini_watch_leave().
+ * @return WYINI_OK if success. WYINI_MEMORY_ERR if WYINI_WATCH_MAX_READERS readers are already registered.
+ */
+int wyini_watch_register(wyini_watch_t *restrict p_watch, unsigned int *restrict p_reader);
+
+/**
+ * Releases a reader slot. The reader must not be inside a handle.
+ * @param p_watch The watch returned by wyini_watch_open().
+ * @param p_reader The slot returned by wyini_watch_register().
+ */
+void wyini_watch_unregister(wyini_watch_t *restrict p_watch, const unsigned int p_reader);
+
+/**
+ * Gets the latest handle of a watched file for reading. Never blocks. The handle and views into it stay valid until wyini_watch_leave() is called, even if the file is reloaded in the meantime. Only pass the handle to functions that take a const handle, e.g. wyini_get_var_view_h(), and call wyini_watch_enter() again for each batch of reads to see newer versions.
+ * @param p_watch The watch returned by wyini_watch_open().
+ * @param p_reader The slot returned by wyini_watch_register().
+ * @return The latest handle.
+ */
+const wyini_handle_t * wyini_watch_enter(wyini_watch_t *restrict p_watch, const unsigned int p_reader);
+
+/**
+ * Tells a watch that a reader is done with the handle returned by wyini_watch_enter(), so it can be freed once a newer version is published.
+ * @param p_watch The watch returned by wyini_watch_open().
+ * @param p_reader The slot returned by wyini_watch_register().
+ */
+void wyini_watch_leave(wyini_watch_t *restrict p_watch, const unsigned int p_reader);
+
+/**
+ * Gets the number of times a watched file has been reloaded, e.g. to detect that the values should be read again.
+ * @param p_watch The watch returned by wyini_watch_open().
+ * @return Number of successful reloads since wyini_watch_open().
+ */
+unsigned long wyini_watch_version(wyini_watch_t *restrict p_watch);
+
+/**
+ * Starts parsing INI content that is fed in chunks, e.g. from a pipe or a file too large to open. Lines, sections and 'var=val' patterns follow the same rules as in wyini_open(), and each line is passed to a callback as soon as it is complete. The memory used is fixed by p_max_line, not by the size of the input. E.g. <br>
+ * @code
+ * static int print_var(const wyini_stream_line *p_line, void *p_user)
+ * {
+ *  if(p_line->m_var.m_ptr != NULL)
+ *      printf("%.*s=%.*s\n", (int)p_line->m_var.m_len, p_line->m_var.m_ptr, (int)p_line->m_val.m_len, p_line->m_val.m_ptr);
+ *  return WYINI_OK;
+ * }
+ *
+ * wyini_stream_t *stream;
+ * if(wyini_stream_open(print_var, NULL, 4096, &stream) == WYINI_OK) {
+ *  wyini_stream_read(stream, stdin);
+ *  wyini_stream_close(stream);
+ * }
+ * @endcode
+ * @param p_callback Called for every line.
+ * @param p_user Passed to p_callback.
+ * @param p_max_line The longest line allowed, excluding its nextline indicator. Two buffers of about this size are allocated.
+ * @param p_stream Returns the stream. This is set to NULL if the function fails. Release it with wyini_stream_close().
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_stream_open(const wyini_stream_callback p_callback, void *p_user, const unsigned int p_max_line, wyini_stream_t *restrict *restrict p_stream);
+
+/**
+ * Feeds the next chunk of content to a stream. A chunk may end anywhere, even inside a line or between the '\r' and '\n' of a nextline indicator. The incomplete line at the end is kept by the stream and passed once a later chunk or wyini_stream_finish() completes it.
+ * @param p_stream The stream returned by wyini_stream_open().
+ * @param p_chunk The chunk. It is not needed after the call returns.
+ * @param p_len Length of the chunk.
+ * @return WYINI_OK if success. WYINI_MEMORY_ERR if a line is longer than p_max_line. Else the value returned by the callback that stopped the stream. Once the stream has stopped, every later call returns the same value.
+ */
+int wyini_stream_feed(wyini_stream_t *restrict p_stream, const char *restrict const p_chunk, const size_t p_len);
+
+/**
+ * Ends the content fed to a stream, passing the last line if it has no nextline indicator. Call it once after the last chunk.
+ * @param p_stream The stream returned by wyini_stream_open().
+ * @return WYINI_OK if success. Else the value that stopped the stream, as in wyini_stream_feed().
+ */
+int wyini_stream_finish(wyini_stream_t *restrict p_stream);
+
+/**
+ * Feeds everything that can be read from an open file to a stream, then calls wyini_stream_finish(). Unlike wyini_open() the file is only read sequentially, so it may be a pipe or stdin.
+ * @param p_stream The stream returned by wyini_stream_open().
+ * @param p_file The file to read, e.g. stdin.
+ * @return WYINI_OK if success. WYINI_IO_ERR if reading the file failed. Else the value that stopped the stream, as in wyini_stream_feed().
+ */
+int wyini_stream_read(wyini_stream_t *restrict p_stream, FILE *restrict p_file);
+
+/**
+ * Frees a stream. Lines not yet completed are dropped, so call wyini_stream_finish() first to get them.
+ * @param p_stream The stream returned by wyini_stream_open(). May be NULL.
+ */
+void wyini_stream_close(wyini_stream_t *restrict p_stream);
+
+/**
+ * Opens several files as the layers of one configuration, where each file overrides the ones before it. A merged index of all layers is built once, so a lookup costs the same as a lookup in a single file, however many layers there are. E.g. <br>
+ * @code
+ * const char *files[] = { "base.ini", "prod.ini", "host.ini" };
+ * wyini_layers_t *layers;
+ * wyini_view view;
+ * unsigned int layer;
+ * size_t line_no;
+ *
+ * if(wyini_layers_open(files, 3, MAXSIZE, &layers) == WYINI_OK) {
+ *  if(wyini_layers_get_var_view_s(layers, "db", "port", &view) == WYINI_OK) {
+ *      wyini_layers_get_origin_s(layers, "db", "port", &layer, &line_no);
+ *      printf("port=%.*s from %s:%zu\n", (int)view.m_len, view.m_ptr, wyini_layers_file(layers, layer), line_no);
+ *  }
+ *  wyini_layers_close(layers);
+ * }
+ * @endcode
+ * A variable is taken from the last layer that assigns to it, and within that layer from the first line, as wyini_get_var_view() would. A line with no value also overrides the layers before it. Layers are read with wyini_open_h() and are never written.
+ * @param p_files Paths of the files, from the base to the last override. Every file must exist.
+ * @param p_count Number of files in p_files. Must be at least 1.
+ * @param p_max_size Max file size allowed for each file.
+ * @param p_layers Returns the layered configuration. This is set to NULL if the function fails. Release it with wyini_layers_close().
+ * @return WYINI_OK if success. WYINI_NOT_FOUND if p_count is 0. Else a negative value defined in WY_IniDefs.h, e.g. WYINI_IO_ERR if a file cannot be read.
+ */
+int wyini_layers_open(const char *const *restrict p_files, const unsigned int p_count, const unsigned int p_max_size, wyini_layers_t *restrict *restrict p_layers);
+
+/**
+ * Reads the file of one layer again, e.g. after it changed on disk. Only the variables of the old and new content of the layer are updated in the merged index, so the cost depends on the size of the layer, not of the whole configuration. Views returned from the layer before are no longer valid. Must not be called while other threads read the configuration.
+ * @param p_layers The layered configuration returned by wyini_layers_open().
+ * @param p_layer Index of the layer in the p_files passed to wyini_layers_open().
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h, in which case the previous content of the layer is kept.
+ */
+int wyini_layers_reload(wyini_layers_t *restrict p_layers, const unsigned int p_layer);
+
+/**
+ * Gets a view of the value of a variable in a layered configuration, without copying it. Works like wyini_get_var_view() on the merged layers. Like wyini_get_var_view_h() this does not modify the configuration, so several threads may call it at once.
+ * @param p_layers The layered configuration returned by wyini_layers_open().
+ * @param p_var The variable name to search for.
+ * @param p_view Returns the view of the value assigned to p_var. It stays valid until the layer holding it is reloaded or the configuration is closed. Left unchanged if the function fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_layers_get_var_view(const wyini_layers_t *restrict p_layers, const char *restrict const p_var, wyini_view *restrict p_view);
+
+/**
+ * Gets a view of the value of a variable within a section of a layered configuration. Works like wyini_get_var_view_s() on the merged layers, so a layer only overrides the variables of a section that it assigns in a section with the same name.
+ * @param p_layers The layered configuration returned by wyini_layers_open().
+ * @param p_section The section name without the '[' and ']' and without surrounding whitespace. NULL searches regardless of sections, like wyini_layers_get_var_view().
+ * @param p_var The variable name to search for.
+ * @param p_view Returns the view of the value assigned to p_var. Left unchanged if the function fails.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_layers_get_var_view_s(const wyini_layers_t *restrict p_layers, const char *restrict const p_section, const char *restrict const p_var, wyini_view *restrict p_view);
+
+/**
+ * Gets where the value of a variable in a layered configuration comes from, i.e. the layer and line that wyini_layers_get_var_view() takes it from. Line numbers are counted when a layer is read, so this costs one lookup.
+ * @param p_layers The layered configuration returned by wyini_layers_open().
+ * @param p_var The variable name to search for.
+ * @param p_layer Returns the index of the layer. Pass it to wyini_layers_file() for the path.
+ * @param p_line_no Returns the number of the line in the file of the layer, starting from 1.
+ * @return WYINI_OK if success. WYINI_NOT_FOUND if no layer assigns to the variable, or if its name cannot be resolved through the index, e.g. a name containing '='.
+ */
+int wyini_layers_get_origin(const wyini_layers_t *restrict p_layers, const char *restrict const p_var, unsigned int *restrict p_layer, size_t *restrict p_line_no);
+
+/**
+ * Gets where the value of a variable within a section of a layered configuration comes from. Works like wyini_layers_get_origin() for the lookup done by wyini_layers_get_var_view_s().
+ * @param p_layers The layered configuration returned by wyini_layers_open().
+ * @param p_section The section name without the '[' and ']' and without surrounding whitespace. NULL searches regardless of sections.
+ * @param p_var The variable name to search for.
+ * @param p_layer Returns the index of the layer.
+ * @param p_line_no Returns the number of the line in the file of the layer, starting from 1.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_layers_get_origin_s(const wyini_layers_t *restrict p_layers, const char *restrict const p_section, const char *restrict const p_var, unsigned int *restrict p_layer, size_t *restrict p_line_no);
+
+/**
+ * Gets the path of the file of a layer.
+ * @param p_layers The layered configuration returned by wyini_layers_open().
+ * @param p_layer Index of the layer.
+ * @return The path as passed to wyini_layers_open(). NULL if there is no such layer.
+ */
+const char * wyini_layers_file(const wyini_layers_t *restrict p_layers, const unsigned int p_layer);
+
+/**
+ * Frees a layered configuration and all its layers.
+ * @param p_layers The layered configuration returned by wyini_layers_open(). May be NULL.
+ */
+void wyini_layers_close(wyini_layers_t *restrict p_layers);
+
+/**
+ * Parses a file once and publishes it in POSIX shared memory, where any number of processes on the host can attach to it with wyini_shm_attach() instead of each reading and parsing the file. E.g. <br>
+ * @code
+ * // The loader process, again whenever the file changes.
+ * wyini_shm_publish("/app_config", "app.ini", MAXSIZE);
+ *
+ * // Every worker process.
+ * wyini_shm_t *shm;
+ * wyini_view view;
+ *
+ * if(wyini_shm_attach("/app_config", MAXSIZE, &shm) == WYINI_OK) {
+ *  for(;;) { // Each request sees one generation.
+ *      wyini_shm_refresh(shm);
+ *      if(wyini_shm_get_var_view_s(shm, "db", "port", &view) == WYINI_OK)
+ *          printf("port=%.*s\n", (int)view.m_len, view.m_ptr);
+ *      // ... serve the request ...
+ *  }
+ *  wyini_shm_detach(shm);
+ * }
+ * @endcode
+ * The content and its index are written as a compiled image, like wyini_compile() does, into a new shared memory object for every publish. It is laid out with offsets only, so it works wherever it is mapped. A generation counter in the control object p_name, updated under a seqlock, tells readers which image is current. The previous image is unlinked, but stays valid for readers that still have it mapped. Only one process may publish to a name at a time. Only supported on systems with POSIX shared memory. Link with -lrt where shm_open() needs it, e.g. glibc before 2.34.
+ * @param p_name Name of the control object, e.g. "/app_config". Follows the rules of shm_open(). The images are named after it followed by '.' and their generation.
+ * @param p_file The file to publish.
+ * @param p_max_size Max file size allowed.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h, in which case the previous generation stays current. WYINI_IO_ERR if shared memory cannot be used, including on systems without it.
+ */
+int wyini_shm_publish(const char *restrict const p_name, const char *restrict const p_file, const unsigned int p_max_size);
+
+/**
+ * Removes a configuration published with wyini_shm_publish() from shared memory. Attached readers keep the image they have until they detach.
+ * @param p_name Name of the control object.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_shm_unlink(const char *restrict const p_name);
+
+/**
+ * Attaches to a configuration published with wyini_shm_publish(). The current image is mapped read-only and used in place, so nothing is parsed or copied. Each thread that reads the configuration needs its own attachment, which costs one mapping of pages shared with every other reader.
+ * @param p_name Name of the control object.
+ * @param p_max_size Max size allowed for the images.
+ * @param p_shm Returns the attachment. This is set to NULL if the function fails. Release it with wyini_shm_detach().
+ * @return WYINI_OK if success. WYINI_NOT_FOUND if nothing has been published under the name yet. Else a negative value defined in WY_IniDefs.h, e.g. WYINI_IO_ERR if the image is not valid for this machine.
+ */
+int wyini_shm_attach(const char *restrict const p_name, const unsigned int p_max_size, wyini_shm_t *restrict *restrict p_shm);
+
+/**
+ * Detaches from a configuration and unmaps its image.
+ * @param p_shm The attachment returned by wyini_shm_attach(). May be NULL.
+ */
+void wyini_shm_detach(wyini_shm_t *restrict p_shm);
+
+/**
+ * Moves an attachment to the latest published image. This is the only function that switches images: lookups keep using the image the attachment has, so the values they return all come from one generation and their views stay valid. Call it where the reader can drop its views, e.g. once per request or loop iteration. Never waits: checking for a new generation is one atomic load, and while a publish is in progress the image already attached is kept.
+ * @param p_shm The attachment returned by wyini_shm_attach().
+ * @return WYINI_OK if the attachment uses the latest image, or keeps its image while a publish is in progress. Else a negative value defined in WY_IniDefs.h, in which case the attachment keeps the image it has.
+ */
+int wyini_shm_refresh(wyini_shm_t *restrict p_shm);
+
+/**
+ * Gets a compiled handle on the image used by an attachment. The handle and views into it stay valid until the next wyini_shm_refresh() or wyini_shm_detach() on the attachment. Only pass the handle to functions that take a const handle, e.g. wyini_get_var_view_h().
+ * @param p_shm The attachment returned by wyini_shm_attach().
+ * @return The handle. Never NULL for an attachment returned by wyini_shm_attach().
+ */
+const wyini_handle_t * wyini_shm_handle(const wyini_shm_t *restrict p_shm);
+
+/**
+ * Gets the generation of the image used by an attachment, e.g. to detect that the values should be read again.
+ * @param p_shm The attachment returned by wyini_shm_attach().
+ * @return The generation, counting publishes under the name from 1.
+ */
+unsigned long long wyini_shm_generation(const wyini_shm_t *restrict p_shm);
+
+/**
+ * Gets a view of the value of a variable in the image used by an attachment. Works like wyini_get_var_view_s() on the handle returned by wyini_shm_handle(). Images are only switched by wyini_shm_refresh(), so all lookups between two refreshes see the same generation.
+ * @param p_shm The attachment returned by wyini_shm_attach().
+ * @param p_section The section to search, without the '[' and ']'. NULL searches the whole file regardless of sections.
+ * @param p_var The variable name to search for.
+ * @param p_view Returns the view of the value, valid until the next wyini_shm_refresh() or wyini_shm_detach() on the attachment.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_shm_get_var_view_s(const wyini_shm_t *restrict p_shm, const char *restrict const p_section, const char *restrict const p_var, wyini_view *restrict p_view);
+
+/**
+ * Gets a view of the value of a variable in the image used by an attachment, regardless of sections. Works like wyini_shm_get_var_view_s().
+ * @param p_shm The attachment returned by wyini_shm_attach().
+ * @param p_var The variable name to search for.
+ * @param p_view Returns the view of the value, valid until the next wyini_shm_refresh() or wyini_shm_detach() on the attachment.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
+ */
+int wyini_shm_get_var_view(const wyini_shm_t *restrict p_shm, const char *restrict const p_var, wyini_view *restrict p_view);
+
+/**
+ * Creates an arena to allocate the buffers of a handle from, e.g. with wyini_open_with(). The arena keeps its own bookkeeping at the start of its first block.
+ * @param p_region Memory for the arena, e.g. a static array. The arena never allocates more than this, and fails allocations with WYINI_MEMORY_ERR once it is full. NULL allocates a first block of p_size bytes with malloc() instead, and lets the arena grow by adding blocks as needed.
+ * @param p_size Size of p_region, or of the first block if p_region is NULL.
+ * @param p_arena Returns the arena. This is set to NULL if the function fails. Release it with wyini_arena_destroy().
+ * @return WYINI_OK if success. WYINI_MEMORY_ERR if p_size is too small to hold the arena, or memory allocation failed.
+ */
+int wyini_arena_create(void *p_region, const size_t p_size, wyini_arena_t *restrict *restrict p_arena);
+
+/**
+ * Fills in an allocator that allocates from an arena.
+ * @param p_arena The arena returned by wyini_arena_create().
+ * @param p_allocator Returns the allocator. Its m_release resets the arena.
+ */
+void wyini_arena_allocator(wyini_arena_t *restrict p_arena, wyini_allocator *restrict p_allocator);
+
+/**
+ * Releases everything allocated from an arena at once. Blocks added as the arena grew are kept for reuse. Called through m_release whenever a handle using the arena is cleaned, so this is rarely needed directly.
+ * @param p_arena The arena returned by wyini_arena_create().
+ */
+void wyini_arena_reset(wyini_arena_t *restrict p_arena);
+
+/**
+ * Gets the number of bytes used in an arena, including its own bookkeeping, e.g. to size a region for wyini_arena_create() after a test load.
+ * @param p_arena The arena returned by wyini_arena_create().
+ * @return Bytes used since the arena was last reset.
+ */
+size_t wyini_arena_used(const wyini_arena_t *restrict p_arena);
+
+/**
+ * Frees an arena and every block it allocated. A region passed to wyini_arena_create() is not freed. Handles using the arena must be cleaned or closed first.
+ * @param p_arena The arena returned by wyini_arena_create(). May be NULL.
+ */
+void wyini_arena_destroy(wyini_arena_t *restrict p_arena);
+
+/**
+ * Gets the counters and phase timings kept by the library. They are only kept when the library is compiled with WYINI_STATS defined, e.g. by adding -DWYINI_STATS to the compiler flags. Otherwise every call site compiles to nothing and this function returns WYINI_NOT_FOUND. The counters are shared by all handles and threads, and are updated with relaxed atomic operations, so a copy taken while other threads are busy may be slightly out of step between members.
+ * @param p_stats Returns the counters. All zero if the stats are not compiled in.
+ * @return WYINI_OK if success. WYINI_NOT_FOUND if the library was compiled without WYINI_STATS.
+ */
+int wyini_get_stats(wyini_stats *restrict p_stats);
+
+/**
+ * Sets all the counters returned by wyini_get_stats() to zero, e.g. before the part of a program being profiled. Does nothing if the library was compiled without WYINI_STATS.
+ */
+void wyini_reset_stats();
+
+/**
+ * Registers functions to be called at the beginning and end of every WYINI_PHASE_* phase on any thread, e.g. to open and close spans in a tracer. The time spent in the hooks is not counted in m_phase_ns. Register the hooks before other threads use the library, since they are read without synchronisation.
+ * @param p_begin Called when a phase begins. May be NULL.
+ * @param p_end Called when a phase ends. May be NULL.
+ * @param p_user Passed to both hooks.
+ * @return WYINI_OK if success. WYINI_NOT_FOUND if the library was compiled without WYINI_STATS, in which case the hooks are never called.
+ */
+int wyini_set_trace_hooks(const wyini_trace_hook p_begin, const wyini_trace_hook p_end, void *p_user);
+
 
 #endif
\ No newline at end of file
@@ -5,24 +5,128 @@
 #include <string.h>
 #include "WY_IniParseAgent.h"
 
+#if !defined WYINI_NO_SIMD
+#if (defined __GNUC__) && ((defined __x86_64__) || (defined __i386__))
+#include <immintrin.h>
+#define WYINI_SIMD_AVX2 /**< AVX2 is compiled in and selected at runtime if the CPU supports it. */
+#define WYINI_SIMD_SSE2 /**< SSE2 is compiled in and selected at runtime if the CPU supports it. */
+#elif (defined _MSC_VER) && (defined _M_X64)
+#include <intrin.h>
+#define WYINI_SIMD_SSE2 /**< SSE2 is always available on x64. */
+#endif
+#endif
 
-unsigned int wyini_get_nextline(const unsigned int p_start_offset, unsigned int *restrict p_end_offset, struct S_wyini_buffer *restrict p_wyini_buffer)
+
+/**
+ * Scalar version of wyini_find_delim(). Also finishes off the bytes left over by the vectorised versions.
+ */
+static unsigned int wyini_find_delim_scalar(unsigned int p_offset, const unsigned int p_max_len, const char p_extra, const char *restrict const p_buffer)
+{
+    for(; p_offset < p_max_len; ++p_offset) {
+        if((p_buffer[p_offset]=='\n') || (p_buffer[p_offset]=='\0') || (p_buffer[p_offset]==p_extra))
+            break;
+    }
+    return p_offset;
+}
+
+
+#if defined WYINI_SIMD_SSE2
+/**
+ * Returns the index of the lowest bit set in a non-zero mask.
+ */
+static unsigned int wyini_lowest_bit(const unsigned int p_mask)
+{
+#if defined _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, p_mask);
+    return (unsigned int)index;
+#else
+    return (unsigned int)__builtin_ctz(p_mask);
+#endif
+}
+
+
+/**
+ * SSE2 version of wyini_find_delim(). Compares 16 bytes at a time.
+ */
+#if defined __GNUC__
+__attribute__((target("sse2")))
+#endif
+static unsigned int wyini_find_delim_sse2(unsigned int p_offset, const unsigned int p_max_len, const char p_extra, const char *restrict const p_buffer)
+{
+    const __m128i nextline = _mm_set1_epi8('\n');
+    const __m128i extra = _mm_set1_epi8(p_extra);
+    const __m128i zero = _mm_setzero_si128();
+    unsigned int mask;
+
+    for(; p_max_len - p_offset >= 16; p_offset += 16) { /* Never reads past p_max_len, which may be the end of a mapping. */
+        const __m128i block = _mm_loadu_si128((const __m128i*)(p_buffer + p_offset));
+        const __m128i found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, nextline), _mm_cmpeq_epi8(block, zero)), _mm_cmpeq_epi8(block, extra));
+        if((mask = (unsigned int)_mm_movemask_epi8(found)) != 0)
+            return p_offset + wyini_lowest_bit(mask);
+    }
+    return wyini_find_delim_scalar(p_offset, p_max_len, p_extra, p_buffer);
+}
+#endif
+
+
+#if defined WYINI_SIMD_AVX2
+/**
+ * AVX2 version of wyini_find_delim(). Compares 32 bytes at a time.
+ */
+__attribute__((target("avx2")))
+static unsigned int wyini_find_delim_avx2(unsigned int p_offset, const unsigned int p_max_len, const char p_extra, const char *restrict const p_buffer)
+{
+    const __m256i nextline = _mm256_set1_epi8('\n');
+    const __m256i extra = _mm256_set1_epi8(p_extra);
+    const __m256i zero = _mm256_setzero_si256();
+    unsigned int mask;
+
+    for(; p_max_len - p_offset >= 32; p_offset += 32) { /* Never reads past p_max_len, which may be the end of a mapping. */
+        const __m256i block = _mm256_loadu_si256((const __m256i*)(p_buffer + p_offset));
+        const __m256i found = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, nextline), _mm256_cmpeq_epi8(block, zero)), _mm256_cmpeq_epi8(block, extra));
+        if((mask = (unsigned int)_mm256_movemask_epi8(found)) != 0)
+            return p_offset + wyini_lowest_bit(mask);
+    }
+    return wyini_find_delim_sse2(p_offset, p_max_len, p_extra, p_buffer);
+}
+#endif
+
+
+
+unsigned int wyini_find_delim(const unsigned int p_start_offset, const bool p_equal_sign, const struct S_wyini_buffer *restrict p_wyini_buffer)
 {
     const unsigned int max_len = p_wyini_buffer->m_buffer_len;
-    char *restrict buffer = p_wyini_buffer->m_buffer;
-    unsigned int end_offset = p_start_offset;
+    const char extra = p_equal_sign ? '=' : '\n'; /* Looking for '\n' twice costs nothing extra and keeps a single code path. */
+
+    if(p_start_offset >= max_len)
+        return max_len;
+#if defined WYINI_SIMD_AVX2
+    if(__builtin_cpu_supports("avx2"))
+        return wyini_find_delim_avx2(p_start_offset, max_len, extra, p_wyini_buffer->m_buffer);
+    if(__builtin_cpu_supports("sse2"))
+        return wyini_find_delim_sse2(p_start_offset, max_len, extra, p_wyini_buffer->m_buffer);
+#elif defined WYINI_SIMD_SSE2
+    return wyini_find_delim_sse2(p_start_offset, max_len, extra, p_wyini_buffer->m_buffer);
+#endif
+    return wyini_find_delim_scalar(p_start_offset, max_len, extra, p_wyini_buffer->m_buffer);
+}
+
+
+
+unsigned int wyini_get_nextline(const unsigned int p_start_offset, unsigned int *restrict p_end_offset, const struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    const char *restrict buffer = p_wyini_buffer->m_buffer;
+    unsigned int end_offset = wyini_find_delim(p_start_offset, false, p_wyini_buffer);
     unsigned int nextline_len = 0;
 
-    do {
-        if((buffer[end_offset]=='\n') || (buffer[end_offset]=='\0')) { /* Found '\n' or a terminating char. */ 
-            if(buffer[end_offset-1]=='\r') {/* If Windows style formatting, need to exclude the '\r' as well. */
-                --end_offset;
-                nextline_len = 2; /* Found nextline is '\r\n' */
-            } else
-                nextline_len = 1; /* Found nextline is '\n' */
-            break;
-        }
-    } while ((end_offset += 1) < max_len);
+    if(end_offset < p_wyini_buffer->m_buffer_len) { /* Found '\n' or a terminating char. */ 
+        if((end_offset > 0) && (buffer[end_offset-1]=='\r')) {/* If Windows style formatting, need to exclude the '\r' as well. There is no byte before offset 0 to check. */
+            --end_offset;
+            nextline_len = 2; /* Found nextline is '\r\n' */
+        } else
+            nextline_len = 1; /* Found nextline is '\n' */
+    }
 
     *p_end_offset = --end_offset; /* Retrace to pinpoint the offset index before nextline indicator or end of buffer. */
     return nextline_len;
@@ -30,12 +134,35 @@ unsigned int wyini_get_nextline(const unsigned int p_start_offset, unsigned int
 
 
 
-int wyini_find_var_val_inline(const bool p_var_only, const unsigned int p_start_offset, const unsigned int p_end_offset, const unsigned int p_var_len, const char *restrict const p_var, unsigned int *restrict p_return_offset, struct S_wyini_buffer *restrict p_wyini_buffer)
+bool wyini_is_header(const unsigned int p_start_offset, const unsigned int p_end_offset, unsigned int *restrict p_name_offset, unsigned int *restrict p_name_len, const char *restrict const p_buffer)
+{
+    unsigned int line_end = p_end_offset + 1; /* Wraps to p_start_offset for an empty line at the start of the buffer. */
+    if((line_end == p_start_offset) || (p_buffer[p_start_offset] != '['))
+        return false;
+    while((line_end > p_start_offset + 1) && (p_buffer[line_end-1] == ' ')) /* Skip whitespace after the ']'. */
+        --line_end;
+    if((line_end < p_start_offset + 2) || (p_buffer[line_end-1] != ']'))
+        return false;
+
+    unsigned int name_offset = p_start_offset + 1;
+    unsigned int name_end = line_end - 1;
+    while((name_offset < name_end) && (p_buffer[name_offset] == ' '))
+        ++name_offset;
+    while((name_end > name_offset) && (p_buffer[name_end-1] == ' '))
+        --name_end;
+    *p_name_offset = name_offset;
+    *p_name_len = name_end - name_offset;
+    return true;
+}
+
+
+
+int wyini_find_var_val_inline(const bool p_var_only, const unsigned int p_start_offset, const unsigned int p_end_offset, const unsigned int p_var_len, const char *restrict const p_var, unsigned int *restrict p_return_offset, const struct S_wyini_buffer *restrict p_wyini_buffer)
 {
-    char *restrict buffer = p_wyini_buffer->m_buffer;
+    const char *restrict buffer = p_wyini_buffer->m_buffer;
     int return_val = WYINI_NOT_FOUND;
 
-    if(strncmp(buffer + p_start_offset, p_var, p_var_len) != 0) /* Cannot match the var so exit. */
+    if((p_end_offset + 1 - p_start_offset <= p_var_len) || (strncmp(buffer + p_start_offset, p_var, p_var_len) != 0)) /* No room for the 'var=' pattern in the line, or cannot match the var so exit. This also keeps the compare within the buffer. */
         return WYINI_NOT_FOUND;
 
     unsigned int i = p_start_offset + p_var_len; /* Move index to right after the 'var' pattern found. */
@@ -10,6 +10,16 @@
 #include "WY_IniDefs.h"
 
 
+/**
+ * Finds the first '\n' or terminating '\0' at or after an offset in the internal buffer, and optionally also the first '='. On x86 the buffer is compared 32 or 16 bytes at a time with AVX2 or SSE2, selected at runtime according to what the CPU supports. Other systems, or builds with WYINI_NO_SIMD defined, compare 1 byte at a time. All versions return the same result.
+ * @param p_start_offset Position in S_wyini_buffer to start searching.
+ * @param p_equal_sign If true, '=' also ends the search.
+ * @param p_wyini_buffer The internal buffer to search.
+ * @return Offset of the first matching byte. m_buffer_len if there is none.
+ */
+unsigned int wyini_find_delim(const unsigned int p_start_offset, const bool p_equal_sign, const struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
 /**
  * Get the next line in the internal buffer. If the buffer ends without a next line this returns the index of the byte before the terminating char or simply the last char in the provided buffer. Currently this function looks for '\n' or '\r\n'.
  * .
@@ -18,7 +28,7 @@
  * @param p_wyini_buffer The internal buffer to search.
  * @return Size of the nextline character. Possible values are: 1 for '\n'. 2 for Windows-style '\r\n'. 0 if we hit the end of the provided S_wyini_buffer without any nextline or terminating indicator.
  */
-unsigned int wyini_get_nextline(const unsigned int p_start_offset, unsigned int *restrict p_end_offset, struct S_wyini_buffer *restrict p_wyini_buffer);
+unsigned int wyini_get_nextline(const unsigned int p_start_offset, unsigned int *restrict p_end_offset, const struct S_wyini_buffer *restrict p_wyini_buffer);
 
 
 /**
@@ -31,6 +41,18 @@ unsigned int wyini_get_nextline(const unsigned int p_start_offset, unsigned int
  * @param p_return_offset Returns the offset pointing to the start of the value as selected by the value in p_var_only.
  * \return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h. If WYINI_VAL_NOT_FOUND is returned, this means that although p_var_only is set to false, the variable is found, but the value is missing in the 'var=val' pattern.
  */
-int wyini_find_var_val_inline(const bool p_var_only, const unsigned int p_start_offset, const unsigned int p_end_offset, const unsigned int p_var_len, const char *restrict const p_var, unsigned int *restrict p_return_offset, struct S_wyini_buffer *restrict p_wyini_buffer);
+int wyini_find_var_val_inline(const bool p_var_only, const unsigned int p_start_offset, const unsigned int p_end_offset, const unsigned int p_var_len, const char *restrict const p_var, unsigned int *restrict p_return_offset, const struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Checks if a line is a section header of the form '[name]'. Whitespace after the ']' is allowed.
+ * @param p_start_offset Offset of the start of the line.
+ * @param p_end_offset Offset of the byte before the nextline or terminating indicator, as returned by wyini_get_nextline().
+ * @param p_name_offset Returns the offset of the name, excluding whitespace after the '['.
+ * @param p_name_len Returns the length of the name, excluding whitespace before the ']'.
+ * @param p_buffer The buffer holding the line.
+ * @return true if the line is a section header.
+ */
+bool wyini_is_header(const unsigned int p_start_offset, const unsigned int p_end_offset, unsigned int *restrict p_name_offset, unsigned int *restrict p_name_len, const char *restrict const p_buffer);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,436 @@
+/**
+ * @file WY_IniShmAgent.c
+*/
+#if !defined _OS_WINDOWS_
+#define _POSIX_C_SOURCE 200809L /* Exposes the POSIX shared memory functions under -std=c17. */
+#endif
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "WY_IniShmAgent.h"
+#include "WY_IniMgr.h"
+#if defined WYINI_HAVE_SHM
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "WY_IniCompileAgent.h"
+#include "WY_IniIndexAgent.h"
+#include "WY_IniWriteAgent.h"
+#include "WY_IniTypedAgent.h"
+#include "WY_IniAllocAgent.h"
+
+#define WYINI_SHM_SUFFIX_LEN 22 /**< Room for the '.', the generation in decimal and the terminating 0 after the name of an image object. */
+
+
+/**
+ * Builds the name of the image object of a generation.
+ * @param p_name Name of the control object.
+ * @param p_generation The generation.
+ * @param p_image_name Returns the name. Holds strlen(p_name) + WYINI_SHM_SUFFIX_LEN chars.
+ */
+static void wyini_shm_image_name(const char *restrict const p_name, const unsigned long long p_generation, char *restrict p_image_name)
+{
+    const size_t name_len = strlen(p_name);
+
+    memcpy(p_image_name, p_name, name_len);
+    snprintf(p_image_name + name_len, WYINI_SHM_SUFFIX_LEN, ".%llu", p_generation);
+}
+
+
+
+/**
+ * Maps the control object of a configuration for publishing, creating it if it does not exist yet.
+ * @param p_name Name of the control object.
+ * @param p_control Returns the control object, mapped read-write. Release it with munmap().
+ * @return WYINI_OK if success. WYINI_IO_ERR if the object cannot be created or mapped, or is not a control object of this version.
+ */
+static int wyini_shm_map_control(const char *restrict const p_name, struct S_wyini_shm_control *restrict *restrict p_control)
+{
+    struct stat shm_stat;
+    void *map;
+    int return_val = WYINI_IO_ERR;
+
+    const int fd = shm_open(p_name, O_RDWR|O_CREAT, 0644);
+    if(fd < 0)
+        return WYINI_IO_ERR;
+    if(fstat(fd, &shm_stat) != 0)
+        goto do_exit;
+    if((shm_stat.st_size == 0) && (ftruncate(fd, sizeof(struct S_wyini_shm_control)) != 0)) /* A new object is all zeros, i.e. nothing published yet. */
+        goto do_exit;
+    if((shm_stat.st_size != 0) && (shm_stat.st_size != sizeof(struct S_wyini_shm_control)))
+        goto do_exit;
+    if((map = mmap(NULL, sizeof(struct S_wyini_shm_control), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+        goto do_exit;
+
+    struct S_wyini_shm_control *restrict control = (struct S_wyini_shm_control*)map;
+    if(control->m_version == 0) { /* First publish. Readers ignore the object until m_magic is set. */
+        control->m_version = WYINI_SHM_VERSION;
+        control->m_byte_order = WYINI_COMPILED_BYTE_ORDER;
+        atomic_thread_fence(memory_order_release);
+        memcpy(control->m_magic, WYINI_SHM_MAGIC, sizeof(control->m_magic));
+    }
+    if((memcmp(control->m_magic, WYINI_SHM_MAGIC, sizeof(control->m_magic)) != 0) || (control->m_version != WYINI_SHM_VERSION) || (control->m_byte_order != WYINI_COMPILED_BYTE_ORDER)) {
+        munmap(map, sizeof(struct S_wyini_shm_control));
+        goto do_exit;
+    }
+    *p_control = control;
+    return_val = WYINI_OK;
+
+do_exit:
+    close(fd); /* The mapping stays valid after the descriptor is closed. */
+    return return_val;
+}
+
+
+
+/**
+ * Writes a compiled image into a new shared memory object. An object left behind with the same name, e.g. by a publisher that crashed, is replaced.
+ * @param p_image_name Name of the image object.
+ * @param p_segments The image, as returned by wyini_compiled_segments().
+ * @param p_count Number of segments.
+ * @param p_image_len Length of the image.
+ * @return WYINI_OK if success. WYINI_IO_ERR otherwise, in which case the object is removed.
+ */
+static int wyini_shm_write_image(const char *restrict const p_image_name, const struct S_wyini_segment *restrict p_segments, const unsigned int p_count, const unsigned int p_image_len)
+{
+    char *map;
+    size_t offset = 0;
+
+    shm_unlink(p_image_name);
+    const int fd = shm_open(p_image_name, O_RDWR|O_CREAT|O_EXCL, 0644);
+    if(fd < 0)
+        return WYINI_IO_ERR;
+    if((ftruncate(fd, p_image_len) != 0) || ((map = (char*)mmap(NULL, p_image_len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)) {
+        close(fd);
+        shm_unlink(p_image_name);
+        return WYINI_IO_ERR;
+    }
+    close(fd);
+
+    for(unsigned int i=0; i<p_count; ++i) { /* Copied once here, then shared by every reader. */
+        memcpy(map + offset, p_segments[i].m_ptr, p_segments[i].m_len);
+        offset += p_segments[i].m_len;
+    }
+    munmap(map, p_image_len);
+    return WYINI_OK;
+}
+
+
+
+/**
+ * Opens the image object of a generation into a new compiled handle.
+ * @param p_shm The attached configuration.
+ * @param p_generation The generation.
+ * @param p_image_len Length of the image, as read from the control object.
+ * @param p_handle Returns the handle. Release it with wyini_close_h().
+ * @return WYINI_OK if success. WYINI_NOT_FOUND if the object no longer exists, i.e. a newer generation was published meanwhile. Else another negative value defined in WY_IniDefs.h.
+ */
+static int wyini_shm_open_image(struct S_wyini_shm *restrict p_shm, const unsigned long long p_generation, const unsigned long long p_image_len, struct S_wyini_buffer *restrict *restrict p_handle)
+{
+    struct S_wyini_buffer *restrict handle;
+    struct stat shm_stat;
+    void *map;
+    int return_val;
+
+    if((p_image_len == 0) || (p_image_len > p_shm->m_max_size))
+        return WYINI_IO_ERR;
+    wyini_shm_image_name(p_shm->m_name, p_generation, p_shm->m_image_name);
+    const int fd = shm_open(p_shm->m_image_name, O_RDONLY, 0);
+    if(fd < 0)
+        return (errno == ENOENT) ? WYINI_NOT_FOUND : WYINI_IO_ERR;
+    if((fstat(fd, &shm_stat) != 0) || ((unsigned long long)shm_stat.st_size != p_image_len) || ((map = mmap(NULL, (size_t)p_image_len, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)) {
+        close(fd);
+        return WYINI_IO_ERR;
+    }
+    close(fd);
+
+    if((handle = (struct S_wyini_buffer*)malloc(sizeof(struct S_wyini_buffer))) == NULL) {
+        munmap(map, (size_t)p_image_len);
+        return WYINI_MEMORY_ERR;
+    }
+    memset(handle, 0, sizeof(*handle)); /* An empty handle, as wyini_open_compiled_h() starts from. No m_alloc, i.e. malloc(). */
+    handle->m_buffer_mode = WYINI_MODE_READ;
+    wyini_index_init(&(handle->m_index));
+    wyini_edit_init(handle);
+    wyini_typed_init(handle);
+    if((return_val = wyini_compiled_attach((char*)map, (unsigned int)p_image_len, (unsigned int)p_image_len, handle)) != WYINI_OK) {
+        munmap(map, (size_t)p_image_len);
+        free(handle);
+        return return_val;
+    }
+    handle->m_max_file_size = p_shm->m_max_size;
+    if((handle->m_val_buffer = (char*)wyini_mem_alloc(&(handle->m_allocator), WYINI_MAX_VAL_LEN)) == NULL) {
+        wyini_close_h(handle); /* Also unmaps the image. */
+        return WYINI_MEMORY_ERR;
+    }
+    *p_handle = handle;
+    return WYINI_OK;
+}
+
+
+
+/**
+ * Brings the handle of an attached configuration up to date with the control object. Never waits for a publisher: while one is updating the control object, a reader that already has an image keeps it.
+ * @param p_shm The attached configuration.
+ * @return WYINI_OK if m_handle is the latest image or is kept while a publish is in progress. WYINI_NOT_FOUND if nothing has been published yet. Else another negative value defined in WY_IniDefs.h, in which case m_handle is kept.
+ */
+static int wyini_shm_switch(struct S_wyini_shm *restrict p_shm)
+{
+    const struct S_wyini_shm_control *restrict control = p_shm->m_control;
+    struct S_wyini_buffer *handle = NULL;
+    int return_val = WYINI_NOT_FOUND;
+
+    for(unsigned int attempt=0; attempt<WYINI_SHM_RETRIES; ++attempt) {
+        const unsigned long long sequence = atomic_load_explicit(&(control->m_sequence), memory_order_acquire);
+        if(sequence & 1) { /* A publisher is updating the control object. */
+            if(p_shm->m_handle != NULL)
+                return WYINI_OK;
+            continue;
+        }
+        const unsigned long long generation = atomic_load_explicit(&(control->m_generation), memory_order_relaxed);
+        const unsigned long long image_len = atomic_load_explicit(&(control->m_image_len), memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if(atomic_load_explicit(&(control->m_sequence), memory_order_relaxed) != sequence) /* Torn read. Try again. */
+            continue;
+
+        if(generation == 0)
+            return WYINI_NOT_FOUND;
+        if(generation == p_shm->m_generation) {
+            p_shm->m_sequence = sequence;
+            return WYINI_OK;
+        }
+        if((return_val = wyini_shm_open_image(p_shm, generation, image_len, &handle)) == WYINI_NOT_FOUND) /* Already replaced by a newer generation. */
+            continue;
+        if(return_val != WYINI_OK)
+            return return_val;
+
+        wyini_close_h(p_shm->m_handle);
+        p_shm->m_handle = handle;
+        p_shm->m_generation = generation;
+        p_shm->m_sequence = sequence;
+        return WYINI_OK;
+    }
+    return (p_shm->m_handle != NULL) ? WYINI_OK : return_val;
+}
+#endif
+
+
+
+int wyini_shm_publish(const char *restrict const p_name, const char *restrict const p_file, const unsigned int p_max_size)
+{
+#if defined WYINI_HAVE_SHM
+    struct S_wyini_compiled_header header;
+    struct S_wyini_segment segments[WYINI_COMPILED_SEGMENTS];
+    struct S_wyini_shm_control *control = NULL;
+    wyini_handle_t *handle = NULL;
+    char *image_name = NULL;
+    unsigned int count = 0;
+    int return_val;
+
+    if((return_val = wyini_open_h(p_file, p_max_size, &handle)) != WYINI_OK)
+        return return_val;
+    if((return_val = wyini_compiled_segments(handle, &header, segments, &count)) != WYINI_OK)
+        goto do_exit;
+    if((image_name = (char*)malloc(strlen(p_name) + WYINI_SHM_SUFFIX_LEN)) == NULL) {
+        return_val = WYINI_MEMORY_ERR;
+        goto do_exit;
+    }
+    if((return_val = wyini_shm_map_control(p_name, &control)) != WYINI_OK)
+        goto do_exit;
+
+    const unsigned long long generation = atomic_load_explicit(&(control->m_generation), memory_order_relaxed) + 1; /* Only one publisher at a time, so this is not contended. */
+    wyini_shm_image_name(p_name, generation, image_name);
+    if((return_val = wyini_shm_write_image(image_name, segments, count, header.m_image_len)) != WYINI_OK)
+        goto do_exit;
+
+    const unsigned long long sequence = atomic_load_explicit(&(control->m_sequence), memory_order_relaxed);
+    atomic_store_explicit(&(control->m_sequence), sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release); /* Readers must see the odd sequence before any of the new values. */
+    atomic_store_explicit(&(control->m_generation), generation, memory_order_relaxed);
+    atomic_store_explicit(&(control->m_image_len), header.m_image_len, memory_order_relaxed);
+    atomic_store_explicit(&(control->m_sequence), sequence + 2, memory_order_release);
+
+    if(generation > 1) { /* Readers still using the old image keep their mapping. New readers cannot open it any more. */
+        wyini_shm_image_name(p_name, generation - 1, image_name);
+        shm_unlink(image_name);
+    }
+
+do_exit:
+    if(control != NULL)
+        munmap(control, sizeof(struct S_wyini_shm_control));
+    free(image_name);
+    wyini_close_h(handle);
+    return return_val;
+#else
+    (void)p_name;
+    (void)p_file;
+    (void)p_max_size;
+    return WYINI_IO_ERR;
+#endif
+}
+
+
+
+int wyini_shm_unlink(const char *restrict const p_name)
+{
+#if defined WYINI_HAVE_SHM
+    struct S_wyini_shm_control *control = NULL;
+    char *image_name;
+    int return_val;
+
+    if((image_name = (char*)malloc(strlen(p_name) + WYINI_SHM_SUFFIX_LEN)) == NULL)
+        return WYINI_MEMORY_ERR;
+    if((return_val = wyini_shm_map_control(p_name, &control)) == WYINI_OK) {
+        const unsigned long long generation = atomic_load_explicit(&(control->m_generation), memory_order_relaxed);
+        if(generation > 0) {
+            wyini_shm_image_name(p_name, generation, image_name);
+            shm_unlink(image_name);
+        }
+        munmap(control, sizeof(struct S_wyini_shm_control));
+    }
+    if(shm_unlink(p_name) != 0)
+        return_val = WYINI_IO_ERR;
+    free(image_name);
+    return return_val;
+#else
+    (void)p_name;
+    return WYINI_IO_ERR;
+#endif
+}
+
+
+
+int wyini_shm_attach(const char *restrict const p_name, const unsigned int p_max_size, wyini_shm_t *restrict *restrict p_shm)
+{
+#if defined WYINI_HAVE_SHM
+    struct S_wyini_shm *shm;
+    struct stat shm_stat;
+    void *map;
+    int return_val = WYINI_MEMORY_ERR;
+
+    *p_shm = NULL;
+    if((shm = (struct S_wyini_shm*)calloc(1, sizeof(struct S_wyini_shm))) == NULL)
+        return WYINI_MEMORY_ERR;
+    const size_t name_len = strlen(p_name);
+    if(((shm->m_name = (char*)malloc(name_len + 1)) == NULL) || ((shm->m_image_name = (char*)malloc(name_len + WYINI_SHM_SUFFIX_LEN)) == NULL))
+        goto bad_exit;
+    memcpy(shm->m_name, p_name, name_len + 1);
+    shm->m_max_size = p_max_size;
+
+    return_val = WYINI_IO_ERR;
+    const int fd = shm_open(p_name, O_RDONLY, 0);
+    if(fd < 0) {
+        return_val = (errno == ENOENT) ? WYINI_NOT_FOUND : WYINI_IO_ERR;
+        goto bad_exit;
+    }
+    if((fstat(fd, &shm_stat) != 0) || (shm_stat.st_size != sizeof(struct S_wyini_shm_control)) || ((map = mmap(NULL, sizeof(struct S_wyini_shm_control), PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)) {
+        close(fd);
+        goto bad_exit;
+    }
+    close(fd);
+    shm->m_control = (const struct S_wyini_shm_control*)map;
+
+    if(memcmp(shm->m_control->m_magic, WYINI_SHM_MAGIC, sizeof(shm->m_control->m_magic)) != 0) { /* Still being created by the first publisher, or not a control object. */
+        return_val = WYINI_NOT_FOUND;
+        goto bad_exit;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    if((shm->m_control->m_version != WYINI_SHM_VERSION) || (shm->m_control->m_byte_order != WYINI_COMPILED_BYTE_ORDER))
+        goto bad_exit;
+    if((return_val = wyini_shm_switch(shm)) != WYINI_OK)
+        goto bad_exit;
+
+    *p_shm = shm;
+    return WYINI_OK;
+
+bad_exit:
+    wyini_shm_detach(shm);
+    return return_val;
+#else
+    (void)p_name;
+    (void)p_max_size;
+    *p_shm = NULL;
+    return WYINI_IO_ERR;
+#endif
+}
+
+
+
+void wyini_shm_detach(wyini_shm_t *restrict p_shm)
+{
+#if defined WYINI_HAVE_SHM
+    if(p_shm == NULL)
+        return;
+    wyini_close_h(p_shm->m_handle);
+    if(p_shm->m_control != NULL)
+        munmap((void*)p_shm->m_control, sizeof(struct S_wyini_shm_control));
+    free(p_shm->m_name);
+    free(p_shm->m_image_name);
+    free(p_shm);
+#else
+    (void)p_shm;
+#endif
+}
+
+
+
+int wyini_shm_refresh(wyini_shm_t *restrict p_shm)
+{
+#if defined WYINI_HAVE_SHM
+    if(atomic_load_explicit(&(p_shm->m_control->m_sequence), memory_order_acquire) == p_shm->m_sequence) /* Nothing was published since the last check. */
+        return WYINI_OK;
+    return wyini_shm_switch(p_shm);
+#else
+    (void)p_shm;
+    return WYINI_IO_ERR;
+#endif
+}
+
+
+
+const wyini_handle_t * wyini_shm_handle(const wyini_shm_t *restrict p_shm)
+{
+#if defined WYINI_HAVE_SHM
+    return p_shm->m_handle;
+#else
+    (void)p_shm;
+    return NULL;
+#endif
+}
+
+
+
+unsigned long long wyini_shm_generation(const wyini_shm_t *restrict p_shm)
+{
+#if defined WYINI_HAVE_SHM
+    return p_shm->m_generation;
+#else
+    (void)p_shm;
+    return 0;
+#endif
+}
+
+
+
+int wyini_shm_get_var_view_s(const wyini_shm_t *restrict p_shm, const char *restrict const p_section, const char *restrict const p_var, wyini_view *restrict p_view)
+{
+#if defined WYINI_HAVE_SHM
+    return wyini_get_var_view_s_h(p_shm->m_handle, p_section, p_var, p_view); /* Never switches images, so views from earlier lookups stay valid. */
+#else
+    (void)p_shm;
+    (void)p_section;
+    (void)p_var;
+    (void)p_view;
+    return WYINI_IO_ERR;
+#endif
+}
+
+
+
+int wyini_shm_get_var_view(const wyini_shm_t *restrict p_shm, const char *restrict const p_var, wyini_view *restrict p_view)
+{
+    return wyini_shm_get_var_view_s(p_shm, NULL, p_var, p_view);
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+/**
+ * @file WY_IniShmAgent.h
+ * Declares the state of a shared-memory configuration for the wyini_shm_* API functions in WY_IniMgr.h.
+ * \n
+ * A publisher parses the file once and writes its compiled image, i.e. the content and the index laid out with offsets only, into a POSIX shared-memory object of its own named after the generation, e.g. "/name.3". A small control object, "/name", holds the current generation under a seqlock. Readers map the control object and the current image read-only and use the image in place through an ordinary compiled handle, so hundreds of processes share one copy of the parsed file.
+ * \n
+ * Each publish writes a new image object, then bumps the sequence to odd, stores the new generation and bumps it to even again, and finally unlinks the old image. Lookups never switch images, so views stay valid and a reader sees one generation at a time. Only wyini_shm_refresh() compares the sequence with the one the reader last saw, which is one atomic load. When it changed and is even, the reader reads the generation, checks that the sequence did not move meanwhile, maps the new image and closes the old one. Images are never written after they are published and stay valid while they are mapped, even once unlinked, so readers never see a torn image and never wait: while the sequence is odd they keep using the image they have.
+ * \n
+ * Shared memory and lock-free 64-bit atomics are needed. On other systems the wyini_shm_* functions fail with WYINI_IO_ERR.
+*/
+
+#ifndef _WY_INISHMAGENT_H_
+#define _WY_INISHMAGENT_H_
+
+#include "WY_IniDefs.h"
+
+#if !defined _OS_WINDOWS_
+#include <stdatomic.h>
+#if ATOMIC_LLONG_LOCK_FREE == 2
+#define WYINI_HAVE_SHM /**< POSIX shared memory and lock-free 64-bit atomics are available on this system. */
+#endif
+#endif
+
+#define WYINI_SHM_MAGIC "WYINISHM" /**< The first 8 bytes of every control object. */
+#define WYINI_SHM_VERSION 1 /**< Version of the control object layout. */
+#define WYINI_SHM_RETRIES 1000 /**< How often a reader without an image rereads the control object before giving up, e.g. while it is being updated. */
+
+#if defined WYINI_HAVE_SHM
+/**
+ * The control object of a shared-memory configuration. The images themselves are compiled images as described in WY_IniCompileAgent.h.
+ */
+struct S_wyini_shm_control
+{
+    char m_magic[8]; /**< WYINI_SHM_MAGIC, without the terminating 0. Written once by the first publisher. */
+    uint32_t m_version; /**< WYINI_SHM_VERSION. */
+    uint32_t m_byte_order; /**< WYINI_COMPILED_BYTE_ORDER. */
+    atomic_ullong m_sequence; /**< The seqlock. Odd while a publisher updates m_generation and m_image_len. */
+    atomic_ullong m_generation; /**< Generation of the current image, which is in the object named after the control object followed by '.' and the generation. 0 before the first publish. */
+    atomic_ullong m_image_len; /**< Length of the current image. */
+};
+
+/**
+ * A shared-memory configuration attached by wyini_shm_attach().
+ */
+struct S_wyini_shm
+{
+    const struct S_wyini_shm_control *m_control; /**< The control object, mapped read-only. */
+    char *m_name; /**< Name of the control object. */
+    char *m_image_name; /**< Room for the name of an image object. */
+    unsigned int m_max_size; /**< The size limit passed to wyini_shm_attach(). */
+    struct S_wyini_buffer *m_handle; /**< A compiled handle on the current image. */
+    unsigned long long m_sequence; /**< The sequence that was read when m_handle was checked to be current. */
+    unsigned long long m_generation; /**< Generation of m_handle. */
+};
+#endif
+
+#endif
@@ -0,0 +1,122 @@
+/**
+ * @file WY_IniStatsAgent.c
+*/
+
+#if !defined _OS_WINDOWS_
+#define _POSIX_C_SOURCE 200809L /* Exposes clock_gettime() under -std=c17. */
+#endif
+#include <string.h>
+#include <time.h>
+#include "WY_IniStatsAgent.h"
+#include "WY_IniMgr.h"
+
+#if defined WYINI_STATS
+#include <stdatomic.h>
+
+#define WYINI_STATS_COUNTERS (sizeof(struct S_wyini_stats)/sizeof(uint64_t)) /**< Number of counters in S_wyini_stats, which only has uint64_t members. */
+
+static _Atomic uint64_t m_wyini_stats[WYINI_STATS_COUNTERS]; /**< The counters, in the order of the members of S_wyini_stats. */
+static wyini_trace_hook m_wyini_trace_begin; /**< Called when a phase begins, or NULL. */
+static wyini_trace_hook m_wyini_trace_end; /**< Called when a phase ends, or NULL. */
+static void *m_wyini_trace_user; /**< Passed to the hooks. */
+
+
+/**
+ * Reads a monotonic clock.
+ * @return The time in nanoseconds from an arbitrary start.
+ */
+static uint64_t wyini_stats_now()
+{
+    struct timespec now;
+#if !defined _OS_WINDOWS_
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#else
+    timespec_get(&now, TIME_UTC);
+#endif
+    return (uint64_t)now.tv_sec*1000000000u + (uint64_t)now.tv_nsec;
+}
+
+
+
+void wyini_stats_add(const size_t p_counter, const uint64_t p_count)
+{
+    atomic_fetch_add_explicit(&(m_wyini_stats[p_counter]), p_count, memory_order_relaxed); /* Only the totals matter, so no ordering with other memory is needed. */
+}
+
+
+
+void wyini_stats_lookup(const int p_status)
+{
+    wyini_stats_add(WYINI_STATS_COUNTER(m_lookups), 1);
+    if(p_status == WYINI_OK)
+        wyini_stats_add(WYINI_STATS_COUNTER(m_hits), 1);
+    else
+        wyini_stats_add(WYINI_STATS_COUNTER(m_misses), 1);
+}
+
+
+
+uint64_t wyini_stats_begin(const int p_phase)
+{
+    if(m_wyini_trace_begin != NULL)
+        m_wyini_trace_begin(p_phase, m_wyini_trace_user);
+    return wyini_stats_now(); /* Read after the hook, so that its time is not counted. */
+}
+
+
+
+void wyini_stats_end(const int p_phase, const uint64_t p_start)
+{
+    const uint64_t elapsed = wyini_stats_now() - p_start;
+
+    wyini_stats_add(WYINI_STATS_COUNTER(m_phase_calls) + (size_t)p_phase, 1);
+    wyini_stats_add(WYINI_STATS_COUNTER(m_phase_ns) + (size_t)p_phase, elapsed);
+    if(m_wyini_trace_end != NULL)
+        m_wyini_trace_end(p_phase, m_wyini_trace_user);
+}
+
+#endif
+
+
+
+int wyini_get_stats(wyini_stats *restrict p_stats)
+{
+#if defined WYINI_STATS
+    uint64_t counters[WYINI_STATS_COUNTERS];
+
+    for(size_t i=0; i<WYINI_STATS_COUNTERS; ++i)
+        counters[i] = atomic_load_explicit(&(m_wyini_stats[i]), memory_order_relaxed);
+    memcpy(p_stats, counters, sizeof(counters));
+    return WYINI_OK;
+#else
+    memset(p_stats, 0, sizeof(*p_stats));
+    return WYINI_NOT_FOUND;
+#endif
+}
+
+
+
+void wyini_reset_stats()
+{
+#if defined WYINI_STATS
+    for(size_t i=0; i<WYINI_STATS_COUNTERS; ++i)
+        atomic_store_explicit(&(m_wyini_stats[i]), 0, memory_order_relaxed);
+#endif
+}
+
+
+
+int wyini_set_trace_hooks(const wyini_trace_hook p_begin, const wyini_trace_hook p_end, void *p_user)
+{
+#if defined WYINI_STATS
+    m_wyini_trace_begin = p_begin;
+    m_wyini_trace_end = p_end;
+    m_wyini_trace_user = p_user;
+    return WYINI_OK;
+#else
+    (void)p_begin;
+    (void)p_end;
+    (void)p_user;
+    return WYINI_NOT_FOUND;
+#endif
+}
@@ -0,0 +1,59 @@
+/**
+ * @file WY_IniStatsAgent.h
+ * Declares the macros through which the other agents update the counters returned by wyini_get_stats(), and the functions behind them.
+ * \n
+ * The macros only do anything when WYINI_STATS is defined. Otherwise they expand to ((void)0), so a build without stats has no counters, no clock reads and no hook calls, and the compiler sees the same code as before the macros were added. A phase is timed by a WYINI_STATS_BEGIN() and WYINI_STATS_END() pair in the same block, with no return in between.
+*/
+
+#ifndef _WY_INISTATSAGENT_H_
+#define _WY_INISTATSAGENT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "WY_IniDefs.h"
+
+#if defined WYINI_STATS
+
+#define WYINI_STATS_COUNTER(p_member) (offsetof(struct S_wyini_stats, p_member)/sizeof(uint64_t)) /**< Position of a member of S_wyini_stats among its counters. */
+#define WYINI_STATS_ADD(p_member, p_count) wyini_stats_add(WYINI_STATS_COUNTER(p_member), (uint64_t)(p_count)) /**< Adds to a member of S_wyini_stats, e.g. WYINI_STATS_ADD(m_opens, 1). */
+#define WYINI_STATS_LOOKUP(p_status) wyini_stats_lookup(p_status) /**< Counts a lookup and whether it hit, given the status it returns. */
+#define WYINI_STATS_BEGIN(p_phase) const uint64_t wyini_stats_start_##p_phase = wyini_stats_begin(p_phase) /**< Begins a WYINI_PHASE_* phase. Declares a variable, so it must be a statement of its own. */
+#define WYINI_STATS_END(p_phase) wyini_stats_end(p_phase, wyini_stats_start_##p_phase) /**< Ends the phase begun by WYINI_STATS_BEGIN() with the same phase in the same block. */
+
+/**
+ * Adds to one of the counters.
+ * @param p_counter Position of the counter, from WYINI_STATS_COUNTER().
+ * @param p_count The amount to add.
+ */
+void wyini_stats_add(const size_t p_counter, const uint64_t p_count);
+
+/**
+ * Counts a lookup in m_lookups, and in m_hits or m_misses.
+ * @param p_status The status returned by the lookup. WYINI_OK is a hit, and anything else a miss.
+ */
+void wyini_stats_lookup(const int p_status);
+
+/**
+ * Calls the begin hook of a phase and reads the clock.
+ * @param p_phase One of the WYINI_PHASE_* definitions.
+ * @return The time the phase began in nanoseconds, to pass to wyini_stats_end().
+ */
+uint64_t wyini_stats_begin(const int p_phase);
+
+/**
+ * Adds the time spent in a phase to its counters and calls the end hook.
+ * @param p_phase One of the WYINI_PHASE_* definitions.
+ * @param p_start The value returned by wyini_stats_begin().
+ */
+void wyini_stats_end(const int p_phase, const uint64_t p_start);
+
+#else
+
+#define WYINI_STATS_ADD(p_member, p_count) ((void)0)
+#define WYINI_STATS_LOOKUP(p_status) ((void)0)
+#define WYINI_STATS_BEGIN(p_phase) ((void)0)
+#define WYINI_STATS_END(p_phase) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,211 @@
+/**
+ * @file WY_IniStreamAgent.c
+*/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "WY_IniStreamAgent.h"
+#include "WY_IniParseAgent.h"
+#include "WY_IniWriteAgent.h"
+
+#define WYINI_STREAM_MAX_PIECE 0x40000000u /**< Chunks are split into pieces of at most this size, so that every offset and m_buffer_len fit in an unsigned int. */
+
+
+/**
+ * Passes the line starting at an offset to the callback of a stream, splitting it exactly like wyini_index_build() does.
+ * @param p_stream The stream.
+ * @param p_start_offset Offset of the start of the line. Must be less than m_buffer_len.
+ * @param p_final If true, a line that reaches the end of p_wyini_buffer without a nextline indicator is complete.
+ * @param p_next_offset Returns the offset of the line after it.
+ * @param p_wyini_buffer The chunk or m_carry holding the line. Only m_buffer and m_buffer_len are used.
+ * @return WYINI_OK if the line was passed. WYINI_NOT_FOUND if the line is not complete yet. WYINI_MEMORY_ERR if the line is longer than m_max_line. Else the value returned by the callback.
+ */
+static int wyini_stream_pass_line(struct S_wyini_stream *restrict p_stream, const unsigned int p_start_offset, const bool p_final, unsigned int *restrict p_next_offset, const struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    const char *restrict buffer = p_wyini_buffer->m_buffer;
+    const unsigned int max_len = p_wyini_buffer->m_buffer_len;
+    wyini_stream_line line;
+    unsigned int end_offset = 0;
+    unsigned int name_offset = 0;
+    unsigned int name_len = 0;
+
+    const unsigned int equal_sign = wyini_find_delim(p_start_offset, true, p_wyini_buffer); /* Stops at the first '=' or the end of the line, whichever comes first. */
+    const unsigned int nextline_len = wyini_get_nextline((equal_sign < max_len) ? equal_sign : p_start_offset, &end_offset, p_wyini_buffer);
+    if((nextline_len == 0) && !p_final) /* The rest of the line is in the next chunk. A '\r' at the very end is kept in the line here, but is then joined with its '\n' in m_carry. */
+        return WYINI_NOT_FOUND;
+
+    const unsigned int line_end = end_offset + 1; /* end_offset is p_start_offset - 1 for an empty line, which wraps to UINT_MAX at offset 0, so only use line_end. */
+    if(line_end - p_start_offset > p_stream->m_max_line)
+        return WYINI_MEMORY_ERR;
+
+    line.m_line.m_ptr = buffer + p_start_offset;
+    line.m_line.m_len = line_end - p_start_offset;
+    line.m_nextline.m_ptr = buffer + line_end;
+    line.m_nextline.m_len = nextline_len;
+    line.m_line_no = ++(p_stream->m_line_no);
+
+    line.m_header = wyini_is_header(p_start_offset, end_offset, &name_offset, &name_len, buffer);
+    if(line.m_header) { /* Copy the name, since the next chunk needs it after this one is gone. */
+        memcpy(p_stream->m_section, buffer + name_offset, name_len);
+        p_stream->m_section_len = name_len;
+    }
+    line.m_section.m_ptr = p_stream->m_section;
+    line.m_section.m_len = p_stream->m_section_len;
+
+    if((equal_sign < max_len) && (buffer[equal_sign] == '=')) {
+        unsigned int var_end = equal_sign;
+        unsigned int val_offset = equal_sign + 1;
+        while((var_end > p_start_offset) && (buffer[var_end-1] == ' ')) /* Exclude whitespace between the variable and '='. */
+            --var_end;
+        while((val_offset < line_end) && (buffer[val_offset] == ' ')) /* Skip any whitespace after the '=' pattern. */
+            ++val_offset;
+        line.m_var.m_ptr = buffer + p_start_offset;
+        line.m_var.m_len = var_end - p_start_offset;
+        line.m_val.m_ptr = buffer + val_offset;
+        line.m_val.m_len = wyini_remove_ending_whitespace(buffer + val_offset, line_end - val_offset);
+    } else {
+        line.m_var.m_ptr = NULL;
+        line.m_var.m_len = 0;
+        line.m_val.m_ptr = line.m_nextline.m_ptr;
+        line.m_val.m_len = 0;
+    }
+
+    *p_next_offset = line_end + nextline_len;
+    return p_stream->m_callback(&line, p_stream->m_user);
+}
+
+
+
+/**
+ * Feeds a chunk short enough for unsigned int offsets to a stream. The end of the line kept in m_carry is appended to it first, and the incomplete line at the end of the chunk replaces it.
+ * @param p_stream The stream.
+ * @param p_chunk The chunk.
+ * @param p_len Length of the chunk. At most WYINI_STREAM_MAX_PIECE.
+ * @return WYINI_OK if success. Else the value that stops the stream.
+ */
+static int wyini_stream_feed_piece(struct S_wyini_stream *restrict p_stream, const char *restrict const p_chunk, const unsigned int p_len)
+{
+    const struct S_wyini_buffer chunk = {.m_buffer = (char*)p_chunk, .m_buffer_len = p_len};
+    unsigned int offset = 0;
+    unsigned int next_offset = 0;
+    int return_val;
+
+    if(p_stream->m_carry_len > 0) { /* Complete the line carried over from the previous chunk. */
+        const unsigned int end = wyini_find_delim(0, false, &chunk);
+        const unsigned int copy_len = (end < p_len) ? end + 1 : p_len; /* Up to and including the nextline or terminating char. */
+        if(copy_len > p_stream->m_max_line + 2 - p_stream->m_carry_len) /* The line cannot fit, even with a '\r\n'. */
+            return WYINI_MEMORY_ERR;
+        memcpy(p_stream->m_carry + p_stream->m_carry_len, p_chunk, copy_len);
+        p_stream->m_carry_len += copy_len;
+        if(end >= p_len) /* The whole chunk is still part of the same line. */
+            return WYINI_OK;
+
+        const struct S_wyini_buffer carry = {.m_buffer = p_stream->m_carry, .m_buffer_len = p_stream->m_carry_len};
+        p_stream->m_carry_len = 0;
+        if((return_val = wyini_stream_pass_line(p_stream, 0, false, &next_offset, &carry)) != WYINI_OK)
+            return return_val;
+        offset = copy_len;
+    }
+
+    while(offset < p_len) {
+        return_val = wyini_stream_pass_line(p_stream, offset, false, &next_offset, &chunk);
+        if(return_val == WYINI_NOT_FOUND) { /* Keep the incomplete line at the end of the chunk. */
+            if(p_len - offset > p_stream->m_max_line + 1) /* Too long already, even if the last char is the '\r' of a '\r\n'. */
+                return WYINI_MEMORY_ERR;
+            memcpy(p_stream->m_carry, p_chunk + offset, p_len - offset);
+            p_stream->m_carry_len = p_len - offset;
+            break;
+        }
+        if(return_val != WYINI_OK)
+            return return_val;
+        offset = next_offset;
+    }
+    return WYINI_OK;
+}
+
+
+
+int wyini_stream_open(const wyini_stream_callback p_callback, void *p_user, const unsigned int p_max_line, wyini_stream_t *restrict *restrict p_stream)
+{
+    struct S_wyini_stream *stream;
+
+    *p_stream = NULL;
+    if((p_max_line == 0) || (p_max_line > WYINI_STREAM_MAX_PIECE))
+        return WYINI_MEMORY_ERR;
+    if((stream = (struct S_wyini_stream*)calloc(1, sizeof(struct S_wyini_stream))) == NULL)
+        return WYINI_MEMORY_ERR;
+    if((stream->m_carry = (char*)malloc(2*(size_t)p_max_line + 2)) == NULL) { /* m_carry followed by m_section. */
+        free(stream);
+        return WYINI_MEMORY_ERR;
+    }
+    stream->m_section = stream->m_carry + p_max_line + 2;
+    stream->m_callback = p_callback;
+    stream->m_user = p_user;
+    stream->m_max_line = p_max_line;
+    stream->m_status = WYINI_OK;
+
+    *p_stream = stream;
+    return WYINI_OK;
+}
+
+
+
+int wyini_stream_feed(wyini_stream_t *restrict p_stream, const char *restrict const p_chunk, const size_t p_len)
+{
+    size_t offset = 0;
+
+    while((p_stream->m_status == WYINI_OK) && (offset < p_len)) {
+        const unsigned int piece_len = (p_len - offset > WYINI_STREAM_MAX_PIECE) ? WYINI_STREAM_MAX_PIECE : (unsigned int)(p_len - offset);
+        p_stream->m_status = wyini_stream_feed_piece(p_stream, p_chunk + offset, piece_len);
+        offset += piece_len;
+    }
+    return p_stream->m_status;
+}
+
+
+
+int wyini_stream_finish(wyini_stream_t *restrict p_stream)
+{
+    unsigned int next_offset = 0;
+
+    if((p_stream->m_status == WYINI_OK) && (p_stream->m_carry_len > 0)) { /* The last line has no nextline indicator. */
+        const struct S_wyini_buffer carry = {.m_buffer = p_stream->m_carry, .m_buffer_len = p_stream->m_carry_len};
+        p_stream->m_carry_len = 0;
+        p_stream->m_status = wyini_stream_pass_line(p_stream, 0, true, &next_offset, &carry);
+    }
+    return p_stream->m_status;
+}
+
+
+
+int wyini_stream_read(wyini_stream_t *restrict p_stream, FILE *restrict p_file)
+{
+    char *chunk;
+    size_t len;
+
+    if((chunk = (char*)malloc(WYINI_STREAM_READ_SIZE)) == NULL)
+        return WYINI_MEMORY_ERR;
+    while((len = fread(chunk, 1, WYINI_STREAM_READ_SIZE, p_file)) > 0) {
+        if(wyini_stream_feed(p_stream, chunk, len) != WYINI_OK)
+            goto do_exit;
+    }
+    if(ferror(p_file))
+        p_stream->m_status = WYINI_IO_ERR;
+    else
+        wyini_stream_finish(p_stream);
+
+do_exit:
+    free(chunk);
+    return p_stream->m_status;
+}
+
+
+
+void wyini_stream_close(wyini_stream_t *restrict p_stream)
+{
+    if(p_stream == NULL)
+        return;
+    free(p_stream->m_carry);
+    free(p_stream);
+}
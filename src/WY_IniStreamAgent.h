@@ -0,0 +1,33 @@
+/**
+ * @file WY_IniStreamAgent.h
+ * Declares the state of a streaming parse for the wyini_stream_* API functions in WY_IniMgr.h.
+ * \n
+ * Each chunk fed to the stream is split into lines with the same functions from WY_IniParseAgent.h that wyini_open() uses, so a stream sees exactly the lines, sections and 'var=val' patterns the index would. Lines that lie wholly inside a chunk are passed to the callback where they are, without copying. Only the incomplete line at the end of a chunk is copied into m_carry and completed with the start of the next chunk, which also joins a '\r' and '\n' split between two chunks. Since m_carry and m_section are allocated once with room for the longest allowed line, the memory used does not depend on the size of the input.
+*/
+
+#ifndef _WY_INISTREAMAGENT_H_
+#define _WY_INISTREAMAGENT_H_
+
+#include <stddef.h>
+#include "WY_IniDefs.h"
+#include "WY_IniMgr.h"
+
+#define WYINI_STREAM_READ_SIZE 65536 /**< Size of the chunks read by wyini_stream_read(). */
+
+/**
+ * A streaming parse started by wyini_stream_open().
+ */
+struct S_wyini_stream
+{
+    wyini_stream_callback m_callback; /**< Called for every line. */
+    void *m_user; /**< Passed to m_callback. */
+    char *m_carry; /**< The start of a line not yet ended by the chunks fed so far, followed by its nextline indicator once it is complete. Holds m_max_line + 2 chars. */
+    unsigned int m_carry_len; /**< Length of the content of m_carry. */
+    char *m_section; /**< Copy of the name of the current section, since the chunk holding its header may be gone. Holds m_max_line chars. */
+    unsigned int m_section_len; /**< Length of the name of the current section. 0 before the first header. */
+    unsigned int m_max_line; /**< The longest line allowed, excluding its nextline indicator. */
+    size_t m_line_no; /**< Number of lines passed to m_callback so far. */
+    int m_status; /**< WYINI_OK, or the first error or non-zero callback value, which every later call returns. */
+};
+
+#endif
@@ -0,0 +1,421 @@
+/**
+ * @file WY_IniTypedAgent.c
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "WY_IniTypedAgent.h"
+#include "WY_IniAllocAgent.h"
+
+#define WYINI_DOUBLE_EXACT_MAX 9007199254740992u /**< 2^53. Integers up to this are held exactly in a double. */
+#define WYINI_DOUBLE_EXACT_POW10 22 /**< Largest power of 10 held exactly in a double. */
+
+
+static const char m_digit_pairs[] = /**< The decimal digits of 0 to 99, two chars each. */
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+static const double m_pow10[WYINI_DOUBLE_EXACT_POW10 + 1] = { /**< The powers of 10 held exactly in a double. */
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+/**
+ * A unit accepted in a duration, e.g. the "s" in "30s".
+ */
+struct S_wyini_duration_unit
+{
+    const char *m_name; /**< The unit as written after the number. */
+    uint64_t m_ms; /**< Length of the unit in milliseconds. */
+};
+
+static const struct S_wyini_duration_unit m_duration_units[] = { /**< The units of a duration, largest first as wyini_format_duration() tries them in this order. */
+    {"d", 86400000u}, {"h", 3600000u}, {"m", 60000u}, {"s", 1000u}, {"ms", 1u}
+};
+
+
+/**
+ * Reads the decimal digits at the start of a value.
+ * @param p_val The value.
+ * @param p_val_len Length of the value.
+ * @param p_num Returns the number.
+ * @return Number of digits read. 0 if there are none or the number does not fit into 64 bits.
+ */
+static unsigned int wyini_parse_digits(const char *restrict const p_val, const unsigned int p_val_len, uint64_t *restrict p_num)
+{
+    uint64_t num = 0;
+    unsigned int i = 0;
+
+    for(; (i < p_val_len) && (p_val[i] >= '0') && (p_val[i] <= '9'); ++i) {
+        const unsigned int digit = (unsigned int)(p_val[i] - '0');
+        if(num > (UINT64_MAX - digit) / 10) /* Overflow. */
+            return 0;
+        num = num*10 + digit;
+    }
+    *p_num = num;
+    return i;
+}
+
+
+
+/**
+ * Converts an unsigned integer, either in decimal or in hexadecimal with a "0x" prefix. The whole value must be the number.
+ * @param p_val The value.
+ * @param p_val_len Length of the value.
+ * @param p_num Returns the number.
+ * @return WYINI_OK if success. Else WYINI_TYPE_ERR.
+ */
+static int wyini_parse_uint64(const char *restrict const p_val, const unsigned int p_val_len, uint64_t *restrict p_num)
+{
+    if((p_val_len > 2) && (p_val[0] == '0') && ((p_val[1] == 'x') || (p_val[1] == 'X'))) {
+        uint64_t num = 0;
+        for(unsigned int i=2; i<p_val_len; ++i) {
+            unsigned int digit;
+            if((p_val[i] >= '0') && (p_val[i] <= '9'))
+                digit = (unsigned int)(p_val[i] - '0');
+            else if((p_val[i] >= 'a') && (p_val[i] <= 'f'))
+                digit = (unsigned int)(p_val[i] - 'a' + 10);
+            else if((p_val[i] >= 'A') && (p_val[i] <= 'F'))
+                digit = (unsigned int)(p_val[i] - 'A' + 10);
+            else
+                return WYINI_TYPE_ERR;
+            if(num > (UINT64_MAX >> 4)) /* Overflow. */
+                return WYINI_TYPE_ERR;
+            num = (num << 4) | digit;
+        }
+        *p_num = num;
+        return WYINI_OK;
+    }
+
+    if((p_val_len == 0) || (wyini_parse_digits(p_val, p_val_len, p_num) != p_val_len))
+        return WYINI_TYPE_ERR;
+    return WYINI_OK;
+}
+
+
+
+/**
+ * Converts a floating point number. Plain decimals with few enough digits, e.g. "0.25" or "-1500", are converted directly since both the digits and the power of 10 are exact in a double and a single division rounds correctly. Everything else is left to strtod().
+ * @param p_val The value.
+ * @param p_val_len Length of the value.
+ * @param p_num Returns the number.
+ * @return WYINI_OK if success. Else WYINI_TYPE_ERR.
+ */
+static int wyini_parse_double(const char *restrict const p_val, const unsigned int p_val_len, double *restrict p_num)
+{
+    unsigned int i = 0;
+    bool negative = false;
+    bool seen_dot = false;
+    bool fast = true;
+    uint64_t mantissa = 0;
+    unsigned int digits = 0;
+    unsigned int frac_digits = 0;
+
+    if((i < p_val_len) && ((p_val[i] == '-') || (p_val[i] == '+')))
+        negative = (p_val[i++] == '-');
+    for(; (i < p_val_len) && fast; ++i) {
+        if((p_val[i] >= '0') && (p_val[i] <= '9')) {
+            mantissa = mantissa*10 + (uint64_t)(p_val[i] - '0');
+            frac_digits += seen_dot ? 1 : 0;
+            fast = (++digits <= 15); /* 10^15 < 2^53 and 10^15 <= 10^22, so the mantissa and the power of 10 stay exact. */
+        } else if((p_val[i] == '.') && !seen_dot)
+            seen_dot = true;
+        else
+            fast = false;
+    }
+    if(fast && (digits > 0)) {
+        const double num = (double)mantissa / m_pow10[frac_digits];
+        *p_num = negative ? -num : num;
+        return WYINI_OK;
+    }
+
+    char tmp[WYINI_MAX_VAL_LEN]; /* strtod() needs a terminated value. */
+    char *end = NULL;
+    if((p_val_len == 0) || (p_val_len >= WYINI_MAX_VAL_LEN) || (p_val[0] == ' ') || (p_val[0] == '\t'))
+        return WYINI_TYPE_ERR;
+    memcpy(tmp, p_val, p_val_len);
+    tmp[p_val_len] = 0;
+    errno = 0;
+    const double num = strtod(tmp, &end);
+    if((end != tmp + p_val_len) || ((errno == ERANGE) && ((num == HUGE_VAL) || (num == -HUGE_VAL)))) /* Trailing garbage or overflow. */
+        return WYINI_TYPE_ERR;
+    *p_num = num;
+    return WYINI_OK;
+}
+
+
+
+/**
+ * Compares a value to a word, ignoring the case of the value.
+ * @param p_val The value.
+ * @param p_val_len Length of the value.
+ * @param p_word The word, in lower case.
+ * @return true if they are equal.
+ */
+static bool wyini_equals_word(const char *restrict const p_val, const unsigned int p_val_len, const char *restrict const p_word)
+{
+    unsigned int i = 0;
+    for(; (i < p_val_len) && (p_word[i] != 0); ++i) {
+        const char c = ((p_val[i] >= 'A') && (p_val[i] <= 'Z')) ? (char)(p_val[i] - 'A' + 'a') : p_val[i];
+        if(c != p_word[i])
+            return false;
+    }
+    return (i == p_val_len) && (p_word[i] == 0);
+}
+
+
+
+/**
+ * Converts a boolean. "true", "yes", "on" and "1" are true, "false", "no", "off" and "0" are false, in any case.
+ * @param p_val The value.
+ * @param p_val_len Length of the value.
+ * @param p_bool Returns the boolean.
+ * @return WYINI_OK if success. Else WYINI_TYPE_ERR.
+ */
+static int wyini_parse_bool(const char *restrict const p_val, const unsigned int p_val_len, bool *restrict p_bool)
+{
+    static const char *const true_words[] = {"true", "yes", "on", "1"};
+    static const char *const false_words[] = {"false", "no", "off", "0"};
+
+    for(unsigned int i=0; i<sizeof(true_words)/sizeof(true_words[0]); ++i) {
+        if(wyini_equals_word(p_val, p_val_len, true_words[i])) {
+            *p_bool = true;
+            return WYINI_OK;
+        }
+        if(wyini_equals_word(p_val, p_val_len, false_words[i])) {
+            *p_bool = false;
+            return WYINI_OK;
+        }
+    }
+    return WYINI_TYPE_ERR;
+}
+
+
+
+/**
+ * Converts a duration to milliseconds. A duration is one or more numbers, each followed by a unit of "d", "h", "m", "s" or "ms", e.g. "1h30m" or "250 ms". A lone number without a unit is taken as milliseconds.
+ * @param p_val The value.
+ * @param p_val_len Length of the value.
+ * @param p_ms Returns the duration in milliseconds.
+ * @return WYINI_OK if success. Else WYINI_TYPE_ERR.
+ */
+static int wyini_parse_duration(const char *restrict const p_val, const unsigned int p_val_len, uint64_t *restrict p_ms)
+{
+    uint64_t total = 0;
+    unsigned int i = 0;
+
+    while(i < p_val_len) {
+        uint64_t num = 0;
+        uint64_t unit_ms = 0;
+        const unsigned int digits = wyini_parse_digits(p_val + i, p_val_len - i, &num);
+        if(digits == 0)
+            return WYINI_TYPE_ERR;
+        i += digits;
+        while((i < p_val_len) && (p_val[i] == ' '))
+            ++i;
+
+        unsigned int unit_len = 0;
+        while((i + unit_len < p_val_len) && (((p_val[i+unit_len] >= 'a') && (p_val[i+unit_len] <= 'z')) || ((p_val[i+unit_len] >= 'A') && (p_val[i+unit_len] <= 'Z'))))
+            ++unit_len;
+        if(unit_len == 0) {
+            if((i != digits) || (i < p_val_len)) /* Only a lone number may leave out the unit. */
+                return WYINI_TYPE_ERR;
+            unit_ms = 1;
+        } else {
+            for(unsigned int u=0; u<sizeof(m_duration_units)/sizeof(m_duration_units[0]); ++u) {
+                if(wyini_equals_word(p_val + i, unit_len, m_duration_units[u].m_name))
+                    unit_ms = m_duration_units[u].m_ms;
+            }
+            if(unit_ms == 0)
+                return WYINI_TYPE_ERR;
+            i += unit_len;
+        }
+
+        if((num > UINT64_MAX / unit_ms) || (total > UINT64_MAX - num*unit_ms)) /* Overflow. */
+            return WYINI_TYPE_ERR;
+        total += num*unit_ms;
+        while((i < p_val_len) && (p_val[i] == ' '))
+            ++i;
+    }
+    if(i == 0) /* Empty value. */
+        return WYINI_TYPE_ERR;
+    *p_ms = total;
+    return WYINI_OK;
+}
+
+
+
+void wyini_typed_init(struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    p_wyini_buffer->m_typed = NULL;
+    p_wyini_buffer->m_typed_count = 0;
+}
+
+
+
+void wyini_typed_clean(struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    if(p_wyini_buffer->m_typed != NULL)
+        wyini_mem_free(&(p_wyini_buffer->m_allocator), p_wyini_buffer->m_typed, p_wyini_buffer->m_typed_count*sizeof(struct S_wyini_typed));
+    wyini_typed_init(p_wyini_buffer);
+}
+
+
+
+struct S_wyini_typed * wyini_typed_get(const unsigned int p_entry, struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    if(p_wyini_buffer->m_typed == NULL) {
+        const size_t typed_size = p_wyini_buffer->m_index.m_count*sizeof(struct S_wyini_typed);
+        if((p_wyini_buffer->m_typed = (struct S_wyini_typed*)wyini_mem_alloc(&(p_wyini_buffer->m_allocator), typed_size)) == NULL)
+            return NULL;
+        memset(p_wyini_buffer->m_typed, 0, typed_size); /* All zero, i.e. WYINI_TYPED_NONE. */
+        p_wyini_buffer->m_typed_count = p_wyini_buffer->m_index.m_count;
+    }
+    return p_wyini_buffer->m_typed + p_entry;
+}
+
+
+
+void wyini_typed_forget(const unsigned int p_entry, struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    if(p_entry < p_wyini_buffer->m_typed_count)
+        p_wyini_buffer->m_typed[p_entry].m_type = WYINI_TYPED_NONE;
+}
+
+
+
+void wyini_typed_reindexed(struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    if((p_wyini_buffer->m_typed != NULL) && (p_wyini_buffer->m_typed_count != p_wyini_buffer->m_index.m_count))
+        wyini_typed_clean(p_wyini_buffer);
+}
+
+
+
+int wyini_typed_parse(const int p_type, const char *restrict const p_val, const unsigned int p_val_len, struct S_wyini_typed *restrict p_typed)
+{
+    uint64_t magnitude = 0;
+
+    switch(p_type) {
+    case WYINI_TYPED_INT64:
+        if((p_val_len > 0) && ((p_val[0] == '-') || (p_val[0] == '+'))) {
+            if(wyini_parse_uint64(p_val + 1, p_val_len - 1, &magnitude) != WYINI_OK)
+                return WYINI_TYPE_ERR;
+            if(p_val[0] == '-') {
+                if(magnitude > (uint64_t)INT64_MAX + 1)
+                    return WYINI_TYPE_ERR;
+                p_typed->m_int64 = (magnitude == (uint64_t)INT64_MAX + 1) ? INT64_MIN : -(int64_t)magnitude;
+                return WYINI_OK;
+            }
+        } else if(wyini_parse_uint64(p_val, p_val_len, &magnitude) != WYINI_OK)
+            return WYINI_TYPE_ERR;
+        if(magnitude > (uint64_t)INT64_MAX)
+            return WYINI_TYPE_ERR;
+        p_typed->m_int64 = (int64_t)magnitude;
+        return WYINI_OK;
+    case WYINI_TYPED_UINT64:
+        if((p_val_len > 0) && (p_val[0] == '+'))
+            return wyini_parse_uint64(p_val + 1, p_val_len - 1, &(p_typed->m_uint64));
+        return wyini_parse_uint64(p_val, p_val_len, &(p_typed->m_uint64));
+    case WYINI_TYPED_DOUBLE:
+        return wyini_parse_double(p_val, p_val_len, &(p_typed->m_double));
+    case WYINI_TYPED_BOOL:
+        return wyini_parse_bool(p_val, p_val_len, &(p_typed->m_bool));
+    case WYINI_TYPED_DURATION:
+        return wyini_parse_duration(p_val, p_val_len, &(p_typed->m_uint64));
+    default:
+        return WYINI_TYPE_ERR;
+    }
+}
+
+
+
+unsigned int wyini_format_uint64(const uint64_t p_num, char *restrict p_out)
+{
+    uint64_t num = p_num;
+    char tmp[WYINI_TYPED_MAX_CHARS];
+    char *ptr = tmp + sizeof(tmp);
+
+    while(num >= 100) { /* Two digits at a time, from the end. */
+        const unsigned int pair = (unsigned int)(num % 100) * 2;
+        num /= 100;
+        *--ptr = m_digit_pairs[pair + 1];
+        *--ptr = m_digit_pairs[pair];
+    }
+    if(num >= 10) {
+        *--ptr = m_digit_pairs[num*2 + 1];
+        *--ptr = m_digit_pairs[num*2];
+    } else
+        *--ptr = (char)('0' + num);
+
+    const unsigned int len = (unsigned int)(tmp + sizeof(tmp) - ptr);
+    memcpy(p_out, ptr, len);
+    p_out[len] = 0;
+    return len;
+}
+
+
+
+unsigned int wyini_format_int64(const int64_t p_num, char *restrict p_out)
+{
+    if(p_num < 0) {
+        p_out[0] = '-';
+        return 1 + wyini_format_uint64(0 - (uint64_t)p_num, p_out + 1);
+    }
+    return wyini_format_uint64((uint64_t)p_num, p_out);
+}
+
+
+
+unsigned int wyini_format_double(const double p_num, char *restrict p_out)
+{
+    if(!isfinite(p_num)) {
+        strcpy(p_out, isnan(p_num) ? "nan" : ((p_num > 0) ? "inf" : "-inf"));
+        return (unsigned int)strlen(p_out);
+    }
+    if((fabs(p_num) <= (double)WYINI_DOUBLE_EXACT_MAX) && (p_num == (double)(int64_t)p_num) && !((p_num == 0) && signbit(p_num))) /* Whole numbers are formatted as integers. */
+        return wyini_format_int64((int64_t)p_num, p_out);
+
+    for(int precision=15; precision<17; ++precision) { /* Try the shortest precisions first. 17 digits always convert back exactly. */
+        const int len = snprintf(p_out, WYINI_TYPED_MAX_CHARS, "%.*g", precision, p_num);
+        if(strtod(p_out, NULL) == p_num)
+            return (unsigned int)len;
+    }
+    return (unsigned int)snprintf(p_out, WYINI_TYPED_MAX_CHARS, "%.17g", p_num);
+}
+
+
+
+unsigned int wyini_format_duration(const uint64_t p_ms, char *restrict p_out)
+{
+    unsigned int u = 0;
+
+    while((p_ms != 0) && (p_ms % m_duration_units[u].m_ms != 0)) /* The last unit, "ms", always divides. */
+        ++u;
+    if(p_ms == 0)
+        u = sizeof(m_duration_units)/sizeof(m_duration_units[0]) - 1;
+
+    const unsigned int len = wyini_format_uint64(p_ms / m_duration_units[u].m_ms, p_out);
+    strcpy(p_out + len, m_duration_units[u].m_name);
+    return len + (unsigned int)strlen(m_duration_units[u].m_name);
+}
+
+
+
+void wyini_typed_appended(struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    const unsigned int count = p_wyini_buffer->m_index.m_count;
+
+    if((p_wyini_buffer->m_typed == NULL) || (p_wyini_buffer->m_typed_count == count))
+        return;
+    struct S_wyini_typed *tmp = (struct S_wyini_typed*)wyini_mem_realloc(&(p_wyini_buffer->m_allocator), p_wyini_buffer->m_typed, p_wyini_buffer->m_typed_count*sizeof(struct S_wyini_typed), count*sizeof(struct S_wyini_typed));
+    if(tmp == NULL) { /* Start over on the next typed access instead. */
+        wyini_typed_clean(p_wyini_buffer);
+        return;
+    }
+    memset(tmp + p_wyini_buffer->m_typed_count, 0, (count - p_wyini_buffer->m_typed_count)*sizeof(struct S_wyini_typed)); /* All zero, i.e. WYINI_TYPED_NONE. */
+    p_wyini_buffer->m_typed = tmp;
+    p_wyini_buffer->m_typed_count = count;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file WY_IniTypedAgent.h
+ * Declares functions for converting values to and from numbers and booleans, and for caching the converted values.
+ * \n
+ * The cache holds one S_wyini_typed for each index entry in m_typed. It is allocated on first use, so handles that never call a typed accessor pay nothing for it. A write clears the element of the line it writes to, so a cached value is only converted again once the bytes of its own line change.
+*/
+
+#ifndef _WY_INITYPEDAGENT_H_
+#define _WY_INITYPEDAGENT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "WY_IniDefs.h"
+
+#define WYINI_TYPED_MAX_CHARS 32 /**< Size of a buffer large enough for any value formatted by the wyini_format_* functions, including the terminating 0. */
+
+
+/**
+ * Initialises the typed value cache of an S_wyini_buffer to empty. Does not allocate memory.
+ * @param p_wyini_buffer The S_wyini_buffer to initialise.
+ */
+void wyini_typed_init(struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Frees the typed value cache of an S_wyini_buffer and resets it to empty.
+ * @param p_wyini_buffer The S_wyini_buffer to clean.
+ */
+void wyini_typed_clean(struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Gets the cache element of a line, allocating the cache if necessary.
+ * @param p_entry Index into m_index.m_entries of the line.
+ * @param p_wyini_buffer The S_wyini_buffer holding the line.
+ * @return The cache element. NULL if the cache could not be allocated, in which case values are simply converted on every call.
+ */
+struct S_wyini_typed * wyini_typed_get(const unsigned int p_entry, struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Clears the cached value of a line. Called whenever the value of the line is written.
+ * @param p_entry Index into m_index.m_entries of the line.
+ * @param p_wyini_buffer The S_wyini_buffer holding the line.
+ */
+void wyini_typed_forget(const unsigned int p_entry, struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Brings the cache in line with an index rebuilt after values were written. Writes never remove a line containing '=', so if the number of entries is unchanged every entry still describes the same line and the cache is kept. Otherwise it is freed. After lines are inserted or removed the cache must be freed with wyini_typed_clean() instead.
+ * @param p_wyini_buffer The S_wyini_buffer whose m_index was rebuilt.
+ */
+void wyini_typed_reindexed(struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Brings the cache in line with an index extended by wyini_index_append(). The entries before the appended lines are unchanged, so the cache is kept and grown by an empty element for each new entry. If it cannot be grown it is freed.
+ * @param p_wyini_buffer The S_wyini_buffer whose m_index was extended.
+ */
+void wyini_typed_appended(struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Converts a value to the given type.
+ * @param p_type One of the WYINI_TYPED_* definitions, except WYINI_TYPED_NONE.
+ * @param p_val The value, without leading and trailing whitespace. Need not be terminated with a 0.
+ * @param p_val_len Length of the value.
+ * @param p_typed Returns the converted value in the member for p_type. m_type and m_status are not touched.
+ * @return WYINI_OK if success. WYINI_TYPE_ERR if the value is not of the type or out of its range.
+ */
+int wyini_typed_parse(const int p_type, const char *restrict const p_val, const unsigned int p_val_len, struct S_wyini_typed *restrict p_typed);
+
+
+/**
+ * Formats a signed integer in decimal.
+ * @param p_num The number.
+ * @param p_out Returns the formatted number, terminated with a 0. Must hold WYINI_TYPED_MAX_CHARS chars.
+ * @return Length of the formatted number.
+ */
+unsigned int wyini_format_int64(const int64_t p_num, char *restrict p_out);
+
+
+/**
+ * Formats an unsigned integer in decimal.
+ * @param p_num The number.
+ * @param p_out Returns the formatted number, terminated with a 0. Must hold WYINI_TYPED_MAX_CHARS chars.
+ * @return Length of the formatted number.
+ */
+unsigned int wyini_format_uint64(const uint64_t p_num, char *restrict p_out);
+
+
+/**
+ * Formats a floating point number with as few digits as converting it back needs to give the same number.
+ * @param p_num The number.
+ * @param p_out Returns the formatted number, terminated with a 0. Must hold WYINI_TYPED_MAX_CHARS chars.
+ * @return Length of the formatted number.
+ */
+unsigned int wyini_format_double(const double p_num, char *restrict p_out);
+
+
+/**
+ * Formats a duration in the largest unit that holds it exactly, e.g. "90s" or "250ms".
+ * @param p_ms The duration in milliseconds.
+ * @param p_out Returns the formatted duration, terminated with a 0. Must hold WYINI_TYPED_MAX_CHARS chars.
+ * @return Length of the formatted duration.
+ */
+unsigned int wyini_format_duration(const uint64_t p_ms, char *restrict p_out);
+
+#endif
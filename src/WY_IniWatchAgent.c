@@ -0,0 +1,291 @@
+/**
+ * @file WY_IniWatchAgent.c
+*/
+#if !defined _OS_WINDOWS_
+#define _POSIX_C_SOURCE 200809L /* Exposes the POSIX thread and file functions under -std=c17. */
+#endif
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "WY_IniWatchAgent.h"
+#include "WY_IniMgr.h"
+#if defined WYINI_HAVE_WATCH
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#define WYINI_WATCH_RECLAIM_MS 10 /**< How often the watcher thread retries freeing retired snapshots that are still in use. */
+
+
+/**
+ * Frees every retired snapshot that no reader can still be using.
+ * @param p_watch The watched file.
+ */
+static void wyini_watch_reclaim(struct S_wyini_watch *restrict p_watch)
+{
+    unsigned long long oldest = 0; /* Oldest epoch any reader entered at, 0 if no reader is in a snapshot. */
+
+    if(p_watch->m_retired == NULL)
+        return;
+    for(unsigned int i=0; i<WYINI_WATCH_MAX_READERS; ++i) {
+        const unsigned long long epoch = atomic_load(&(p_watch->m_readers[i].m_epoch));
+        if((epoch != 0) && ((oldest == 0) || (epoch < oldest)))
+            oldest = epoch;
+    }
+
+    struct S_wyini_watch_retired **link = &(p_watch->m_retired);
+    while(*link != NULL) {
+        struct S_wyini_watch_retired *retired = *link;
+        if((oldest == 0) || (oldest >= retired->m_epoch)) { /* Every reader entered after the snapshot was replaced. */
+            *link = retired->m_next;
+            wyini_close_h(retired->m_snapshot);
+            free(retired);
+        } else
+            link = &(retired->m_next);
+    }
+}
+
+
+
+/**
+ * Parses the watched file into a new snapshot and publishes it. If the file cannot be opened, e.g. because it is being replaced right now, the current snapshot is kept.
+ * @param p_watch The watched file.
+ */
+static void wyini_watch_reload(struct S_wyini_watch *restrict p_watch)
+{
+    struct S_wyini_watch_retired *retired;
+    wyini_handle_t *snapshot;
+
+    if((retired = (struct S_wyini_watch_retired*)malloc(sizeof(struct S_wyini_watch_retired))) == NULL)
+        return;
+    if(wyini_open_h(p_watch->m_file, p_watch->m_max_size, &snapshot) != WYINI_OK) {
+        free(retired);
+        return;
+    }
+
+    retired->m_snapshot = atomic_exchange(&(p_watch->m_current), snapshot);
+    retired->m_epoch = atomic_fetch_add(&(p_watch->m_epoch), 1) + 1; /* Advanced after the swap, so readers at this epoch or later see the new snapshot. */
+    retired->m_next = p_watch->m_retired;
+    p_watch->m_retired = retired;
+    atomic_fetch_add(&(p_watch->m_version), 1);
+}
+
+
+
+/**
+ * The watcher thread. Waits for changes to the watched file and reloads it, until m_stop is set.
+ * @param p_arg The watched file.
+ */
+static void * wyini_watch_thread(void *p_arg)
+{
+    struct S_wyini_watch *restrict watch = (struct S_wyini_watch*)p_arg;
+    _Alignas(struct inotify_event) char events[4096];
+    struct pollfd fds[2];
+
+    fds[0].fd = watch->m_inotify_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = watch->m_wake_fd[0];
+    fds[1].events = POLLIN;
+
+    while(atomic_load(&(watch->m_stop)) == 0) {
+        if(poll(fds, 2, (watch->m_retired != NULL) ? WYINI_WATCH_RECLAIM_MS : -1) < 0) {
+            if(errno == EINTR)
+                continue;
+            break;
+        }
+
+        bool changed = false;
+        ssize_t len;
+        while((len = read(watch->m_inotify_fd, events, sizeof(events))) > 0) { /* Drain all pending events so a burst of changes causes only one reload. */
+            for(char *ptr = events; ptr < events + len; ) {
+                const struct inotify_event *restrict event = (const struct inotify_event*)ptr;
+                if((event->len > 0) && (strcmp(event->name, watch->m_name) == 0))
+                    changed = true;
+                ptr += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        if(changed)
+            wyini_watch_reload(watch);
+        wyini_watch_reclaim(watch);
+    }
+    return NULL;
+}
+#endif
+
+
+
+int wyini_watch_open(const char *restrict const p_file, const unsigned int p_max_size, wyini_watch_t *restrict *restrict p_watch)
+{
+#if defined WYINI_HAVE_WATCH
+    struct S_wyini_watch *watch;
+    wyini_handle_t *snapshot = NULL;
+    int return_val = WYINI_MEMORY_ERR;
+    const size_t file_len = strlen(p_file);
+
+    *p_watch = NULL;
+    if((watch = (struct S_wyini_watch*)calloc(1, sizeof(struct S_wyini_watch))) == NULL)
+        return WYINI_MEMORY_ERR;
+    watch->m_inotify_fd = -1;
+    watch->m_wake_fd[0] = -1;
+    watch->m_wake_fd[1] = -1;
+    for(unsigned int i=0; i<WYINI_WATCH_MAX_READERS; ++i) {
+        atomic_init(&(watch->m_readers[i].m_in_use), 0);
+        atomic_init(&(watch->m_readers[i].m_epoch), 0);
+    }
+    atomic_init(&(watch->m_epoch), 1);
+    atomic_init(&(watch->m_version), 0);
+    atomic_init(&(watch->m_stop), 0);
+    watch->m_max_size = p_max_size;
+
+    if((watch->m_file = (char*)malloc(2*file_len + 3)) == NULL) /* The path, followed by its directory. */
+        goto bad_exit;
+    memcpy(watch->m_file, p_file, file_len + 1);
+    char *dir = watch->m_file + file_len + 1;
+    const char *slash = strrchr(watch->m_file, '/');
+    if(slash == NULL) {
+        watch->m_name = watch->m_file;
+        strcpy(dir, ".");
+    } else {
+        watch->m_name = slash + 1;
+        memcpy(dir, watch->m_file, (size_t)(slash - watch->m_file) + 1); /* Keep the '/' so that "/file" watches "/". */
+        dir[slash - watch->m_file + 1] = 0;
+    }
+
+    if((return_val = wyini_open_h(p_file, p_max_size, &snapshot)) != WYINI_OK)
+        goto bad_exit;
+    atomic_init(&(watch->m_current), snapshot);
+
+    /* Watch the directory rather than the file, since saving by rename replaces the file and would end a watch on it. IN_CLOSE_WRITE catches files written in place, IN_MOVED_TO files renamed into place. */
+    return_val = WYINI_IO_ERR;
+    if((watch->m_inotify_fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC)) < 0)
+        goto bad_exit;
+    if(inotify_add_watch(watch->m_inotify_fd, dir, IN_CLOSE_WRITE|IN_MOVED_TO) < 0)
+        goto bad_exit;
+    if(pipe(watch->m_wake_fd) != 0)
+        goto bad_exit;
+    if(pthread_create(&(watch->m_thread), NULL, wyini_watch_thread, watch) != 0)
+        goto bad_exit;
+
+    *p_watch = watch;
+    return WYINI_OK;
+
+bad_exit:
+    if(watch->m_inotify_fd >= 0)
+        close(watch->m_inotify_fd);
+    if(watch->m_wake_fd[0] >= 0) {
+        close(watch->m_wake_fd[0]);
+        close(watch->m_wake_fd[1]);
+    }
+    wyini_close_h(snapshot);
+    free(watch->m_file);
+    free(watch);
+    return return_val;
+#else
+    (void)p_file;
+    (void)p_max_size;
+    *p_watch = NULL;
+    return WYINI_IO_ERR;
+#endif
+}
+
+
+
+void wyini_watch_close(wyini_watch_t *restrict p_watch)
+{
+#if defined WYINI_HAVE_WATCH
+    if(p_watch == NULL)
+        return;
+    atomic_store(&(p_watch->m_stop), 1);
+    while((write(p_watch->m_wake_fd[1], "", 1) < 0) && (errno == EINTR)) /* Wake the thread up from poll(). */
+        ;
+    pthread_join(p_watch->m_thread, NULL);
+
+    while(p_watch->m_retired != NULL) { /* No readers are left, so everything can go. */
+        struct S_wyini_watch_retired *retired = p_watch->m_retired;
+        p_watch->m_retired = retired->m_next;
+        wyini_close_h(retired->m_snapshot);
+        free(retired);
+    }
+    wyini_close_h(atomic_load(&(p_watch->m_current)));
+    close(p_watch->m_inotify_fd);
+    close(p_watch->m_wake_fd[0]);
+    close(p_watch->m_wake_fd[1]);
+    free(p_watch->m_file);
+    free(p_watch);
+#else
+    (void)p_watch;
+#endif
+}
+
+
+
+int wyini_watch_register(wyini_watch_t *restrict p_watch, unsigned int *restrict p_reader)
+{
+#if defined WYINI_HAVE_WATCH
+    for(unsigned int i=0; i<WYINI_WATCH_MAX_READERS; ++i) {
+        unsigned int expected = 0;
+        if(atomic_compare_exchange_strong(&(p_watch->m_readers[i].m_in_use), &expected, 1)) {
+            *p_reader = i;
+            return WYINI_OK;
+        }
+    }
+#else
+    (void)p_watch;
+    (void)p_reader;
+#endif
+    return WYINI_MEMORY_ERR; /* All slots are taken. */
+}
+
+
+
+void wyini_watch_unregister(wyini_watch_t *restrict p_watch, const unsigned int p_reader)
+{
+#if defined WYINI_HAVE_WATCH
+    atomic_store(&(p_watch->m_readers[p_reader].m_epoch), 0);
+    atomic_store(&(p_watch->m_readers[p_reader].m_in_use), 0);
+#else
+    (void)p_watch;
+    (void)p_reader;
+#endif
+}
+
+
+
+const wyini_handle_t * wyini_watch_enter(wyini_watch_t *restrict p_watch, const unsigned int p_reader)
+{
+#if defined WYINI_HAVE_WATCH
+    /* Announce the epoch before loading the snapshot. Both are sequentially consistent, so a reload that swaps m_current after this load advances m_epoch past the value stored here. */
+    atomic_store(&(p_watch->m_readers[p_reader].m_epoch), atomic_load(&(p_watch->m_epoch)));
+    return atomic_load(&(p_watch->m_current));
+#else
+    (void)p_watch;
+    (void)p_reader;
+    return NULL;
+#endif
+}
+
+
+
+void wyini_watch_leave(wyini_watch_t *restrict p_watch, const unsigned int p_reader)
+{
+#if defined WYINI_HAVE_WATCH
+    atomic_store_explicit(&(p_watch->m_readers[p_reader].m_epoch), 0, memory_order_release); /* All reads of the snapshot happen before this. */
+#else
+    (void)p_watch;
+    (void)p_reader;
+#endif
+}
+
+
+
+unsigned long wyini_watch_version(wyini_watch_t *restrict p_watch)
+{
+#if defined WYINI_HAVE_WATCH
+    return atomic_load(&(p_watch->m_version));
+#else
+    (void)p_watch;
+    return 0;
+#endif
+}
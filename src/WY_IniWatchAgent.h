@@ -0,0 +1,68 @@
+/**
+ * @file WY_IniWatchAgent.h
+ * Declares the state of a watched file for the wyini_watch_* API functions in WY_IniMgr.h.
+ * \n
+ * A watcher thread waits for inotify events on the directory of the file and parses every new version of the file into a fresh handle, i.e. a snapshot. The snapshot is published by swapping m_current atomically, so readers only ever see complete snapshots and never wait for a reload.
+ * \n
+ * Old snapshots are freed with epoch-based reclamation. Each reader holds a slot in m_readers. Entering a snapshot stores the current m_epoch in the slot and leaving it stores 0. A reload swaps m_current, then advances m_epoch and tags the old snapshot with the new epoch. A reader that entered at that epoch or later must have loaded the new snapshot, so the old one is freed once every slot is 0 or at least that epoch.
+ * \n
+ * inotify is Linux-specific. On other systems wyini_watch_open() fails with WYINI_IO_ERR.
+*/
+
+#ifndef _WY_INIWATCHAGENT_H_
+#define _WY_INIWATCHAGENT_H_
+
+#if defined __linux__ && !defined _OS_WINDOWS_
+#define WYINI_HAVE_WATCH /**< inotify and pthreads are available on this system. */
+#endif
+
+#include "WY_IniDefs.h"
+
+#if defined WYINI_HAVE_WATCH
+#include <stdatomic.h>
+#include <pthread.h>
+
+/**
+ * A reader slot. Each slot takes up its own cache line so readers do not slow each other down.
+ */
+struct S_wyini_watch_reader
+{
+    _Alignas(64) atomic_uint m_in_use; /**< 1 if the slot is registered to a reader. */
+    atomic_ullong m_epoch; /**< The epoch the reader entered at. 0 if the reader is not in a snapshot. */
+};
+
+/**
+ * A snapshot replaced by a reload that may still be in use by readers.
+ */
+struct S_wyini_watch_retired
+{
+    struct S_wyini_buffer *m_snapshot; /**< The replaced snapshot. */
+    unsigned long long m_epoch; /**< Readers that entered at this epoch or later cannot see m_snapshot. */
+    struct S_wyini_watch_retired *m_next; /**< Next retired snapshot, or NULL. */
+};
+#endif
+
+/**
+ * A file watched for changes by wyini_watch_open().
+ */
+struct S_wyini_watch
+{
+#if defined WYINI_HAVE_WATCH
+    struct S_wyini_buffer *_Atomic m_current; /**< The latest snapshot. */
+    atomic_ullong m_epoch; /**< Advanced on every reload. Starts at 1, since 0 marks a reader that is not in a snapshot. */
+    atomic_ulong m_version; /**< Number of successful reloads. */
+    atomic_int m_stop; /**< Set to 1 to stop the watcher thread. */
+    struct S_wyini_watch_reader m_readers[WYINI_WATCH_MAX_READERS]; /**< Reader slots. */
+    struct S_wyini_watch_retired *m_retired; /**< Replaced snapshots not yet freed. Only used by the watcher thread. */
+    char *m_file; /**< Path of the watched file. */
+    const char *m_name; /**< File name part of m_file, compared against inotify events. */
+    unsigned int m_max_size; /**< The size limit passed to wyini_watch_open(). */
+    int m_inotify_fd; /**< inotify instance watching the directory of m_file. */
+    int m_wake_fd[2]; /**< Pipe that wakes the watcher thread up to stop it. */
+    pthread_t m_thread; /**< The watcher thread. */
+#else
+    int m_unused; /**< Placeholder. The struct is never allocated without WYINI_HAVE_WATCH. */
+#endif
+};
+
+#endif
@@ -2,42 +2,505 @@
  * @file WY_IniWriteAgent.c
 */
 
+#include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "WY_IniWriteAgent.h"
+#include "WY_IniParseAgent.h"
+#include "WY_IniIndexAgent.h"
+#include "WY_IniTypedAgent.h"
+#include "WY_IniAllocAgent.h"
+#include "WY_IniStatsAgent.h"
 
+#if !defined WYINI_EDIT_MIN_SIZE
+#define WYINI_EDIT_MIN_SIZE 4096 /**< Initial size of m_edit_buffer. Also how far m_edit_buffer may outgrow m_buffer before it is flattened. */
+#endif
 
-unsigned int wyini_remove_ending_whitespace(const unsigned int p_start_offset, unsigned int p_end_offset, struct S_wyini_buffer *restrict p_wyini_buffer)
+
+/**
+ * Gets a char of a line that consists of an unchanged prefix in m_buffer followed by a value that may have been written.
+ */
+static char wyini_edit_char(const unsigned int p_index, const unsigned int p_prefix_len, const char *restrict const p_prefix, const char *restrict const p_val)
+{
+    return (p_index < p_prefix_len) ? p_prefix[p_index] : p_val[p_index - p_prefix_len];
+}
+
+
+
+unsigned int wyini_remove_ending_whitespace(const char *restrict const p_val, unsigned int p_val_len)
+{
+    while((p_val_len > 1) && (p_val[p_val_len-1] == ' '))
+        --p_val_len;
+    return p_val_len;
+}
+
+
+
+void wyini_edit_init(struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    p_wyini_buffer->m_edit_buffer = NULL;
+    p_wyini_buffer->m_edit_len = 0;
+    p_wyini_buffer->m_edit_size = 0;
+    p_wyini_buffer->m_edit_count = 0;
+    p_wyini_buffer->m_file = NULL;
+    memset(&(p_wyini_buffer->m_file_id), 0, sizeof(p_wyini_buffer->m_file_id));
+    p_wyini_buffer->m_dirty = NULL;
+    p_wyini_buffer->m_dirty_size = 0;
+    p_wyini_buffer->m_dirty_all = false;
+}
+
+
+
+void wyini_edit_clean(struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    if(p_wyini_buffer->m_edit_buffer != NULL)
+        wyini_mem_free(&(p_wyini_buffer->m_allocator), p_wyini_buffer->m_edit_buffer, p_wyini_buffer->m_edit_size);
+    if(p_wyini_buffer->m_file != NULL)
+        wyini_mem_free(&(p_wyini_buffer->m_allocator), p_wyini_buffer->m_file, strlen(p_wyini_buffer->m_file) + 1);
+    if(p_wyini_buffer->m_dirty != NULL)
+        wyini_mem_free(&(p_wyini_buffer->m_allocator), p_wyini_buffer->m_dirty, p_wyini_buffer->m_dirty_size);
+    wyini_edit_init(p_wyini_buffer);
+}
+
+
+
+const char * wyini_edit_get_val(const unsigned int p_entry, unsigned int *restrict p_val_len, const struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    const struct S_wyini_index_entry *restrict entry = p_wyini_buffer->m_index.m_entries + p_entry;
+
+    if(entry->m_edit_offset != WYINI_INDEX_NONE) {
+        *p_val_len = entry->m_edit_len;
+        return p_wyini_buffer->m_edit_buffer + entry->m_edit_offset;
+    }
+    *p_val_len = entry->m_val_end + 1 - entry->m_val_offset;
+    return p_wyini_buffer->m_buffer + entry->m_val_offset;
+}
+
+
+
+int wyini_edit_find_var_val(const bool p_var_only, const unsigned int p_entry, const unsigned int p_var_len, const char *restrict const p_var, unsigned int *restrict p_return_offset, const struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    const struct S_wyini_index_entry *restrict entry = p_wyini_buffer->m_index.m_entries + p_entry;
+    int return_val = WYINI_NOT_FOUND;
+
+    if(entry->m_edit_offset == WYINI_INDEX_NONE) { /* The line is unchanged and in one piece in m_buffer. */
+        if((return_val = wyini_find_var_val_inline(p_var_only, entry->m_var_offset, entry->m_val_end, p_var_len, p_var, p_return_offset, p_wyini_buffer)) == WYINI_OK)
+            *p_return_offset -= entry->m_val_offset;
+        return return_val;
+    }
+
+    /* Same steps as wyini_find_var_val_inline(), over the unchanged part of the line up to and including the first '=', followed by the written value. */
+    const char *restrict prefix = p_wyini_buffer->m_buffer + entry->m_var_offset;
+    const char *restrict val = p_wyini_buffer->m_edit_buffer + entry->m_edit_offset;
+    const unsigned int prefix_len = entry->m_val_offset - entry->m_var_offset;
+    const unsigned int line_len = prefix_len + entry->m_edit_len;
+    unsigned int i;
+
+    if(p_var_len >= line_len) /* No room for the 'var=' pattern. */
+        return WYINI_NOT_FOUND;
+    for(i=0; i<p_var_len; ++i) {
+        if(wyini_edit_char(i, prefix_len, prefix, val) != p_var[i]) /* Cannot match the var so exit. */
+            return WYINI_NOT_FOUND;
+    }
+
+    while(i<line_len) { /* Try to match the " =" pattern after the var. */
+        const char c = wyini_edit_char(i, prefix_len, prefix, val);
+        if(c==' ')
+            ++i;
+        else if(c=='=') {
+            return_val = WYINI_VAL_NOT_FOUND;
+            ++i;
+            break;
+        }
+        else
+            return WYINI_NOT_FOUND;
+    }
+    if(i >= line_len)
+        return return_val;
+
+    if(!p_var_only) {
+        while((i<line_len) && (wyini_edit_char(i, prefix_len, prefix, val) == ' ')) /* Skip any whitespace after the '=' pattern. */
+            ++i;
+        if(i >= line_len)
+            return WYINI_VAL_NOT_FOUND;
+    }
+    *p_return_offset = i - prefix_len; /* The first '=' ends the prefix, so a match always lies in the value. */
+    return WYINI_OK;
+}
+
+
+
+int wyini_edit_write(const unsigned int p_entry, const unsigned int p_keep_len, const unsigned int p_val_len, const char *restrict const p_val, struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    struct S_wyini_index_entry *restrict entry = p_wyini_buffer->m_index.m_entries + p_entry;
+    const unsigned int old_offset = entry->m_edit_offset;
+    const unsigned int old_len = entry->m_edit_len;
+    const unsigned int new_len = p_keep_len + p_val_len;
+    unsigned int current_len = 0;
+    int return_val;
+
+    wyini_typed_forget(p_entry, p_wyini_buffer); /* The bytes of the line change, so its converted value is stale. */
+    if((p_wyini_buffer->m_edit_buffer == NULL) || (new_len > p_wyini_buffer->m_edit_size - p_wyini_buffer->m_edit_len)) { /* Out of space. Grow m_edit_buffer geometrically. */
+        unsigned int new_size = (p_wyini_buffer->m_edit_size == 0) ? WYINI_EDIT_MIN_SIZE : p_wyini_buffer->m_edit_size*2;
+        while(new_size - p_wyini_buffer->m_edit_len < new_len)
+            new_size *= 2;
+        char *tmp = (char*)wyini_mem_realloc(&(p_wyini_buffer->m_allocator), p_wyini_buffer->m_edit_buffer, p_wyini_buffer->m_edit_size, new_size);
+        if(tmp == NULL)
+            return WYINI_MEMORY_ERR;
+        p_wyini_buffer->m_edit_buffer = tmp;
+        p_wyini_buffer->m_edit_size = new_size;
+    }
+
+    const char *restrict current = wyini_edit_get_val(p_entry, &current_len, p_wyini_buffer); /* Fetched after the realloc above as it may point into m_edit_buffer. */
+    char *restrict out = p_wyini_buffer->m_edit_buffer + p_wyini_buffer->m_edit_len;
+    memcpy(out, current, p_keep_len);
+    memcpy(out + p_keep_len, p_val, p_val_len);
+    WYINI_STATS_ADD(m_copy_bytes, new_len);
+    entry->m_edit_offset = p_wyini_buffer->m_edit_len;
+    entry->m_edit_len = new_len;
+    p_wyini_buffer->m_edit_len += new_len;
+    if(old_offset == WYINI_INDEX_NONE)
+        ++p_wyini_buffer->m_edit_count;
+
+    /* A value with '\n' splits the line and a value ending with '\r' can join the nextline indicator. A line starting with '[' may become or stop being a section header. These change the lines of the buffer, so flatten it now to index the lines again. */
+    if((memchr(out, '\n', new_len) != NULL) || ((new_len > 0) && (out[new_len-1] == '\r')) || (p_wyini_buffer->m_buffer[entry->m_var_offset] == '[')) {
+        if((return_val = wyini_edit_flatten(p_wyini_buffer)) != WYINI_OK) { /* Undo the write. The value appended above is simply left unused. */
+            entry->m_edit_offset = old_offset;
+            entry->m_edit_len = old_len;
+            p_wyini_buffer->m_edit_len -= new_len;
+            if(old_offset == WYINI_INDEX_NONE)
+                --p_wyini_buffer->m_edit_count;
+            return return_val;
+        }
+    }
+    else if(p_wyini_buffer->m_edit_len > p_wyini_buffer->m_buffer_len + WYINI_EDIT_MIN_SIZE) /* Mostly overwritten values by now. Flatten to release them. If this fails the write still stands. */
+        wyini_edit_flatten(p_wyini_buffer);
+    return WYINI_OK;
+}
+
+
+
+unsigned int wyini_edit_segments(struct S_wyini_segment *restrict p_segments, const struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    const struct S_wyini_index *restrict index = &(p_wyini_buffer->m_index);
+    unsigned int copied = 0;
+    unsigned int count = 0;
+
+    for(unsigned int i=0; (i<index->m_count) && (p_wyini_buffer->m_edit_count > 0); ++i) {
+        const struct S_wyini_index_entry *restrict entry = index->m_entries + i;
+        if(entry->m_edit_offset == WYINI_INDEX_NONE)
+            continue;
+        if(entry->m_val_offset > copied) { /* Unchanged content before the written value. */
+            p_segments[count].m_ptr = p_wyini_buffer->m_buffer + copied;
+            p_segments[count++].m_len = entry->m_val_offset - copied;
+        }
+        if(entry->m_edit_len > 0) {
+            p_segments[count].m_ptr = p_wyini_buffer->m_edit_buffer + entry->m_edit_offset;
+            p_segments[count++].m_len = entry->m_edit_len;
+        }
+        copied = entry->m_val_end + 1;
+    }
+    if(p_wyini_buffer->m_buffer_len > copied) {
+        p_segments[count].m_ptr = p_wyini_buffer->m_buffer + copied;
+        p_segments[count++].m_len = p_wyini_buffer->m_buffer_len - copied;
+    }
+    return count;
+}
+
+
+
+/**
+ * Appends bytes to the content being put together by wyini_edit_join(), or only counts them if there is no output.
+ */
+static void wyini_edit_put(char *restrict p_out, size_t *restrict p_len, const char *restrict const p_src, const size_t p_src_len)
+{
+    if((p_out != NULL) && (p_src_len > 0))
+        memcpy(p_out + *p_len, p_src, p_src_len);
+    *p_len += p_src_len;
+}
+
+
+
+/**
+ * Puts the current content together in one piece, with the written values in place and a list of splices applied.
+ * @param p_splices The splices, in increasing order of m_offset and not overlapping. May be NULL if p_count is 0.
+ * @param p_count Number of splices.
+ * @param p_out Receives the content. NULL to only work out its length.
+ * @param p_wyini_buffer The S_wyini_buffer holding the content.
+ * @return Length of the content.
+ */
+static size_t wyini_edit_join(const struct S_wyini_splice *restrict p_splices, const unsigned int p_count, char *restrict p_out, const struct S_wyini_buffer *restrict p_wyini_buffer)
 {
-    char *restrict buffer = p_wyini_buffer->m_buffer;
-    while((buffer[p_end_offset] == ' ') && (p_end_offset > p_start_offset))
-        --p_end_offset;
-    return p_end_offset;
+    const struct S_wyini_index *restrict index = &(p_wyini_buffer->m_index);
+    size_t len = 0;
+    unsigned int copied = 0;
+    unsigned int entry = 0;
+
+    for(unsigned int i=0; i<=p_count; ++i) {
+        const unsigned int end = (i < p_count) ? p_splices[i].m_offset : p_wyini_buffer->m_buffer_len;
+        for(; (entry < index->m_count) && (index->m_entries[entry].m_val_offset < end) && (p_wyini_buffer->m_edit_count > 0); ++entry) { /* Copy the unchanged content between the written values. Lines removed by the previous splice lie before copied and are skipped. */
+            const struct S_wyini_index_entry *restrict written = index->m_entries + entry;
+            if((written->m_edit_offset == WYINI_INDEX_NONE) || (written->m_val_offset < copied))
+                continue;
+            wyini_edit_put(p_out, &len, p_wyini_buffer->m_buffer + copied, written->m_val_offset - copied);
+            wyini_edit_put(p_out, &len, p_wyini_buffer->m_edit_buffer + written->m_edit_offset, written->m_edit_len);
+            copied = written->m_val_end + 1;
+        }
+        wyini_edit_put(p_out, &len, p_wyini_buffer->m_buffer + copied, end - copied);
+        if(i < p_count) {
+            wyini_edit_put(p_out, &len, p_splices[i].m_insert, p_splices[i].m_insert_len);
+            copied = end + p_splices[i].m_remove_len;
+        }
+    }
+    return len;
 }
 
 
 
-int wyini_write_val_inline(const unsigned int p_start_offset, const unsigned int p_end_offset, const unsigned int p_val_len, const char *restrict const p_val, struct S_wyini_buffer *restrict p_wyini_buffer)
+/**
+ * Marks the blocks of m_buffer that the written values are about to be put into as dirty. If the layout of the content changes instead, i.e. a written value has a different length than the one it replaces or lines are spliced, the whole file is marked dirty.
+ * @param p_count Number of splices about to be applied.
+ * @param p_wyini_buffer The S_wyini_buffer about to be rebuilt.
+ */
+static void wyini_edit_mark_dirty(const unsigned int p_count, struct S_wyini_buffer *restrict p_wyini_buffer)
 {
-    const unsigned int current_space = p_end_offset - p_start_offset + 1; /* How much space between '=' and the nextline/endline indicator. */
-    char *restrict buffer = p_wyini_buffer->m_buffer;
-    
-    if(current_space >= p_val_len) { /* Enough space to fit in the new variable. */ 
-        if(current_space > p_val_len) {
-            memmove(buffer + p_start_offset + p_val_len, buffer + p_end_offset + 1, p_wyini_buffer->m_buffer_len - p_end_offset); /* Move existing content in m_buffer to fill in the space. No need for this step if current_space == p_val_len. */
-            p_wyini_buffer->m_buffer_len -= (current_space - p_val_len); /* Current buffer size decreased. Update it. */ 
+    const struct S_wyini_index *restrict index = &(p_wyini_buffer->m_index);
+    unsigned int i;
+
+    if((p_wyini_buffer->m_file == NULL) || p_wyini_buffer->m_dirty_all) /* Nothing to patch, or the whole file is written anyway. */
+        return;
+    if(p_count > 0) {
+        p_wyini_buffer->m_dirty_all = true;
+        return;
+    }
+    for(i=0; (i<index->m_count) && (p_wyini_buffer->m_edit_count > 0); ++i) {
+        const struct S_wyini_index_entry *restrict entry = index->m_entries + i;
+        if((entry->m_edit_offset != WYINI_INDEX_NONE) && (entry->m_edit_len != entry->m_val_end + 1 - entry->m_val_offset)) { /* Everything after this value moves. */
+            p_wyini_buffer->m_dirty_all = true;
+            return;
         }
-        memcpy(buffer + p_start_offset, p_val, p_val_len); /* Write the new variable. */
     }
 
-    else { /* Not enough space to fit in the new variable. Additional checks to conduct. */
-        const unsigned int additional_space = p_val_len - current_space;
-        if(additional_space + p_wyini_buffer->m_buffer_len >= p_wyini_buffer->m_max_file_size) /* Writing the new var exceeds max allowed file content size. Return failure. */
+    const unsigned int dirty_size = (p_wyini_buffer->m_buffer_len/WYINI_DIRTY_BLOCK + 8) / 8; /* One bit for each block, including a partial last one. */
+    if(dirty_size > p_wyini_buffer->m_dirty_size) {
+        unsigned char *tmp = (unsigned char*)wyini_mem_realloc(&(p_wyini_buffer->m_allocator), p_wyini_buffer->m_dirty, p_wyini_buffer->m_dirty_size, dirty_size);
+        if(tmp == NULL) { /* Cannot track the blocks, so write the whole file. */
+            p_wyini_buffer->m_dirty_all = true;
+            return;
+        }
+        memset(tmp + p_wyini_buffer->m_dirty_size, 0, dirty_size - p_wyini_buffer->m_dirty_size);
+        p_wyini_buffer->m_dirty = tmp;
+        p_wyini_buffer->m_dirty_size = dirty_size;
+    }
+    for(i=0; (i<index->m_count) && (p_wyini_buffer->m_edit_count > 0); ++i) {
+        const struct S_wyini_index_entry *restrict entry = index->m_entries + i;
+        if((entry->m_edit_offset == WYINI_INDEX_NONE) || (entry->m_edit_len == 0) || (memcmp(p_wyini_buffer->m_edit_buffer + entry->m_edit_offset, p_wyini_buffer->m_buffer + entry->m_val_offset, entry->m_edit_len) == 0)) /* Values written back unchanged need not be saved. */
+            continue;
+        for(unsigned int block=entry->m_val_offset/WYINI_DIRTY_BLOCK; block<=entry->m_val_end/WYINI_DIRTY_BLOCK; ++block)
+            p_wyini_buffer->m_dirty[block/8] |= (unsigned char)(1u << (block%8));
+    }
+}
+
+
+
+/**
+ * Rebuilds m_buffer with all written values in place and a list of splices applied, and indexes it again.
+ * @param p_splices The splices, as for wyini_edit_join().
+ * @param p_count Number of splices. If 0 only the written values are put in place.
+ * @param p_wyini_buffer The S_wyini_buffer to rebuild.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h, in which case the S_wyini_buffer is unchanged.
+ */
+static int wyini_edit_rebuild(const struct S_wyini_splice *restrict p_splices, const unsigned int p_count, struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    struct S_wyini_buffer flat = *p_wyini_buffer; /* The new buffer and its index are built on the side, so that nothing changes if this fails. */
+    const size_t len = wyini_edit_join(p_splices, p_count, NULL, p_wyini_buffer);
+
+    if(len > UINT_MAX)
+        return WYINI_MEMORY_ERR;
+    wyini_edit_mark_dirty(p_count, p_wyini_buffer); /* If the rebuild fails, the values stay written and are marked again by the next one. */
+    flat.m_buffer_len = (unsigned int)len;
+    flat.m_buffer_size = (len > 0) ? flat.m_buffer_len : 1; /* Removing every line leaves no content, but the buffer is still allocated. */
+    if((flat.m_buffer = (char*)wyini_mem_alloc(&(flat.m_allocator), flat.m_buffer_size)) == NULL)
+        return WYINI_MEMORY_ERR;
+    wyini_edit_join(p_splices, p_count, flat.m_buffer, p_wyini_buffer);
+    WYINI_STATS_ADD(m_copy_bytes, flat.m_buffer_len);
+
+    if((p_wyini_buffer->m_edit_count > 0) || (p_count > 0)) { /* Offsets have moved, so index the new buffer. */
+        wyini_index_init(&(flat.m_index));
+        if(wyini_index_build(&flat) != WYINI_OK) {
+            wyini_mem_free(&(flat.m_allocator), flat.m_buffer, flat.m_buffer_size);
             return WYINI_MEMORY_ERR;
+        }
+        wyini_index_clean(&(p_wyini_buffer->m_index), &(p_wyini_buffer->m_allocator));
+        p_wyini_buffer->m_index = flat.m_index;
+        if(p_count > 0) /* Lines were inserted or removed, so entries no longer line up with the cache. */
+            wyini_typed_clean(p_wyini_buffer);
+        else
+            wyini_typed_reindexed(p_wyini_buffer);
+    }
+
+    if(p_wyini_buffer->m_buffer_mode == WYINI_MODE_MMAP)
+        wyini_unmap_file(p_wyini_buffer->m_map_len, p_wyini_buffer->m_buffer);
+    else
+        wyini_mem_free(&(p_wyini_buffer->m_allocator), p_wyini_buffer->m_buffer, p_wyini_buffer->m_buffer_size);
+    p_wyini_buffer->m_buffer = flat.m_buffer;
+    p_wyini_buffer->m_buffer_len = flat.m_buffer_len;
+    p_wyini_buffer->m_buffer_size = flat.m_buffer_size;
+    p_wyini_buffer->m_buffer_mode = WYINI_MODE_READ;
+    p_wyini_buffer->m_map_len = 0;
+    p_wyini_buffer->m_edit_len = 0; /* Keep m_edit_buffer allocated for later writes. */
+    p_wyini_buffer->m_edit_count = 0;
+    return WYINI_OK;
+}
+
+
+
+/**
+ * Flattens an allocated m_buffer by copying the written values over the ones they replace, if every written value has the same length as the one it replaces and leaves the lines as they are. Offsets then stay the same, so the index is kept and only the written bytes are copied.
+ * @param p_wyini_buffer The S_wyini_buffer to flatten. Must be in WYINI_MODE_READ.
+ * @return True if the values were put in place. False if a value changed length or may change the lines, as described in wyini_edit_write(), in which case nothing is changed.
+ */
+static bool wyini_edit_flatten_in_place(struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    struct S_wyini_index *restrict index = &(p_wyini_buffer->m_index);
+    unsigned int i;
+
+    for(i=0; (i<index->m_count) && (p_wyini_buffer->m_edit_count > 0); ++i) {
+        const struct S_wyini_index_entry *restrict entry = index->m_entries + i;
+        if(entry->m_edit_offset == WYINI_INDEX_NONE)
+            continue;
+        const char *restrict val = p_wyini_buffer->m_edit_buffer + entry->m_edit_offset;
+        if((entry->m_edit_len != entry->m_val_end + 1 - entry->m_val_offset) || (memchr(val, '\n', entry->m_edit_len) != NULL) || ((entry->m_edit_len > 0) && (val[entry->m_edit_len-1] == '\r')) || (p_wyini_buffer->m_buffer[entry->m_var_offset] == '['))
+            return false;
+    }
 
-        memmove(buffer + p_start_offset + p_val_len, buffer + p_end_offset + 1, p_wyini_buffer->m_buffer_len - p_end_offset); /* Move existing content in m_buffer to make space. */
-        memcpy(buffer + p_start_offset, p_val, p_val_len); /* Write the new variable. */
-        p_wyini_buffer->m_buffer_len += additional_space;
+    wyini_edit_mark_dirty(0, p_wyini_buffer);
+    for(i=0; (i<index->m_count) && (p_wyini_buffer->m_edit_count > 0); ++i) {
+        struct S_wyini_index_entry *restrict entry = index->m_entries + i;
+        if(entry->m_edit_offset == WYINI_INDEX_NONE)
+            continue;
+        memcpy(p_wyini_buffer->m_buffer + entry->m_val_offset, p_wyini_buffer->m_edit_buffer + entry->m_edit_offset, entry->m_edit_len);
+        WYINI_STATS_ADD(m_copy_bytes, entry->m_edit_len);
+        entry->m_edit_offset = WYINI_INDEX_NONE;
+        entry->m_edit_len = 0;
+        --p_wyini_buffer->m_edit_count;
+    }
+    p_wyini_buffer->m_edit_len = 0;
+    return true;
+}
+
+
+
+int wyini_edit_flatten(struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    if((p_wyini_buffer->m_edit_count == 0) && (p_wyini_buffer->m_buffer_mode != WYINI_MODE_MMAP))
+        return WYINI_OK;
+    if((p_wyini_buffer->m_buffer_mode == WYINI_MODE_READ) && wyini_edit_flatten_in_place(p_wyini_buffer))
+        return WYINI_OK;
+    return wyini_edit_rebuild(NULL, 0, p_wyini_buffer);
+}
+
+
+
+int wyini_edit_splice(const struct S_wyini_splice *restrict p_splices, const unsigned int p_count, struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    const unsigned int old_len = p_wyini_buffer->m_buffer_len;
+    size_t append_len = 0;
+    unsigned int i;
+
+    for(i=0; (i<p_count) && (p_splices[i].m_offset == old_len) && (p_splices[i].m_remove_len == 0); ++i)
+        append_len += p_splices[i].m_insert_len;
+    /* Lines appended after a nextline leave every offset before them in place, as well as the written values. Anything else is put together in a new buffer. */
+    if((i < p_count) || (p_wyini_buffer->m_buffer_mode != WYINI_MODE_READ) || (old_len == 0) || ((p_wyini_buffer->m_buffer[old_len-1] != '\n') && (p_wyini_buffer->m_buffer[old_len-1] != '\0')))
+        return wyini_edit_rebuild(p_splices, p_count, p_wyini_buffer);
+    if(append_len > UINT_MAX - old_len)
+        return WYINI_MEMORY_ERR;
+
+    const unsigned int new_len = old_len + (unsigned int)append_len;
+    p_wyini_buffer->m_dirty_all = true; /* The file grows, so it is written whole. */
+    if(new_len > p_wyini_buffer->m_buffer_size) { /* Out of space. Grow m_buffer geometrically, so that appending line by line copies the content a bounded number of times. */
+        unsigned int new_size = (p_wyini_buffer->m_buffer_size > UINT_MAX/2) ? UINT_MAX : p_wyini_buffer->m_buffer_size*2;
+        if(new_size < new_len)
+            new_size = new_len;
+        char *tmp = (char*)wyini_mem_realloc(&(p_wyini_buffer->m_allocator), p_wyini_buffer->m_buffer, p_wyini_buffer->m_buffer_size, new_size);
+        if(tmp == NULL)
+            return WYINI_MEMORY_ERR;
+        p_wyini_buffer->m_buffer = tmp;
+        p_wyini_buffer->m_buffer_size = new_size;
     }
 
+    char *restrict out = p_wyini_buffer->m_buffer + old_len;
+    for(i=0; i<p_count; ++i) {
+        memcpy(out, p_splices[i].m_insert, p_splices[i].m_insert_len);
+        out += p_splices[i].m_insert_len;
+    }
+    WYINI_STATS_ADD(m_copy_bytes, append_len);
+    p_wyini_buffer->m_buffer_len = new_len;
+    if(wyini_index_append(old_len, p_wyini_buffer) != WYINI_OK) { /* The grown buffer is kept for the next try. */
+        p_wyini_buffer->m_buffer_len = old_len;
+        return WYINI_MEMORY_ERR;
+    }
+    wyini_typed_appended(p_wyini_buffer);
     return WYINI_OK;
+}
+
+
+
+
+void wyini_edit_track(const char *restrict const p_file, const struct S_wyini_file_id *restrict p_id, struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    if((p_wyini_buffer->m_file != NULL) && ((p_file == NULL) || (strcmp(p_wyini_buffer->m_file, p_file) != 0))) {
+        wyini_mem_free(&(p_wyini_buffer->m_allocator), p_wyini_buffer->m_file, strlen(p_wyini_buffer->m_file) + 1);
+        p_wyini_buffer->m_file = NULL;
+    }
+    if((p_file != NULL) && (p_wyini_buffer->m_file == NULL)) {
+        const size_t file_len = strlen(p_file) + 1;
+        if((p_wyini_buffer->m_file = (char*)wyini_mem_alloc(&(p_wyini_buffer->m_allocator), file_len)) != NULL) /* If this fails the file is simply not tracked, and the next save writes it whole. */
+            memcpy(p_wyini_buffer->m_file, p_file, file_len);
+    }
+    if(p_wyini_buffer->m_file != NULL)
+        p_wyini_buffer->m_file_id = *p_id;
+    if(p_wyini_buffer->m_dirty != NULL)
+        memset(p_wyini_buffer->m_dirty, 0, p_wyini_buffer->m_dirty_size);
+    p_wyini_buffer->m_dirty_all = false;
+}
+
+
+
+int wyini_edit_patch(const char *restrict const p_file, unsigned int *restrict p_written, struct S_wyini_buffer *restrict p_wyini_buffer)
+{
+    struct S_wyini_segment *restrict segments = NULL;
+    struct S_wyini_file_id new_id;
+    unsigned int count = 0;
+    unsigned int written = 0;
+    int return_val;
+
+    if((p_wyini_buffer->m_file == NULL) || p_wyini_buffer->m_dirty_all || (p_wyini_buffer->m_edit_count > 0) || (p_wyini_buffer->m_buffer_mode != WYINI_MODE_READ) || ((uint64_t)p_wyini_buffer->m_buffer_len != p_wyini_buffer->m_file_id.m_size) || (strcmp(p_wyini_buffer->m_file, p_file) != 0))
+        return WYINI_NOT_FOUND;
+
+    unsigned int blocks = (p_wyini_buffer->m_buffer_len + WYINI_DIRTY_BLOCK - 1) / WYINI_DIRTY_BLOCK;
+    if(blocks > p_wyini_buffer->m_dirty_size*8) /* m_dirty only grows when blocks are marked, so it may be shorter than the content, e.g. after the content grew. The blocks past it are clean. */
+        blocks = p_wyini_buffer->m_dirty_size*8;
+    if((blocks > 0) && ((segments = (struct S_wyini_segment*)malloc((blocks/2 + 1) * sizeof(struct S_wyini_segment))) == NULL)) /* Runs of dirty blocks are separated by clean ones, so there are at most this many. */
+        return WYINI_MEMORY_ERR;
+    for(unsigned int block=0; block<blocks; ) { /* Write each run of dirty blocks as one segment. */
+        if((p_wyini_buffer->m_dirty[block/8] & (1u << (block%8))) == 0) {
+            ++block;
+            continue;
+        }
+        const unsigned int start = block*WYINI_DIRTY_BLOCK;
+        while((block < blocks) && ((p_wyini_buffer->m_dirty[block/8] & (1u << (block%8))) != 0))
+            ++block;
+        const unsigned int end = ((size_t)block*WYINI_DIRTY_BLOCK < p_wyini_buffer->m_buffer_len) ? block*WYINI_DIRTY_BLOCK : p_wyini_buffer->m_buffer_len;
+        segments[count].m_ptr = p_wyini_buffer->m_buffer + start;
+        segments[count++].m_len = end - start;
+        written += end - start;
+    }
+
+    if((return_val = wyini_patch_file(p_file, &(p_wyini_buffer->m_file_id), p_wyini_buffer->m_buffer, segments, count, &new_id)) == WYINI_OK) {
+        wyini_edit_track(p_file, &new_id, p_wyini_buffer);
+        *p_written = written;
+    }
+    free(segments);
+    return return_val;
 }
\ No newline at end of file
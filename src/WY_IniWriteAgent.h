@@ -1,32 +1,133 @@
 /**
  * @file WY_IniWriteAgent.h
  * Declares functions for performing write operations.
+ * \n
+ * Writes never modify m_buffer. The new value of a line is appended to m_edit_buffer and the line's index entry is pointed at it, so a write costs the length of the value no matter how large the content is, and there is no capacity to run out of. m_buffer is only rebuilt with all the written values in place, i.e. flattened, when the lines themselves change, when the file is saved, or when overwritten values have taken up more space than the content itself.
+ * \n
+ * Lines are inserted and removed by splicing. Lines inserted at the end of the content are appended to m_buffer in place, which grows geometrically, and only the new lines are indexed. Any other splice rebuilds m_buffer like a flatten, so a batch of lines for the same place should be passed as one splice.
+ * \n
+ * If every written value kept its length, an allocated m_buffer is flattened in place by copying the values over the old ones, keeping the index. Flattening also records which blocks of m_buffer changed since the file was read or saved, so that saving back to the same file only overwrites those blocks in place. Once the layout changes the whole file is written again.
 */
 
 #ifndef _WY_INIWRITEAGENT_H_
 #define _WY_INIWRITEAGENT_H_
 
+#include <stdbool.h>
 #include "WY_IniDefs.h"
+#include "WY_IniIO.h"
 
 /**
- * Removes trailing whitespace from the variable value within a start and end index within the provided S_wyini_buffer.
- * @param p_start_offset The starting index in S_wyini_buffer pointing to a variable.
- * @param p_end_offset The ending index in S_wyini_buffer that points to a variable.
- * @param p_wyini_buffer The S_wyini_buffer to operate on.
- * @return A new p_end_offset that excludes any trailing whitespace originally found before p_end_offset.
+ * A change to the lines of m_buffer, applied by wyini_edit_splice(). Lines are removed and inserted whole, so m_offset is always the start of a line or m_buffer_len.
  */
-unsigned int wyini_remove_ending_whitespace(const unsigned int p_start_offset, unsigned int p_end_offset, struct S_wyini_buffer *restrict p_wyini_buffer);
+struct S_wyini_splice
+{
+    unsigned int m_offset; /**< Offset in m_buffer where the change starts. */
+    unsigned int m_remove_len; /**< Number of bytes of m_buffer removed from m_offset, i.e. whole lines including their nextline indicators. */
+    const char *m_insert; /**< Lines inserted at m_offset in place of the removed bytes. Each ends with a nextline indicator, except perhaps at the end of the content. */
+    unsigned int m_insert_len; /**< Length of m_insert. May be 0. */
+};
+
+/**
+ * Removes trailing whitespace from a value.
+ * @param p_val The value. The first char is always kept.
+ * @param p_val_len Length of the value.
+ * @return The length of the value excluding any trailing whitespace.
+ */
+unsigned int wyini_remove_ending_whitespace(const char *restrict const p_val, unsigned int p_val_len);
+
+
+/**
+ * Initialises the write state of an S_wyini_buffer to empty. Does not allocate memory.
+ * @param p_wyini_buffer The S_wyini_buffer to initialise.
+ */
+void wyini_edit_init(struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Frees the values held for written lines and resets the write state to empty. The index entries are not touched.
+ * @param p_wyini_buffer The S_wyini_buffer to clean.
+ */
+void wyini_edit_clean(struct S_wyini_buffer *restrict p_wyini_buffer);
 
 
 /**
- * Writes a value into a specified offset into a line within the internal buffer S_wyini_buffer.
- * @param p_start_offset Index position in S_wyini_buffer pointing at the position before the 'var=' pattern.
- * @param p_end_offset Index position in S_wyini_buffer pointing at the byte before nextline or terminating indicator after the 'var=val' pattern.
+ * Gets the current value of a line, i.e. everything between the first '=' and the nextline or terminating indicator, including any whitespace.
+ * @param p_entry Index into m_index.m_entries of the line.
+ * @param p_val_len Returns the length of the value. May be 0.
+ * @param p_wyini_buffer The S_wyini_buffer holding the line.
+ * @return Pointer to the value, either in m_buffer or in m_edit_buffer. Valid until the next write.
+ */
+const char * wyini_edit_get_val(const unsigned int p_entry, unsigned int *restrict p_val_len, const struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Finds the value assigned to a variable in the current content of a line. Works like wyini_find_var_val_inline() but takes values written to the line into account.
+ * @param p_var_only If true, only the 'var=' pattern is searched for and p_return_offset is the offset after 'var='. If false, the pattern 'var=val' is searched for and p_return_offset is the offset of 'val'.
+ * @param p_entry Index into m_index.m_entries of the line.
+ * @param p_var_len The length of the variable to match.
+ * @param p_var The variable to match.
+ * @param p_return_offset Returns the offset selected by p_var_only, relative to the value returned by wyini_edit_get_val().
+ * @param p_wyini_buffer The S_wyini_buffer holding the line.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h. WYINI_VAL_NOT_FOUND if the variable is found but nothing follows it.
+ */
+int wyini_edit_find_var_val(const bool p_var_only, const unsigned int p_entry, const unsigned int p_var_len, const char *restrict const p_var, unsigned int *restrict p_return_offset, const struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Writes a value into a line. The current value of the line is replaced from p_keep_len onwards.
+ * @param p_entry Index into m_index.m_entries of the line.
+ * @param p_keep_len Number of bytes at the start of the current value to keep.
  * @param p_val_len Length of the value to write.
  * @param p_val The value to write.
- * @param p_wyini_buffer The S_wyini_buffer to operate on.
- * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h.
-*/
-int wyini_write_val_inline(const unsigned int p_start_offset, const unsigned int p_end_offset, const unsigned int p_val_len, const char *restrict const p_val, struct S_wyini_buffer *restrict p_wyini_buffer);
+ * @param p_wyini_buffer The S_wyini_buffer to write to. Index entries may be moved, so pointers to them must be fetched again afterwards.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h, in which case the content is unchanged.
+ */
+int wyini_edit_write(const unsigned int p_entry, const unsigned int p_keep_len, const unsigned int p_val_len, const char *restrict const p_val, struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Describes the current content as a list of segments, without copying or flattening it. Unchanged content is taken from m_buffer and written values from m_edit_buffer.
+ * @param p_segments Returns the segments in file order. Must have room for 2*m_edit_count+1 segments. Empty segments are left out.
+ * @param p_wyini_buffer The S_wyini_buffer to describe.
+ * @return Number of segments returned.
+ */
+unsigned int wyini_edit_segments(struct S_wyini_segment *restrict p_segments, const struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Rebuilds m_buffer with all written values in place and indexes it again. If m_buffer is allocated and every written value kept its length without changing the lines, the values are copied over the old ones instead and the index is kept. A mapped m_buffer is replaced by an allocated copy even if nothing was written, since the mapped file may be about to be overwritten. Does nothing otherwise if nothing was written.
+ * @param p_wyini_buffer The S_wyini_buffer to flatten.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h, in which case the S_wyini_buffer is unchanged.
+ */
+int wyini_edit_flatten(struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Inserts and removes whole lines. If every splice inserts at m_buffer_len and the content ends with a nextline indicator, the lines are appended to m_buffer in place and indexed with wyini_index_append(), keeping the written values and the typed cache. Otherwise m_buffer is rebuilt with the written values in place and the splices applied, and indexed again. Written values of removed lines are dropped with them.
+ * @param p_splices The splices, in increasing order of m_offset and not overlapping.
+ * @param p_count Number of splices.
+ * @param p_wyini_buffer The S_wyini_buffer to change. Must not be in WYINI_MODE_COMPILED.
+ * @return WYINI_OK if success. Else a negative value defined in WY_IniDefs.h, in which case the content is unchanged.
+ */
+int wyini_edit_splice(const struct S_wyini_splice *restrict p_splices, const unsigned int p_count, struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Records that m_buffer, with the written values left out, now matches a file, i.e. after the file was read or saved whole. Clears the dirty blocks.
+ * @param p_file The file. NULL to track no file, so that the next save writes the file whole.
+ * @param p_id Identity of the version of the file that m_buffer matches. Not used if p_file is NULL.
+ * @param p_wyini_buffer The S_wyini_buffer that matches the file.
+ */
+void wyini_edit_track(const char *restrict const p_file, const struct S_wyini_file_id *restrict p_id, struct S_wyini_buffer *restrict p_wyini_buffer);
+
+
+/**
+ * Saves a flattened m_buffer by overwriting only its dirty blocks in the file, with wyini_patch_file(). This is only possible if p_file is the tracked file, nobody else changed it since, and the layout of the content is unchanged.
+ * @param p_file The file name.
+ * @param p_written Returns the number of bytes written, which is 0 if nothing changed.
+ * @param p_wyini_buffer The S_wyini_buffer to save. Must be flattened.
+ * @return WYINI_OK if success, in which case the new version of the file is tracked. Else a negative value defined in WY_IniDefs.h, and the file must be written whole. WYINI_NOT_FOUND if the file cannot be patched.
+ */
+int wyini_edit_patch(const char *restrict const p_file, unsigned int *restrict p_written, struct S_wyini_buffer *restrict p_wyini_buffer);
 
 #endif
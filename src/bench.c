@@ -0,0 +1,462 @@
+/**
+ * @file bench.c
+ * Benchmark application for the WY_IniMgr library. Generates a synthetic INI file, times the main API functions on it and prints one JSON object per line for each operation measured.
+ * \n
+ * Parameters are passed as name=value pairs. All are optional:
+ * - keys=N Number of 'var=val' lines to generate. Default 10000.
+ * - val_len=N Length of each value. Default 32.
+ * - crlf=0|1 Use Windows-style '\r\n' nextline indicators. Default 0.
+ * - pad=N Number of spaces written around each '=' and after each value. Default 1.
+ * - ops=N Number of lookups or writes timed for each lookup or write operation. Default 100000.
+ * - reps=N Number of times each open and save operation is repeated. Default 20.
+ * - file=NAME Name of the generated file. It is removed when the benchmark ends, along with the image compiled from it as NAME.bin. Default bench_data.ini.
+ *
+ * Example: `./bench keys=100000 val_len=64 crlf=1`
+*/
+#if !defined _OS_WINDOWS_
+#define _POSIX_C_SOURCE 200809L /* Exposes getrusage() and getpid() under -std=c17. */
+#endif
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#if !defined _OS_WINDOWS_
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#include "WY_IniDefs.h"
+#include "WY_IniMgr.h"
+
+
+#define BENCH_BATCH 32 /**< Number of variables per wyini_get_many_h() call. */
+#define BENCH_TYPED_KEYS 64 /**< Number of variables polled as integers. */
+
+
+/**
+ * Benchmark parameters.
+ */
+struct S_bench_config
+{
+    unsigned int m_keys; /**< Number of 'var=val' lines. */
+    unsigned int m_val_len; /**< Length of each value. */
+    unsigned int m_crlf; /**< 1 for '\r\n', 0 for '\n'. */
+    unsigned int m_pad; /**< Spaces around '=' and after each value. */
+    unsigned int m_ops; /**< Number of lookups or writes timed per operation. */
+    unsigned int m_reps; /**< Number of repetitions of each open and save. */
+    const char *m_file; /**< Name of the generated file. */
+};
+
+
+/**
+ * Returns a wall-clock timestamp in nanoseconds. timespec_get() is used as it is available on every C11 system.
+ */
+static double bench_now_ns()
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec*1e9 + (double)ts.tv_nsec;
+}
+
+
+/**
+ * Returns the peak resident set size of the process in kB, or 0 if it is not available on this system.
+ */
+static long bench_peak_rss_kb()
+{
+#if !defined _OS_WINDOWS_
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0)
+        return usage.ru_maxrss;
+#endif
+    return 0;
+}
+
+
+/**
+ * Returns a pseudo-random number. A fixed generator keeps runs comparable between builds.
+ */
+static unsigned int bench_rand(unsigned int *restrict p_state)
+{
+    *p_state = *p_state*1103515245u + 12345u;
+    return *p_state >> 8;
+}
+
+
+/**
+ * Prints one result line.
+ * @param p_op Name of the operation.
+ * @param p_count Number of operations timed.
+ * @param p_bytes Number of bytes processed by all operations, or 0 if a throughput does not apply.
+ * @param p_elapsed_ns Total time taken.
+ */
+static void bench_report(const char *restrict const p_op, const unsigned int p_count, const double p_bytes, const double p_elapsed_ns)
+{
+    printf("{\"op\":\"%s\",\"count\":%u,\"ns_per_op\":%.1f,\"mb_per_s\":%.1f,\"peak_rss_kb\":%ld}\n",
+        p_op, p_count, p_elapsed_ns/p_count, (p_bytes > 0) ? (p_bytes/(1024.0*1024.0))/(p_elapsed_ns/1e9) : 0.0, bench_peak_rss_kb());
+}
+
+
+/**
+ * Writes the synthetic INI file. Lines have the form 'KEY_n = vvv...'.
+ * @param p_config Benchmark parameters.
+ * @return Size of the file written. 0 if the file cannot be written.
+ */
+static unsigned int bench_generate(const struct S_bench_config *restrict p_config)
+{
+    FILE *fp;
+    unsigned int size = 0;
+
+    if((fp = fopen(p_config->m_file, "wb")) == NULL)
+        return 0;
+    for(unsigned int i=0; i<p_config->m_keys; ++i) {
+        size += (unsigned int)fprintf(fp, "KEY_%u%*s=%*s", i, (int)p_config->m_pad, "", (int)p_config->m_pad, "");
+        for(unsigned int j=0; j<p_config->m_val_len; ++j)
+            fputc('a' + (int)((i+j)%26), fp);
+        size += p_config->m_val_len;
+        size += (unsigned int)fprintf(fp, "%*s%s", (int)p_config->m_pad, "", p_config->m_crlf ? "\r\n" : "\n");
+    }
+    fclose(fp);
+    return size;
+}
+
+
+/**
+ * Stream callback that counts the lines with a 'var=val' pattern.
+ */
+static int bench_count_vars(const wyini_stream_line *p_line, void *p_user)
+{
+    if(p_line->m_var.m_ptr != NULL)
+        ++*(unsigned int*)p_user;
+    return WYINI_OK;
+}
+
+
+/**
+ * wyini_foreach() callback that counts the variables.
+ */
+static int bench_count_pairs(const wyini_pair *p_pair, void *p_user)
+{
+    (void)p_pair;
+    ++*(unsigned int*)p_user;
+    return WYINI_OK;
+}
+
+
+int main(int argc, char *argv[])
+{
+    struct S_bench_config config = { 10000, 32, 0, 1, 100000, 20, "bench_data.ini" };
+    wyini_handle_t *handle = NULL;
+    wyini_handle_t *loop_handle;
+    wyini_stream_t *stream;
+    FILE *stream_fp;
+    wyini_arena_t *arena = NULL;
+    wyini_allocator allocator;
+    wyini_stats stats;
+    char var[32];
+    char image_file[256];
+    char *val;
+    char *grow_val;
+    char *shrink_val;
+    unsigned int seed = 1;
+    unsigned int found = 0;
+    int mode = WYINI_MODE_READ;
+    double start;
+
+    image_file[0] = 0;
+    for(int i=1; i<argc; ++i) { /* Parse name=value parameters. */
+        const char *eq = strchr(argv[i], '=');
+        if(eq == NULL) {
+            printf("Unknown parameter %s\n", argv[i]);
+            return 1;
+        }
+        const size_t name_len = (size_t)(eq - argv[i]);
+        const unsigned int num = (unsigned int)strtoul(eq + 1, NULL, 10);
+        if((name_len == 4) && (strncmp(argv[i], "keys", 4) == 0)) config.m_keys = num;
+        else if((name_len == 7) && (strncmp(argv[i], "val_len", 7) == 0)) config.m_val_len = num;
+        else if((name_len == 4) && (strncmp(argv[i], "crlf", 4) == 0)) config.m_crlf = num;
+        else if((name_len == 3) && (strncmp(argv[i], "pad", 3) == 0)) config.m_pad = num;
+        else if((name_len == 3) && (strncmp(argv[i], "ops", 3) == 0)) config.m_ops = num;
+        else if((name_len == 4) && (strncmp(argv[i], "reps", 4) == 0)) config.m_reps = num;
+        else if((name_len == 4) && (strncmp(argv[i], "file", 4) == 0)) config.m_file = eq + 1;
+        else {
+            printf("Unknown parameter %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if((config.m_keys == 0) || (config.m_ops == 0) || (config.m_reps == 0)) {
+        printf("keys, ops and reps must be at least 1\n");
+        return 1;
+    }
+
+    const unsigned int file_size = bench_generate(&config);
+    if(file_size == 0) {
+        printf("Cannot write %s\n", config.m_file);
+        return 1;
+    }
+    const unsigned int max_size = file_size*2 + 1024; /* Leave room for the write growth test. */
+    printf("{\"config\":{\"keys\":%u,\"val_len\":%u,\"crlf\":%u,\"pad\":%u,\"ops\":%u,\"reps\":%u,\"file_size\":%u}}\n",
+        config.m_keys, config.m_val_len, config.m_crlf, config.m_pad, config.m_ops, config.m_reps, file_size);
+
+    start = bench_now_ns(); /* wyini_open_h() */
+    for(unsigned int i=0; i<config.m_reps; ++i) {
+        if(wyini_open_h(config.m_file, max_size, &loop_handle) != WYINI_OK)
+            goto bad_exit;
+        wyini_close_h(loop_handle);
+    }
+    bench_report("open", config.m_reps, (double)file_size*config.m_reps, bench_now_ns() - start);
+
+    start = bench_now_ns(); /* wyini_open_mmap_h() */
+    for(unsigned int i=0; i<config.m_reps; ++i) {
+        if(wyini_open_mmap_h(config.m_file, max_size, &mode, &loop_handle) != WYINI_OK)
+            goto bad_exit;
+        wyini_close_h(loop_handle);
+    }
+    bench_report((mode == WYINI_MODE_MMAP) ? "open_mmap" : "open_mmap_fallback", config.m_reps, (double)file_size*config.m_reps, bench_now_ns() - start);
+
+    if(wyini_arena_create(NULL, 4096, &arena) != WYINI_OK) /* Starts small and grows during the first open, which later opens then reuse. */
+        goto bad_exit;
+    wyini_arena_allocator(arena, &allocator);
+    start = bench_now_ns(); /* wyini_open_with_h() on an arena. */
+    for(unsigned int i=0; i<config.m_reps; ++i) {
+        if(wyini_open_with_h(config.m_file, max_size, &allocator, &loop_handle) != WYINI_OK)
+            goto bad_exit;
+        wyini_close_h(loop_handle);
+    }
+    bench_report("open_arena", config.m_reps, (double)file_size*config.m_reps, bench_now_ns() - start);
+    wyini_arena_destroy(arena);
+    arena = NULL;
+
+    snprintf(image_file, sizeof(image_file), "%s.bin", config.m_file); /* wyini_open_compiled_h() on an image compiled from the same file. */
+    if(wyini_compile(config.m_file, max_size, image_file) != WYINI_OK)
+        goto bad_exit;
+    start = bench_now_ns();
+    for(unsigned int i=0; i<config.m_reps; ++i) {
+        if(wyini_open_compiled_h(image_file, 0xFFFFFFFFu, &loop_handle) != WYINI_OK)
+            goto bad_exit;
+        wyini_close_h(loop_handle);
+    }
+    bench_report("open_compiled", config.m_reps, (double)file_size*config.m_reps, bench_now_ns() - start);
+
+    start = bench_now_ns(); /* wyini_stream_read() counting the 'var=val' lines. */
+    for(unsigned int i=0; i<config.m_reps; ++i) {
+        unsigned int var_count = 0;
+        if((stream_fp = fopen(config.m_file, "rb")) == NULL)
+            goto bad_exit;
+        if(wyini_stream_open(bench_count_vars, &var_count, 4096, &stream) != WYINI_OK) {
+            fclose(stream_fp);
+            goto bad_exit;
+        }
+        const int stream_status = wyini_stream_read(stream, stream_fp);
+        wyini_stream_close(stream);
+        fclose(stream_fp);
+        if((stream_status != WYINI_OK) || (var_count != config.m_keys))
+            goto bad_exit;
+    }
+    bench_report("stream", config.m_reps, (double)file_size*config.m_reps, bench_now_ns() - start);
+
+    if(wyini_open_h(config.m_file, max_size, &handle) != WYINI_OK)
+        goto bad_exit;
+
+    start = bench_now_ns(); /* Sequential wyini_get_var_val_h() */
+    for(unsigned int i=0; i<config.m_ops; ++i) {
+        snprintf(var, sizeof(var), "KEY_%u", i % config.m_keys);
+        found += (wyini_get_var_val_h(handle, var, &val) == WYINI_OK);
+    }
+    bench_report("get_sequential", config.m_ops, 0, bench_now_ns() - start);
+
+    start = bench_now_ns(); /* Random wyini_get_var_val_h() */
+    for(unsigned int i=0; i<config.m_ops; ++i) {
+        snprintf(var, sizeof(var), "KEY_%u", bench_rand(&seed) % config.m_keys);
+        found += (wyini_get_var_val_h(handle, var, &val) == WYINI_OK);
+    }
+    bench_report("get_random", config.m_ops, 0, bench_now_ns() - start);
+
+    char batch_vars[BENCH_BATCH][32]; /* wyini_get_many_h() on batches of random variables. */
+    const char *batch[BENCH_BATCH];
+    wyini_view batch_views[BENCH_BATCH];
+    int batch_status[BENCH_BATCH];
+    const unsigned int batches = (config.m_ops + BENCH_BATCH - 1) / BENCH_BATCH;
+    for(unsigned int i=0; i<BENCH_BATCH; ++i)
+        batch[i] = batch_vars[i];
+    start = bench_now_ns();
+    for(unsigned int i=0; i<batches; ++i) {
+        for(unsigned int j=0; j<BENCH_BATCH; ++j)
+            snprintf(batch_vars[j], sizeof(batch_vars[j]), "KEY_%u", bench_rand(&seed) % config.m_keys);
+        found += (wyini_get_many_h(handle, batch, BENCH_BATCH, batch_views, batch_status) == WYINI_OK);
+    }
+    bench_report("get_many", batches*BENCH_BATCH, 0, bench_now_ns() - start);
+
+    start = bench_now_ns(); /* wyini_foreach_h() over every variable. */
+    for(unsigned int i=0; i<config.m_reps; ++i) {
+        unsigned int pair_count = 0;
+        if((wyini_foreach_h(handle, bench_count_pairs, &pair_count) != WYINI_OK) || (pair_count != config.m_keys))
+            goto bad_exit;
+    }
+    bench_report("foreach", config.m_reps, (double)file_size*config.m_reps, bench_now_ns() - start);
+
+    const char *layer_files[2] = { config.m_file, config.m_file }; /* Random wyini_layers_get_var_view() on the file layered over itself. */
+    wyini_layers_t *layers;
+    wyini_view view;
+    if(wyini_layers_open(layer_files, 2, max_size, &layers) != WYINI_OK)
+        goto bad_exit;
+    start = bench_now_ns();
+    for(unsigned int i=0; i<config.m_ops; ++i) {
+        snprintf(var, sizeof(var), "KEY_%u", bench_rand(&seed) % config.m_keys);
+        found += (wyini_layers_get_var_view(layers, var, &view) == WYINI_OK);
+    }
+    bench_report("layers_get", config.m_ops, 0, bench_now_ns() - start);
+    wyini_layers_close(layers);
+
+#if !defined _OS_WINDOWS_
+    char shm_name[64]; /* Random wyini_shm_refresh() and wyini_shm_get_var_view() on the file published in shared memory. */
+    wyini_shm_t *shm;
+    snprintf(shm_name, sizeof(shm_name), "/wyini_bench_%ld", (long)getpid());
+    if(wyini_shm_publish(shm_name, config.m_file, max_size) != WYINI_OK)
+        goto bad_exit;
+    if(wyini_shm_attach(shm_name, 0xFFFFFFFFu, &shm) != WYINI_OK) {
+        wyini_shm_unlink(shm_name);
+        goto bad_exit;
+    }
+    start = bench_now_ns();
+    for(unsigned int i=0; i<config.m_ops; ++i) {
+        snprintf(var, sizeof(var), "KEY_%u", bench_rand(&seed) % config.m_keys);
+        wyini_shm_refresh(shm); /* As a reader would once per request, so the check for a new generation is timed too. */
+        found += (wyini_shm_get_var_view(shm, var, &view) == WYINI_OK);
+    }
+    bench_report("shm_get", config.m_ops, 0, bench_now_ns() - start);
+    wyini_shm_detach(shm);
+    wyini_shm_unlink(shm_name);
+#endif
+
+    const unsigned int typed_keys = (config.m_keys < BENCH_TYPED_KEYS) ? config.m_keys : BENCH_TYPED_KEYS; /* Polling numeric variables, by parsing the copied value and with wyini_get_int64_h(). */
+    int64_t num = 0;
+    for(unsigned int i=0; i<typed_keys; ++i) {
+        snprintf(var, sizeof(var), "KEY_%u", i);
+        if(wyini_set_int64_h(handle, var, (int64_t)i * 1000003) != WYINI_OK)
+            goto bad_exit;
+    }
+    start = bench_now_ns();
+    for(unsigned int i=0; i<config.m_ops; ++i) {
+        snprintf(var, sizeof(var), "KEY_%u", i % typed_keys);
+        if(wyini_get_var_val_h(handle, var, &val) == WYINI_OK)
+            num += strtoll(val, NULL, 10);
+    }
+    bench_report("get_strtoll", config.m_ops, 0, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for(unsigned int i=0; i<config.m_ops; ++i) {
+        int64_t tmp;
+        snprintf(var, sizeof(var), "KEY_%u", i % typed_keys);
+        if(wyini_get_int64_h(handle, var, &tmp) == WYINI_OK)
+            num -= tmp;
+    }
+    bench_report("get_int64", config.m_ops, 0, bench_now_ns() - start);
+    found += (num == 0);
+
+    /* Alternate between a longer and a shorter value so every write resizes the line. Values must stay below WYINI_MAX_VAL_LEN. */
+    const unsigned int grow_len = (config.m_val_len + 8 < WYINI_MAX_VAL_LEN) ? config.m_val_len + 8 : WYINI_MAX_VAL_LEN - 1;
+    const unsigned int shrink_len = (config.m_val_len > 8) ? config.m_val_len - 8 : 1;
+    if(((grow_val = (char*)malloc(grow_len + 1)) == NULL) || ((shrink_val = (char*)malloc(shrink_len + 1)) == NULL))
+        goto bad_exit;
+    memset(grow_val, 'g', grow_len);
+    grow_val[grow_len] = 0;
+    memset(shrink_val, 's', shrink_len);
+    shrink_val[shrink_len] = 0;
+
+    seed = 1;
+    start = bench_now_ns(); /* wyini_write_val_h() growing values */
+    for(unsigned int i=0; i<config.m_ops; ++i) {
+        snprintf(var, sizeof(var), "KEY_%u", bench_rand(&seed) % config.m_keys);
+        found += (wyini_write_val_h(handle, var, grow_val) == WYINI_OK);
+    }
+    bench_report("write_grow", config.m_ops, 0, bench_now_ns() - start);
+
+    seed = 1;
+    start = bench_now_ns(); /* wyini_write_val_h() shrinking values */
+    for(unsigned int i=0; i<config.m_ops; ++i) {
+        snprintf(var, sizeof(var), "KEY_%u", bench_rand(&seed) % config.m_keys);
+        found += (wyini_write_val_h(handle, var, shrink_val) == WYINI_OK);
+    }
+    bench_report("write_shrink", config.m_ops, 0, bench_now_ns() - start);
+    free(grow_val);
+    free(shrink_val);
+
+    start = bench_now_ns(); /* wyini_insert_val_h() appending new variables one by one. */
+    for(unsigned int i=0; i<config.m_ops; ++i) {
+        snprintf(var, sizeof(var), "NEW_%u", i);
+        if(wyini_insert_val_h(handle, var, "1") != WYINI_OK)
+            goto bad_exit;
+    }
+    bench_report("insert", config.m_ops, 0, bench_now_ns() - start);
+
+    char section[32]; /* wyini_insert_many_h() adding new sections of BENCH_BATCH variables each. */
+    start = bench_now_ns();
+    for(unsigned int i=0; i<batches; ++i) {
+        const char *batch_vals[BENCH_BATCH];
+        snprintf(section, sizeof(section), "NEW_SECTION_%u", i);
+        for(unsigned int j=0; j<BENCH_BATCH; ++j) {
+            snprintf(batch_vars[j], sizeof(batch_vars[j]), "KEY_%u", j);
+            batch_vals[j] = "1";
+        }
+        if(wyini_insert_many_h(handle, section, batch, batch_vals, BENCH_BATCH) != WYINI_OK)
+            goto bad_exit;
+    }
+    bench_report("insert_many", batches*BENCH_BATCH, 0, bench_now_ns() - start);
+
+    unsigned long long save_bytes = 0;
+    size_t written;
+    start = bench_now_ns(); /* wyini_save_bytes_h() after a write that changes the length of a value, so the whole file is written. */
+    for(unsigned int i=0; i<config.m_reps; ++i) {
+        if((wyini_write_val_h(handle, "KEY_0", (i % 2 == 0) ? "1" : "22") != WYINI_OK) || (wyini_save_bytes_h(handle, config.m_file, &written) != WYINI_OK))
+            goto bad_exit;
+        save_bytes += written;
+    }
+    const double save_elapsed = bench_now_ns() - start;
+    FILE *fp; /* The writes above changed the size of the content, so measure what was saved. */
+    long save_size = 0;
+    if((fp = fopen(config.m_file, "rb")) != NULL) {
+        if(fseek(fp, 0, SEEK_END) == 0)
+            save_size = ftell(fp);
+        fclose(fp);
+    }
+    bench_report("save", config.m_reps, (double)save_bytes, save_elapsed);
+
+    if((wyini_write_val_h(handle, "KEY_0", "0") != WYINI_OK) || (wyini_save_h(handle, config.m_file) != WYINI_OK)) /* One char from now on, so the writes below keep the length. */
+        goto bad_exit;
+    save_bytes = 0;
+    start = bench_now_ns(); /* wyini_save_bytes_h() after a write that keeps the length of a value, so only the changed block is written. */
+    for(unsigned int i=0; i<config.m_reps; ++i) {
+        if((wyini_write_val_h(handle, "KEY_0", (i % 2 == 0) ? "1" : "0") != WYINI_OK) || (wyini_save_bytes_h(handle, config.m_file, &written) != WYINI_OK))
+            goto bad_exit;
+        save_bytes += written;
+    }
+    bench_report("save_patch", config.m_reps, (double)save_bytes, bench_now_ns() - start);
+
+    start = bench_now_ns(); /* wyini_save_atomic_h() */
+    for(unsigned int i=0; i<config.m_reps; ++i) {
+        if(wyini_save_atomic_h(handle, config.m_file) != WYINI_OK)
+            goto bad_exit;
+    }
+    bench_report("save_atomic", config.m_reps, (double)save_size*config.m_reps, bench_now_ns() - start);
+
+    wyini_close_h(handle);
+    remove(config.m_file);
+    remove(image_file);
+    if(wyini_get_stats(&stats) == WYINI_OK) /* Only when built with WYINI_STATS defined. */
+        printf("{\"stats\":{\"opens\":%llu,\"bytes_read\":%llu,\"bytes_written\":%llu,\"lookups\":%llu,\"hits\":%llu,\"misses\":%llu,\"lines_scanned\":%llu,\"copy_bytes\":%llu,\"reallocs\":%llu,\"read_ms\":%.1f,\"index_ms\":%.1f,\"lookup_ms\":%.1f,\"write_ms\":%.1f,\"save_ms\":%.1f}}\n",
+            (unsigned long long)stats.m_opens, (unsigned long long)stats.m_bytes_read, (unsigned long long)stats.m_bytes_written, (unsigned long long)stats.m_lookups,
+            (unsigned long long)stats.m_hits, (unsigned long long)stats.m_misses, (unsigned long long)stats.m_lines_scanned, (unsigned long long)stats.m_copy_bytes, (unsigned long long)stats.m_reallocs,
+            stats.m_phase_ns[WYINI_PHASE_READ]/1e6, stats.m_phase_ns[WYINI_PHASE_INDEX]/1e6, stats.m_phase_ns[WYINI_PHASE_LOOKUP]/1e6, stats.m_phase_ns[WYINI_PHASE_WRITE]/1e6, stats.m_phase_ns[WYINI_PHASE_SAVE]/1e6);
+    printf("{\"found\":%u}\n", found); /* Keeps the lookups from being optimised away, and shows if any failed. */
+    return 0;
+
+bad_exit:
+    printf("Benchmark failed.\n");
+    wyini_close_h(handle);
+    wyini_arena_destroy(arena);
+    remove(config.m_file);
+    if(image_file[0] != 0)
+        remove(image_file);
+    return 1;
+}
@@ -3,6 +3,7 @@
  * Demo application to demonstrate usage of the WY_IniMgr library. 
 */
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -18,7 +19,8 @@ int main(int argc, char *argv[])
     const char *filename = "filename.txt";
     #endif
     char var[32];
-    char num_val[32];
+    int64_t num_val;
+    size_t bytes_written;
     char *val;
 
     wyini_init();
@@ -75,12 +77,15 @@ int main(int argc, char *argv[])
         goto do_exit;
     }
 
-    snprintf(num_val, 32, "%d", atoi(val) + 1); /* Increment the number read from "NUM_VAR_1" by 1. */
-    if(wyini_write_val(var, num_val) != WYINI_OK) {
-        printf("Write VAL:%s to VAR%s failed.\n", val, var);
+    if(wyini_get_int64(var, &num_val) != WYINI_OK) { /* Read "NUM_VAR_1" as a number. */
+        printf("VAR:%s is not a number\n", var);
+        goto do_exit;
+    }
+    if(wyini_set_int64(var, num_val + 1) != WYINI_OK) { /* Increment the number read from "NUM_VAR_1" by 1. */
+        printf("Write VAL:%lld to VAR%s failed.\n", (long long)(num_val + 1), var);
         goto do_exit;
     } else 
-        printf("Wrote VAL:%s to VAR:%s\n", num_val, var);
+        printf("Wrote VAL:%lld to VAR:%s\n", (long long)(num_val + 1), var);
 
     if(wyini_get_var_val(var, &val) == WYINI_OK) /* Let's read "NUM_VAR_1" after we overwrote the value. */
         printf("VAR:%s | VAL:%s | VAL len:%zd\n", var, val, strlen(val));
@@ -89,8 +94,8 @@ int main(int argc, char *argv[])
         goto do_exit;
     }
 
-    if(wyini_save(filename)==WYINI_OK) 
-         printf("Updated file content saved\n");
+    if(wyini_save_bytes(filename, &bytes_written)==WYINI_OK) /* Only the changed part of the file is written if the value kept its length. */
+         printf("Updated file content saved (%zu bytes written)\n", bytes_written);
     else
          printf("Save to file failed.\n");
 
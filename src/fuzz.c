@@ -0,0 +1,631 @@
+/**
+ * @file fuzz.c
+ * Fuzz and differential test harness for the WY_IniMgr library. Each input is decoded into INI content and a sequence of operations, which are run both through the library and through a reference implementation in this file. Any difference aborts the program, so that fuzzers and sanitizers report the input.
+ * \n
+ * The reference is a plain scalar scan of one flat buffer, following the rules in WY_IniParseAgent.h line by line: lines end at '\n' or '\0', a '\r' right before the end is not part of the line, and the first line of the form 'var = val' wins. It has no index, no edit buffer and no SIMD, so it shows whether these faster paths still give the original results.
+ * \n
+ * Input layout: byte 0 selects how the content is opened (modulo 3: wyini_open_h(), wyini_open_mmap_h() or a compiled image). Byte 1 is the number of operations N. N operations of 3 bytes follow, each a kind, a name and a value selector, and the rest is the INI content. The kinds (modulo 4) are:
+ * - get: wyini_get_var_val_h() and wyini_get_var_view_h().
+ * - write: wyini_write_val_h().
+ * - save: wyini_save_bytes_h() to a second file, compared byte for byte with the reference. Saves after the first one from the same handle only overwrite the changed blocks, so this also checks the dirty block tracking.
+ * - reopen: save, then open the saved file in the same way as the first.
+ *
+ * After the operations, the content of the reference is fed to wyini_stream_feed() in chunks of random sizes, some of them ending between the '\r' and '\n' of a nextline indicator. Every 'var=val' line it passes must match the next variable returned by wyini_iter_next() on the handle in section, variable, value and line number.
+ *
+ * Names are either special names, e.g. "" or "a=b", or taken from the start of a line of the content. Values come from a table of awkward values, e.g. values with a '\n' or of WYINI_MAX_VAL_LEN chars.
+ * \n
+ * Parameters are passed as name=value pairs. All other arguments are input files. All are optional:
+ * - runs=N Number of random inputs to run when no input files are given. Default 10000.
+ * - seed=N Seed of the random inputs. Default 1.
+ * - dir=PATH Directory for the temporary files. Default the current directory.
+ *
+ * Usage:
+ * - `make fuzz` in the build directory builds fuzz with ASan and UBSan. `./fuzz runs=100000` runs random inputs. `./fuzz corpus/ *` runs every file of a corpus once. Both print the throughput as one JSON line like bench, so the tester doubles as a benchmark.
+ * - One seed only covers some sequences of operations, so test a change with several, e.g. `for s in 1 2 3 4 5 6 7 8; do ./fuzz runs=20000 seed=$s dir=/dev/shm || break; done`, and replay the corpus with `./fuzz corpus/ *`.
+ * - `make fuzz_libfuzzer` builds fuzz_libfuzzer with clang's libFuzzer, e.g. `./fuzz_libfuzzer corpus/`.
+ * - For AFL, build with `make fuzz CC=afl-clang-fast` and run `afl-fuzz -i corpus -o findings ./fuzz @@`.
+*/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "WY_IniDefs.h"
+#include "WY_IniMgr.h"
+
+
+#define FUZZ_MAX_SIZE 65536 /**< Max size of the content of an input. Longer content is cut. */
+#define FUZZ_MAX_NAME 64 /**< Max length of a name taken from the content. */
+#define FUZZ_MODE_READ 0 /**< Byte 0 of an input: open with wyini_open_h(). */
+#define FUZZ_MODE_MMAP 1 /**< Byte 0 of an input: open with wyini_open_mmap_h(). */
+#define FUZZ_MODE_COMPILED 2 /**< Byte 0 of an input: compile the content and open the image with wyini_open_compiled_h(). */
+
+
+/**
+ * The reference implementation's copy of the content.
+ */
+struct S_fuzz_ref
+{
+    char *m_buf; /**< The content, written in place. */
+    size_t m_len; /**< Length of the content. */
+};
+
+/**
+ * Paths of the temporary files.
+ */
+struct S_fuzz_files
+{
+    char m_file[2][512]; /**< The content is opened from one and saved to the other, so a mapped file is never written. */
+    char m_image[512]; /**< The compiled image. */
+};
+
+static const char *const m_fuzz_names[] = { "", " ", "a", "a ", "a=b", "x\ny", "[s]", "KEY" }; /**< Special names, selected by name bytes below 8. */
+
+static const char *const m_fuzz_vals[] = { "", " ", "1", "42", "-7", "abc", "a b  ", "  lead", "x=y", "[s]", "v\n", "a\nb=c", "t\r", "\r\n", "true", /**< Values, selected by value bytes. The last two are the longest value that can be written and one char too many. */
+    "vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv",
+    "wwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwww" };
+
+
+/**
+ * Reports a difference between the library and the reference and aborts.
+ * @param p_what What differs.
+ * @param p_name The name or file involved.
+ * @param p_got Status returned by the library.
+ * @param p_expected Status returned by the reference.
+ */
+static void fuzz_fail(const char *restrict const p_what, const char *restrict const p_name, const int p_got, const int p_expected)
+{
+    fprintf(stderr, "fuzz: %s differs for \"%s\": library %d, reference %d\n", p_what, p_name, p_got, p_expected);
+    abort();
+}
+
+
+/**
+ * Finds the line starting at an offset of the reference content.
+ * @param p_ref The reference content.
+ * @param p_start Offset of the start of the line.
+ * @param p_end Returns the offset right after the last char of the line, excluding the nextline indicator.
+ * @return Offset of the next line.
+ */
+static size_t fuzz_ref_line(const struct S_fuzz_ref *restrict p_ref, const size_t p_start, size_t *restrict p_end)
+{
+    size_t delim = p_start;
+
+    while((delim < p_ref->m_len) && (p_ref->m_buf[delim] != '\n') && (p_ref->m_buf[delim] != '\0'))
+        ++delim;
+    if(delim == p_ref->m_len) { /* The last line has no nextline indicator. */
+        *p_end = delim;
+        return delim;
+    }
+    *p_end = ((delim > 0) && (p_ref->m_buf[delim-1] == '\r')) ? delim - 1 : delim;
+    return delim + 1;
+}
+
+
+/**
+ * Matches the 'var=val' pattern against a line of the reference content.
+ * @param p_ref The reference content.
+ * @param p_start Offset of the start of the line.
+ * @param p_end Offset right after the last char of the line.
+ * @param p_var The variable name.
+ * @param p_var_only If true, any char after the '=' is enough, and p_offset returns the offset right after the '='.
+ * @param p_offset Returns the offset of the value.
+ * @return WYINI_OK if the line matches. WYINI_VAL_NOT_FOUND if it has the variable but no value. WYINI_NOT_FOUND otherwise.
+ */
+static int fuzz_ref_match(const struct S_fuzz_ref *restrict p_ref, const size_t p_start, const size_t p_end, const char *restrict const p_var, const int p_var_only, size_t *restrict p_offset)
+{
+    const char *restrict buf = p_ref->m_buf;
+    const size_t var_len = strlen(p_var);
+    int return_val = WYINI_NOT_FOUND;
+
+    if((p_end - p_start <= var_len) || (memcmp(buf + p_start, p_var, var_len) != 0))
+        return WYINI_NOT_FOUND;
+    size_t i = p_start + var_len;
+    while(i < p_end) {
+        if(buf[i] == ' ')
+            ++i;
+        else if(buf[i] == '=') {
+            return_val = WYINI_VAL_NOT_FOUND;
+            ++i;
+            break;
+        } else
+            return WYINI_NOT_FOUND;
+    }
+    if(i >= p_end)
+        return return_val;
+    if(p_var_only) {
+        *p_offset = i;
+        return WYINI_OK;
+    }
+    while((i < p_end) && (buf[i] == ' '))
+        ++i;
+    if(i >= p_end)
+        return WYINI_VAL_NOT_FOUND;
+    *p_offset = i;
+    return WYINI_OK;
+}
+
+
+/**
+ * Reference for wyini_get_var_view_h().
+ * @param p_ref The reference content.
+ * @param p_var The variable name.
+ * @param p_val Returns the offset of the value.
+ * @param p_val_len Returns the length of the value, excluding trailing whitespace.
+ * @return WYINI_OK, WYINI_VAL_NOT_FOUND or WYINI_NOT_FOUND.
+ */
+static int fuzz_ref_get(const struct S_fuzz_ref *restrict p_ref, const char *restrict const p_var, size_t *restrict p_val, size_t *restrict p_val_len)
+{
+    size_t end = 0;
+
+    for(size_t start = 0; start < p_ref->m_len; ) {
+        const size_t next = fuzz_ref_line(p_ref, start, &end);
+        const int return_val = fuzz_ref_match(p_ref, start, end, p_var, 0, p_val);
+        if(return_val == WYINI_OK) {
+            *p_val_len = end - *p_val;
+            while((*p_val_len > 1) && (p_ref->m_buf[*p_val + *p_val_len - 1] == ' '))
+                --(*p_val_len);
+            return WYINI_OK;
+        }
+        if(return_val == WYINI_VAL_NOT_FOUND)
+            return WYINI_VAL_NOT_FOUND;
+        start = next;
+    }
+    return WYINI_NOT_FOUND;
+}
+
+
+/**
+ * Reference for wyini_write_val_h(). Replaces everything after the '=' of the first line with the variable and at least one char after the '='.
+ * @param p_ref The reference content.
+ * @param p_var The variable name.
+ * @param p_val The value.
+ * @return WYINI_OK, WYINI_NOT_FOUND or WYINI_MEMORY_ERR.
+ */
+static int fuzz_ref_write(struct S_fuzz_ref *restrict p_ref, const char *restrict const p_var, const char *restrict const p_val)
+{
+    const size_t val_len = strlen(p_val);
+    size_t end = 0;
+    size_t offset = 0;
+
+    if(val_len >= WYINI_MAX_VAL_LEN)
+        return WYINI_MEMORY_ERR;
+    for(size_t start = 0; start < p_ref->m_len; ) {
+        const size_t next = fuzz_ref_line(p_ref, start, &end);
+        if(fuzz_ref_match(p_ref, start, end, p_var, 1, &offset) == WYINI_OK) {
+            const size_t len = p_ref->m_len - (end - offset) + val_len;
+            char *buf = (char*)malloc(len);
+            if(buf == NULL)
+                abort();
+            memcpy(buf, p_ref->m_buf, offset);
+            memcpy(buf + offset, p_val, val_len);
+            memcpy(buf + offset + val_len, p_ref->m_buf + end, p_ref->m_len - end);
+            free(p_ref->m_buf);
+            p_ref->m_buf = buf;
+            p_ref->m_len = len;
+            return WYINI_OK;
+        }
+        start = next;
+    }
+    return WYINI_NOT_FOUND;
+}
+
+
+/**
+ * Picks the name of an operation. Bytes below 8 select a special name. Others select a line of the original content and take either its whole start up to the '=', without the spaces before it, or the whole line.
+ * @param p_content The original content.
+ * @param p_len Length of the content.
+ * @param p_select The name byte of the operation.
+ * @param p_name Returns the name. Holds FUZZ_MAX_NAME+1 chars.
+ */
+static void fuzz_name(const char *restrict const p_content, const size_t p_len, const unsigned char p_select, char *restrict p_name)
+{
+    size_t start = 0;
+    size_t lines = 0;
+    size_t end;
+
+    if(p_select < 8) {
+        strcpy(p_name, m_fuzz_names[p_select]);
+        return;
+    }
+    for(size_t i=0; i<p_len; ++i)
+        lines += (p_content[i] == '\n');
+    for(size_t line = (p_select >> 1) % (lines + 1); line > 0; --line)
+        start = (size_t)((const char*)memchr(p_content + start, '\n', p_len - start) - p_content) + 1;
+    for(end = start; (end < p_len) && (p_content[end] != '\n') && (p_content[end] != '\0') && ((p_select & 1) || (p_content[end] != '=')); ++end)
+        ;
+    while(!(p_select & 1) && (end > start) && (p_content[end-1] == ' '))
+        --end;
+    if(end - start > FUZZ_MAX_NAME)
+        end = start + FUZZ_MAX_NAME;
+    memcpy(p_name, p_content + start, end - start);
+    p_name[end - start] = 0;
+}
+
+
+/**
+ * Writes a file.
+ * @return 0 if success.
+ */
+static int fuzz_write_file(const char *restrict const p_file, const char *restrict const p_content, const size_t p_len)
+{
+    FILE *fp = fopen(p_file, "wb");
+    if(fp == NULL)
+        return -1;
+    const size_t written = fwrite(p_content, 1, p_len, fp);
+    return ((fclose(fp) == 0) && (written == p_len)) ? 0 : -1;
+}
+
+
+/**
+ * Checks that a file holds exactly the reference content.
+ */
+static void fuzz_check_file(const char *restrict const p_file, const struct S_fuzz_ref *restrict p_ref)
+{
+    char *buf = (char*)malloc(p_ref->m_len + 1);
+    FILE *fp = fopen(p_file, "rb");
+    if((buf == NULL) || (fp == NULL))
+        abort();
+    const size_t len = fread(buf, 1, p_ref->m_len + 1, fp);
+    fclose(fp);
+    if((len != p_ref->m_len) || (memcmp(buf, p_ref->m_buf, len) != 0))
+        fuzz_fail("saved content", p_file, (int)len, (int)p_ref->m_len);
+    free(buf);
+}
+
+
+/**
+ * Opens a file in the way selected by an input.
+ * @return The status of the open.
+ */
+static int fuzz_open(const int p_mode, const char *restrict const p_file, const struct S_fuzz_files *restrict p_files, wyini_handle_t *restrict *restrict p_handle)
+{
+    int mode;
+    int return_val;
+
+    if(p_mode == FUZZ_MODE_MMAP)
+        return wyini_open_mmap_h(p_file, FUZZ_MAX_SIZE, &mode, p_handle);
+    if(p_mode == FUZZ_MODE_COMPILED) {
+        *p_handle = NULL;
+        if((return_val = wyini_compile(p_file, FUZZ_MAX_SIZE, p_files->m_image)) != WYINI_OK)
+            return return_val;
+        return wyini_open_compiled_h(p_files->m_image, FUZZ_MAX_SIZE, p_handle);
+    }
+    return wyini_open_h(p_file, FUZZ_MAX_SIZE, p_handle);
+}
+
+
+/**
+ * Returns a pseudo-random number. A fixed generator makes runs repeatable.
+ */
+static unsigned int fuzz_rand(unsigned int *restrict p_state)
+{
+    *p_state = *p_state*1103515245u + 12345u;
+    return *p_state >> 8;
+}
+
+
+/**
+ * What the streaming check compares each stream line with.
+ */
+struct S_fuzz_stream
+{
+    wyini_iter m_iter; /**< Cursor over the handle holding the same content. */
+};
+
+
+/**
+ * Checks that two views hold the same chars.
+ */
+static int fuzz_view_equal(const wyini_view *restrict p_a, const wyini_view *restrict p_b)
+{
+    return (p_a->m_len == p_b->m_len) && ((p_a->m_len == 0) || (memcmp(p_a->m_ptr, p_b->m_ptr, p_a->m_len) == 0));
+}
+
+
+/**
+ * Callback of the streaming check. Compares every 'var=val' line of the stream with the next variable of the cursor.
+ */
+static int fuzz_stream_line(const wyini_stream_line *p_line, void *p_user)
+{
+    struct S_fuzz_stream *restrict check = (struct S_fuzz_stream*)p_user;
+    wyini_pair pair;
+
+    if((p_line->m_var.m_ptr == NULL) || p_line->m_header)
+        return WYINI_OK;
+    if(wyini_iter_next(&(check->m_iter), &pair) != WYINI_OK)
+        fuzz_fail("stream line without variable", "", (int)p_line->m_line_no, 0);
+    if(p_line->m_line_no != pair.m_line_no)
+        fuzz_fail("stream line number", "", (int)p_line->m_line_no, (int)pair.m_line_no);
+    if(!fuzz_view_equal(&(p_line->m_section), &(pair.m_section)) || !fuzz_view_equal(&(p_line->m_var), &(pair.m_var)) || !fuzz_view_equal(&(p_line->m_val), &(pair.m_val)))
+        fuzz_fail("stream section, var or val", "", (int)p_line->m_line_no, (int)pair.m_line_no);
+    return WYINI_OK;
+}
+
+
+/**
+ * Feeds content to a stream in chunks of random sizes and checks that it passes the same variables, sections and line numbers as a cursor over a handle holding the same content. Some chunks end right after a '\r', so that a "\r\n" is split between chunks.
+ * @param p_content The content.
+ * @param p_len Length of the content.
+ * @param p_seed Seed of the chunk sizes.
+ * @param p_handle The handle holding the content.
+ */
+static void fuzz_check_stream(const char *restrict const p_content, const size_t p_len, unsigned int p_seed, const wyini_handle_t *restrict p_handle)
+{
+    struct S_fuzz_stream check;
+    wyini_stream_t *stream;
+    wyini_pair pair;
+    size_t fed = 0;
+
+    if((wyini_iter_begin_h(p_handle, &(check.m_iter)) != WYINI_OK) || (wyini_stream_open(fuzz_stream_line, &check, (unsigned int)p_len + 1, &stream) != WYINI_OK)) /* No line is longer than the content. */
+        abort();
+    while(fed < p_len) {
+        size_t chunk = 1 + fuzz_rand(&p_seed) % 16;
+        const char *cr = (fuzz_rand(&p_seed) % 2) ? (const char*)memchr(p_content + fed, '\r', p_len - fed) : NULL;
+        if(cr != NULL) /* End the chunk right after the next '\r'. */
+            chunk = (size_t)(cr - (p_content + fed)) + 1;
+        if(chunk > p_len - fed)
+            chunk = p_len - fed;
+        const int fed_status = wyini_stream_feed(stream, p_content + fed, chunk);
+        if(fed_status != WYINI_OK)
+            fuzz_fail("wyini_stream_feed", "", fed_status, WYINI_OK);
+        fed += chunk;
+    }
+    const int finished = wyini_stream_finish(stream);
+    if(finished != WYINI_OK)
+        fuzz_fail("wyini_stream_finish", "", finished, WYINI_OK);
+    if(wyini_iter_next(&(check.m_iter), &pair) == WYINI_OK)
+        fuzz_fail("variable missing from stream", "", 0, (int)pair.m_line_no);
+    wyini_stream_close(stream);
+}
+
+
+/**
+ * Runs one input through the library and the reference, aborting on any difference.
+ * @param p_data The input.
+ * @param p_size Size of the input.
+ * @param p_files Paths of the temporary files.
+ * @return Size of the content of the input.
+ */
+static size_t fuzz_run(const uint8_t *restrict p_data, const size_t p_size, const struct S_fuzz_files *restrict p_files)
+{
+    struct S_fuzz_ref ref;
+    wyini_handle_t *handle = NULL;
+    wyini_view view;
+    char name[FUZZ_MAX_NAME + 1];
+    char *val;
+    size_t val_offset = 0;
+    size_t val_len = 0;
+    unsigned int source = 0;
+
+    if(p_size < 2)
+        return 0;
+    const int mode = p_data[0] % 3;
+    size_t op_count = p_data[1];
+    if(2 + 3*op_count > p_size)
+        op_count = (p_size - 2) / 3;
+    const uint8_t *restrict ops = p_data + 2;
+    const char *restrict content = (const char*)(ops + 3*op_count);
+    size_t content_len = p_size - 2 - 3*op_count;
+    if(content_len > FUZZ_MAX_SIZE)
+        content_len = FUZZ_MAX_SIZE;
+
+    if((ref.m_buf = (char*)malloc(content_len + 1)) == NULL)
+        abort();
+    memcpy(ref.m_buf, content, content_len);
+    ref.m_len = content_len;
+    if(fuzz_write_file(p_files->m_file[0], content, content_len) != 0)
+        abort();
+
+    const int open_status = fuzz_open(mode, p_files->m_file[0], p_files, &handle);
+    if((open_status == WYINI_OK) != (content_len > 0)) /* Only empty files cannot be opened. */
+        fuzz_fail("open", p_files->m_file[0], open_status, (content_len > 0) ? WYINI_OK : WYINI_IO_ERR);
+    if(open_status != WYINI_OK) {
+        free(ref.m_buf);
+        return content_len;
+    }
+
+    for(size_t i=0; i<op_count; ++i) {
+        const uint8_t *restrict op = ops + 3*i;
+        const char *restrict new_val = m_fuzz_vals[op[2] % (sizeof(m_fuzz_vals)/sizeof(*m_fuzz_vals))];
+        fuzz_name(content, content_len, op[1], name);
+
+        switch(op[0] % 4) {
+        case 0: { /* get */
+            const int expected = fuzz_ref_get(&ref, name, &val_offset, &val_len);
+            int got = wyini_get_var_view_h(handle, name, &view);
+            if((got != expected) || ((got == WYINI_OK) && ((view.m_len != val_len) || (memcmp(view.m_ptr, ref.m_buf + val_offset, val_len) != 0))))
+                fuzz_fail("wyini_get_var_view_h", name, got, expected);
+            got = wyini_get_var_val_h(handle, name, &val);
+            const int expected_copy = ((expected == WYINI_OK) && (val_len >= WYINI_MAX_VAL_LEN)) ? WYINI_NOT_FOUND : expected; /* Values that do not fit the copy are not found. */
+            if((got != expected_copy) || ((got == WYINI_OK) && ((strlen(val) != val_len) || (memcmp(val, ref.m_buf + val_offset, val_len) != 0))))
+                fuzz_fail("wyini_get_var_val_h", name, got, expected_copy);
+            break;
+        }
+        case 1: { /* write */
+            const int expected = fuzz_ref_write(&ref, name, new_val);
+            const int got = wyini_write_val_h(handle, name, new_val);
+            if(got != expected)
+                fuzz_fail("wyini_write_val_h", name, got, expected);
+            break;
+        }
+        default: { /* save, or save and reopen */
+            const int expected = (ref.m_len > 1) ? WYINI_OK : WYINI_MEMORY_ERR; /* Content of 1 char is never saved. */
+            size_t written;
+            const int got = wyini_save_bytes_h(handle, p_files->m_file[1 - source], &written);
+            if(got != expected)
+                fuzz_fail("wyini_save_bytes_h", p_files->m_file[1 - source], got, expected);
+            if(got != WYINI_OK)
+                break;
+            if(written > ref.m_len)
+                fuzz_fail("bytes written", p_files->m_file[1 - source], (int)written, (int)ref.m_len);
+            fuzz_check_file(p_files->m_file[1 - source], &ref);
+            if(op[0] % 4 == 3) {
+                wyini_close_h(handle);
+                source = 1 - source;
+                const int reopened = fuzz_open(mode, p_files->m_file[source], p_files, &handle);
+                if((reopened == WYINI_OK) != (ref.m_len > 0))
+                    fuzz_fail("reopen", p_files->m_file[source], reopened, (ref.m_len > 0) ? WYINI_OK : WYINI_IO_ERR);
+                if(reopened != WYINI_OK) {
+                    free(ref.m_buf);
+                    return content_len;
+                }
+            }
+            break;
+        }
+        }
+    }
+
+    fuzz_check_stream(ref.m_buf, ref.m_len, (unsigned int)(content_len*31u + op_count), handle); /* The handle now holds the reference content, with the writes in it. */
+    wyini_close_h(handle);
+    free(ref.m_buf);
+    return content_len;
+}
+
+
+/**
+ * Sets the paths of the temporary files.
+ */
+static void fuzz_files(const char *restrict const p_dir, struct S_fuzz_files *restrict p_files)
+{
+    snprintf(p_files->m_file[0], sizeof(p_files->m_file[0]), "%s/wyini_fuzz_a.ini", p_dir);
+    snprintf(p_files->m_file[1], sizeof(p_files->m_file[1]), "%s/wyini_fuzz_b.ini", p_dir);
+    snprintf(p_files->m_image, sizeof(p_files->m_image), "%s/wyini_fuzz.bin", p_dir);
+}
+
+
+#if defined WYINI_FUZZ_LIBFUZZER
+/**
+ * Entry point for libFuzzer. The temporary files are kept in the current directory.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *p_data, size_t p_size)
+{
+    static struct S_fuzz_files files;
+
+    if(files.m_file[0][0] == 0)
+        fuzz_files(".", &files);
+    fuzz_run(p_data, p_size, &files);
+    return 0;
+}
+#else
+/**
+ * Removes the temporary files.
+ */
+static void fuzz_remove(const struct S_fuzz_files *restrict p_files)
+{
+    remove(p_files->m_file[0]);
+    remove(p_files->m_file[1]);
+    remove(p_files->m_image);
+}
+
+
+/**
+ * Generates a random input, with content made of lines that are likely to hit the corner cases of the parser.
+ * @param p_state State of the random generator.
+ * @param p_data Returns the input. Holds at least 2 + 3*255 + 4096 bytes.
+ * @return Size of the input.
+ */
+static size_t fuzz_generate(unsigned int *restrict p_state, uint8_t *restrict p_data)
+{
+    static const char *const lines[] = { "KEY = value", "a=1", "a =", "a= ", "a = 2 ", " a=3", "a b=4", "=5", "a==6", "a=b=7", "[s]", "[ s ] ", "KEY", "", " ", "x\ty=8", "a\r=9", "\r" };
+    static const char *const ends[] = { "\n", "\r\n", "\n", "\0", "\r\r\n" };
+    size_t size = 0;
+
+    p_data[size++] = (uint8_t)fuzz_rand(p_state);
+    const unsigned int op_count = fuzz_rand(p_state) % 64;
+    p_data[size++] = (uint8_t)op_count;
+    for(unsigned int i=0; i<3*op_count; ++i)
+        p_data[size++] = (uint8_t)fuzz_rand(p_state);
+
+    const unsigned int line_count = fuzz_rand(p_state) % 24;
+    for(unsigned int i=0; i<line_count; ++i) {
+        const char *restrict line = lines[fuzz_rand(p_state) % (sizeof(lines)/sizeof(*lines))];
+        const unsigned int end = fuzz_rand(p_state) % (sizeof(ends)/sizeof(*ends));
+        memcpy(p_data + size, line, strlen(line));
+        size += strlen(line);
+        if((i + 1 < line_count) || (fuzz_rand(p_state) % 2)) /* The last line may end without a nextline indicator. */
+            size += (ends[end][0] == 0) ? (p_data[size] = 0, 1) : (memcpy(p_data + size, ends[end], strlen(ends[end])), strlen(ends[end]));
+    }
+    return size;
+}
+
+
+/**
+ * Reads a whole input file.
+ * @param p_file The file.
+ * @param p_size Returns the size of the input.
+ * @return The input, to be freed by the caller. NULL if the file cannot be read.
+ */
+static uint8_t * fuzz_read_file(const char *restrict const p_file, size_t *restrict p_size)
+{
+    FILE *fp = fopen(p_file, "rb");
+    uint8_t *data = NULL;
+    size_t size = 0;
+    size_t len;
+
+    if(fp == NULL)
+        return NULL;
+    do { /* Read in blocks, since the file may be a pipe. */
+        uint8_t *tmp = (uint8_t*)realloc(data, size + 65536);
+        if(tmp == NULL) {
+            free(data);
+            fclose(fp);
+            return NULL;
+        }
+        data = tmp;
+        len = fread(data + size, 1, 65536, fp);
+        size += len;
+    } while(len == 65536);
+    fclose(fp);
+    *p_size = size;
+    return data;
+}
+
+
+int main(int argc, char *argv[])
+{
+    static uint8_t data[2 + 3*255 + 4096];
+    struct S_fuzz_files files;
+    const char *dir = ".";
+    unsigned int runs = 10000;
+    unsigned int seed = 1;
+    unsigned int count = 0;
+    double bytes = 0;
+    struct timespec start;
+    struct timespec stop;
+
+    for(int i=1; i<argc; ++i) { /* Parse name=value parameters. */
+        if(strncmp(argv[i], "runs=", 5) == 0) runs = (unsigned int)strtoul(argv[i] + 5, NULL, 10);
+        else if(strncmp(argv[i], "seed=", 5) == 0) seed = (unsigned int)strtoul(argv[i] + 5, NULL, 10);
+        else if(strncmp(argv[i], "dir=", 4) == 0) dir = argv[i] + 4;
+    }
+    fuzz_files(dir, &files);
+
+    timespec_get(&start, TIME_UTC);
+    for(int i=1; i<argc; ++i) { /* Every other argument is an input file. */
+        size_t size = 0;
+        if((strncmp(argv[i], "runs=", 5) == 0) || (strncmp(argv[i], "seed=", 5) == 0) || (strncmp(argv[i], "dir=", 4) == 0))
+            continue;
+        uint8_t *input = fuzz_read_file(argv[i], &size);
+        if(input == NULL) {
+            printf("Cannot read %s\n", argv[i]);
+            fuzz_remove(&files);
+            return 1;
+        }
+        bytes += (double)fuzz_run(input, size, &files);
+        ++count;
+        free(input);
+    }
+    if(count == 0) { /* No input files, so generate the inputs. */
+        for(; count<runs; ++count)
+            bytes += (double)fuzz_run(data, fuzz_generate(&seed, data), &files);
+    }
+    timespec_get(&stop, TIME_UTC);
+    fuzz_remove(&files);
+
+    const double elapsed_ns = (double)(stop.tv_sec - start.tv_sec)*1e9 + (double)(stop.tv_nsec - start.tv_nsec);
+    printf("{\"op\":\"fuzz\",\"count\":%u,\"ns_per_op\":%.1f,\"mb_per_s\":%.3f}\n", count, (count > 0) ? elapsed_ns/count : 0.0, (elapsed_ns > 0) ? (bytes/(1024.0*1024.0))/(elapsed_ns/1e9) : 0.0);
+    return 0;
+}
+#endif
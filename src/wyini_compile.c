@@ -0,0 +1,34 @@
+/**
+ * @file wyini_compile.c
+ * Command line tool that compiles an INI file into a binary image for wyini_open_compiled().
+ * \n
+ * Usage: `wyini_compile INI_FILE IMAGE_FILE [MAX_SIZE]`. MAX_SIZE limits the size of the INI file in bytes and defaults to 64MB.
+ * \n
+ * Example: `./wyini_compile app.ini app.ini.bin`
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "WY_IniDefs.h"
+#include "WY_IniMgr.h"
+
+#define COMPILE_DEFAULT_MAX_SIZE (64u*1024u*1024u) /**< Default limit on the size of the INI file. */
+
+
+int main(int argc, char *argv[])
+{
+    unsigned int max_size = COMPILE_DEFAULT_MAX_SIZE;
+
+    if((argc < 3) || (argc > 4)) {
+        printf("Usage: %s INI_FILE IMAGE_FILE [MAX_SIZE]\n", argv[0]);
+        return 1;
+    }
+    if(argc == 4)
+        max_size = (unsigned int)strtoul(argv[3], NULL, 10);
+
+    const int return_val = wyini_compile(argv[1], max_size, argv[2]);
+    if(return_val != WYINI_OK) {
+        printf("Cannot compile %s into %s, error %d.\n", argv[1], argv[2], return_val);
+        return 1;
+    }
+    return 0;
+}